@@ -0,0 +1,88 @@
+#include "StdAfx.h"
+#include "AdmissionController.h"
+#include "GameCVars.h"
+
+void CAdmissionController::UpdateTickTime(float updateTime)
+{
+	// 约半秒的平滑窗口，单帧卡顿不会立即关闭准入
+	const float smoothing = 0.05f;
+	m_averageTickTime += (updateTime * 1000.f - m_averageTickTime) * smoothing;
+}
+
+CAdmissionController::EResult CAdmissionController::OnConnectionRequested(int channelId, size_t playerCount, const SGameCVars& cvars, string& rejectReason)
+{
+	const size_t maxPlayers = static_cast<size_t>(max(cvars.g_maxPlayers, 0));
+	const size_t maxQueued = static_cast<size_t>(max(cvars.g_admissionQueueSize, 0));
+
+	// 没有排队且负载允许时立即准入
+	if (m_pendingConnections.empty() && playerCount < maxPlayers && !IsOverBudget(cvars))
+	{
+		return EResult::Admit;
+	}
+
+	if (m_pendingConnections.size() >= maxQueued)
+	{
+		// 只列出此刻实际成立的条件：排队已满(允许排队时)，以及使连接无法立即准入的玩家上限与帧耗时预算
+		// 队列正按速率准入时后两者可能都已解除，此时只有排队已满
+		rejectReason = maxQueued > 0 ? string().Format("Admission queue full with %" PRISIZE_T " connections waiting", m_pendingConnections.size()) : string("Not admitting");
+		if (playerCount >= maxPlayers)
+		{
+			rejectReason += string().Format(", server full with %" PRISIZE_T "/%" PRISIZE_T " players", playerCount, maxPlayers);
+		}
+		if (IsOverBudget(cvars))
+		{
+			rejectReason += string().Format(", tick %.1f ms over budget %.1f ms", m_averageTickTime, cvars.g_admissionTickBudget);
+		}
+
+		return EResult::Reject;
+	}
+
+	m_pendingConnections.push_back(SPendingConnection{ channelId, false });
+	return EResult::Queue;
+}
+
+bool CAdmissionController::OnChannelReady(int channelId)
+{
+	for (SPendingConnection& pendingConnection : m_pendingConnections)
+	{
+		if (pendingConnection.channelId == channelId)
+		{
+			pendingConnection.bReady = true;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void CAdmissionController::OnChannelDisconnected(int channelId)
+{
+	for (auto it = m_pendingConnections.begin(); it != m_pendingConnections.end(); ++it)
+	{
+		if (it->channelId == channelId)
+		{
+			m_pendingConnections.erase(it);
+			return;
+		}
+	}
+}
+
+void CAdmissionController::AdmitPending(size_t playerCount, const SGameCVars& cvars, const std::function<void(int channelId, bool bReady)>& func)
+{
+	if (m_pendingConnections.empty() || IsOverBudget(cvars))
+		return;
+
+	const size_t maxPlayers = static_cast<size_t>(max(cvars.g_maxPlayers, 0));
+	for (int admitted = 0; admitted < cvars.g_admissionRatePerTick && playerCount < maxPlayers && !m_pendingConnections.empty(); ++admitted, ++playerCount)
+	{
+		const SPendingConnection pendingConnection = m_pendingConnections.front();
+		m_pendingConnections.pop_front();
+
+		func(pendingConnection.channelId, pendingConnection.bReady);
+	}
+}
+
+bool CAdmissionController::IsOverBudget(const SGameCVars& cvars) const
+{
+	return cvars.g_admissionTickBudget > 0.f && m_averageTickTime > cvars.g_admissionTickBudget;
+}
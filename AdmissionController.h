@@ -0,0 +1,51 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+
+struct SGameCVars;
+
+// 连接准入控制
+// 根据测得的帧耗时与玩家上限决定新连接是立即准入、排队还是拒绝
+// 排队中的连接在每帧以有限的速率准入，避免服务器过载时瞬间涌入大量玩家
+class CAdmissionController
+{
+public:
+	enum class EResult : uint8
+	{
+		Admit = 0,
+		Queue,
+		Reject
+	};
+
+	// 每帧调用，以服务器更新本身的耗时(秒，不含帧率上限的休眠)更新滑动平均
+	void UpdateTickTime(float updateTime);
+
+	// 新连接请求，返回Reject时rejectReason为拒绝原因
+	EResult OnConnectionRequested(int channelId, size_t playerCount, const SGameCVars& cvars, string& rejectReason);
+	// 客户端准备好游戏，若其仍在队列中则记录下来并返回true
+	bool OnChannelReady(int channelId);
+	void OnChannelDisconnected(int channelId);
+
+	// 按速率取出本帧可准入的排队连接，bReady表示客户端已在排队期间准备好游戏
+	void AdmitPending(size_t playerCount, const SGameCVars& cvars, const std::function<void(int channelId, bool bReady)>& func);
+
+	void Clear() { m_pendingConnections.clear(); }
+
+	float GetAverageTickTime() const { return m_averageTickTime; }
+	size_t GetPendingCount() const { return m_pendingConnections.size(); }
+
+protected:
+	bool IsOverBudget(const SGameCVars& cvars) const;
+
+protected:
+	struct SPendingConnection
+	{
+		int channelId;
+		bool bReady;
+	};
+
+	std::deque<SPendingConnection> m_pendingConnections;
+	// 服务器更新耗时的指数滑动平均(毫秒)
+	float m_averageTickTime = 0.f;
+};
@@ -0,0 +1,43 @@
+#include "StdAfx.h"
+#include "BotInputGenerator.h"
+
+CBotInputGenerator::CBotInputGenerator(uint32 seed)
+	// xorshift的状态不能为0
+	: m_randomState(seed != 0 ? seed : 0x6D2B79F5u)
+{
+	// 错开各机器人第一次切换输入的时间
+	m_timeToNextChange = NextRandomRange(0.f, 1.f);
+}
+
+bool CBotInputGenerator::Update(float frameTime, uint8 movementMask, uint8& inputFlags, Vec2& mouseDeltaRotation)
+{
+	mouseDeltaRotation.x += m_yawRate * frameTime;
+
+	m_timeToNextChange -= frameTime;
+	if (m_timeToNextChange > 0.f)
+		return false;
+
+	m_timeToNextChange = NextRandomRange(0.5f, 3.f);
+	m_yawRate = NextRandomRange(-300.f, 300.f);
+
+	const uint8 newInputFlags = static_cast<uint8>(NextRandom()) & movementMask;
+	if (newInputFlags == inputFlags)
+		return false;
+
+	inputFlags = newInputFlags;
+	return true;
+}
+
+uint32 CBotInputGenerator::NextRandom()
+{
+	m_randomState ^= m_randomState << 13;
+	m_randomState ^= m_randomState >> 17;
+	m_randomState ^= m_randomState << 5;
+	return m_randomState;
+}
+
+float CBotInputGenerator::NextRandomRange(float minValue, float maxValue)
+{
+	const float unit = static_cast<float>(NextRandom() >> 8) * (1.f / 16777216.f);
+	return minValue + (maxValue - minValue) * unit;
+}
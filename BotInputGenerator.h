@@ -0,0 +1,27 @@
+#pragma once
+
+// 服务器端机器人玩家的脚本化输入
+// 以廉价的伪随机序列周期性地切换移动按键并旋转视角，代替网络频道驱动CPlayerComponent的更新
+class CBotInputGenerator
+{
+public:
+	explicit CBotInputGenerator(uint32 seed);
+
+	// 更新输入，movementMask为允许使用的移动flag
+	// 返回true表示inputFlags发生了变化，需要同步到客户端
+	bool Update(float frameTime, uint8 movementMask, uint8& inputFlags, Vec2& mouseDeltaRotation);
+
+	// 随机数状态，以此构造的生成器继续同一序列
+	uint32 GetRandomState() const { return m_randomState; }
+
+protected:
+	// xorshift32
+	uint32 NextRandom();
+	float NextRandomRange(float minValue, float maxValue);
+
+protected:
+	uint32 m_randomState;
+	float m_timeToNextChange = 0.f;
+	// 鼠标每秒的水平位移量
+	float m_yawRate = 0.f;
+};
@@ -0,0 +1,194 @@
+#include "StdAfx.h"
+#include "BroadcastStream.h"
+
+bool CBroadcastStream::Listen(uint16 port)
+{
+	Close();
+
+	if (port == 0)
+		return false;
+
+	m_listenSocket = CrySock::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (m_listenSocket == CRY_INVALID_SOCKET)
+		return false;
+
+	CrySock::SetReuseAddress(m_listenSocket, true);
+
+	// 只接受本机的中继进程
+	CRYSOCKADDR_IN address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_port = htons(port);
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	if (CrySock::bind(m_listenSocket, reinterpret_cast<const CRYSOCKADDR*>(&address), sizeof(address)) == CRY_SOCKET_ERROR
+		|| CrySock::listen(m_listenSocket, 8) == CRY_SOCKET_ERROR
+		|| !CrySock::MakeSocketNonBlocking(m_listenSocket))
+	{
+		CryWarning(VALIDATOR_MODULE_GAME, VALIDATOR_WARNING, "[Broadcast] Failed to listen on 127.0.0.1:%u", port);
+		Close();
+		return false;
+	}
+
+	m_port = port;
+	CryLogAlways("[Broadcast] Publishing spectator stream on 127.0.0.1:%u", port);
+	return true;
+}
+
+void CBroadcastStream::Close()
+{
+	for (SRelay& relay : m_relays)
+	{
+		CrySock::closesocket(relay.socket);
+	}
+	m_relays.clear();
+
+	if (m_listenSocket != CRY_INVALID_SOCKET)
+	{
+		CrySock::closesocket(m_listenSocket);
+		m_listenSocket = CRY_INVALID_SOCKET;
+	}
+	m_port = 0;
+
+	m_delayedFrames.clear();
+}
+
+void CBroadcastStream::Capture(float serverTime, const std::vector<SEntityTransform>& entities, size_t maxQueuedFrames)
+{
+	// 没有中继时不需要编码
+	if (!IsListening() || m_relays.empty())
+		return;
+
+	// 整个世界在此编码一次，之后的发布只复制字节
+	m_transforms.resize(entities.size());
+	for (size_t i = 0; i < entities.size(); ++i)
+	{
+		m_transforms[i] = entities[i].transform;
+	}
+	m_codec.Encode(m_transforms.data(), m_transforms.size(), m_encodedTransforms);
+
+	const SFrameHeader header{ FrameMagic, m_frameIndex++, serverTime, static_cast<uint32>(entities.size()) };
+	const uint32 frameSize = static_cast<uint32>(sizeof(header) + entities.size() * sizeof(uint32) + m_encodedTransforms.size());
+
+	SFrame frame;
+	frame.captureTime = serverTime;
+	frame.bytes.resize(sizeof(uint32) + frameSize);
+
+	uint8* pWrite = frame.bytes.data();
+	memcpy(pWrite, &frameSize, sizeof(frameSize));
+	pWrite += sizeof(frameSize);
+	memcpy(pWrite, &header, sizeof(header));
+	pWrite += sizeof(header);
+
+	for (const SEntityTransform& entity : entities)
+	{
+		const uint32 entityId = entity.entityId;
+		memcpy(pWrite, &entityId, sizeof(entityId));
+		pWrite += sizeof(entityId);
+	}
+
+	if (!m_encodedTransforms.empty())
+	{
+		memcpy(pWrite, m_encodedTransforms.data(), m_encodedTransforms.size());
+	}
+
+	// 队列中的帧都未到延迟时间，丢弃意味着中继永远收不到它们
+	while (!m_delayedFrames.empty() && m_delayedFrames.size() >= max(maxQueuedFrames, size_t(1)))
+	{
+		m_delayedFrames.pop_front();
+
+		if (m_evictedFrameCount++ == 0)
+		{
+			CryWarning(VALIDATOR_MODULE_GAME, VALIDATOR_WARNING, "[Broadcast] Delay queue full (%" PRISIZE_T " frames), dropping frames before they are published", maxQueuedFrames);
+		}
+	}
+	m_delayedFrames.push_back(std::move(frame));
+}
+
+void CBroadcastStream::Update(float serverTime, float delay)
+{
+	if (!IsListening())
+		return;
+
+	AcceptRelays();
+
+	while (!m_delayedFrames.empty() && serverTime - m_delayedFrames.front().captureTime >= delay)
+	{
+		Publish(m_delayedFrames.front());
+		m_delayedFrames.pop_front();
+
+		if (m_evictedFrameCount > 0)
+		{
+			CryLogAlways("[Broadcast] Publishing resumed, %u frames were dropped unpublished", m_evictedFrameCount);
+			m_evictedFrameCount = 0;
+		}
+	}
+
+	for (size_t i = 0; i < m_relays.size();)
+	{
+		if (FlushRelay(m_relays[i]))
+		{
+			++i;
+			continue;
+		}
+
+		CryLogAlways("[Broadcast] Relay disconnected (%" PRISIZE_T " remaining)", m_relays.size() - 1);
+		CrySock::closesocket(m_relays[i].socket);
+		m_relays[i] = std::move(m_relays.back());
+		m_relays.pop_back();
+	}
+}
+
+void CBroadcastStream::AcceptRelays()
+{
+	for (;;)
+	{
+		const CRYSOCKET socket = CrySock::accept(m_listenSocket, nullptr, nullptr);
+		if (socket == CRY_INVALID_SOCKET)
+			break;
+
+		CrySock::MakeSocketNonBlocking(socket);
+		m_relays.push_back(SRelay{ socket, {} });
+
+		CryLogAlways("[Broadcast] Relay connected (%" PRISIZE_T " total)", m_relays.size());
+	}
+}
+
+void CBroadcastStream::Publish(const SFrame& frame)
+{
+	for (SRelay& relay : m_relays)
+	{
+		relay.pendingBytes.insert(relay.pendingBytes.end(), frame.bytes.begin(), frame.bytes.end());
+	}
+}
+
+bool CBroadcastStream::FlushRelay(SRelay& relay)
+{
+	if (relay.pendingBytes.size() > MaxRelayBacklog)
+		return false;
+
+	size_t sentBytes = 0;
+	while (sentBytes < relay.pendingBytes.size())
+	{
+		// 中继断开后的发送由send返回错误，不能让服务器因SIGPIPE退出
+#if defined(MSG_NOSIGNAL)
+		const int flags = MSG_NOSIGNAL;
+#else
+		const int flags = 0;
+#endif
+		const int result = CrySock::send(relay.socket, reinterpret_cast<const char*>(relay.pendingBytes.data() + sentBytes), static_cast<int>(relay.pendingBytes.size() - sentBytes), flags);
+		if (result == CRY_SOCKET_ERROR)
+		{
+			// 发送缓冲已满，剩余的数据下一帧再发
+			if (CrySock::TranslateLastSocketError() == CrySock::eCSE_EWOULDBLOCK)
+				break;
+
+			return false;
+		}
+
+		sentBytes += static_cast<size_t>(result);
+	}
+
+	relay.pendingBytes.erase(relay.pendingBytes.begin(), relay.pendingBytes.begin() + sentBytes);
+	return true;
+}
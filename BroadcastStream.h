@@ -0,0 +1,88 @@
+#pragma once
+
+#include <CryNetwork/CrySocks.h>
+
+#include <deque>
+#include <vector>
+
+#include "TransformCodec.h"
+
+// 观战广播流
+// 服务器每个广播帧把整个世界(所有存活玩家的变换)编码一次，延迟一段时间后通过本机的TCP端口发布给中继进程，
+// 由中继(Tools/BroadcastRelay)把同一份数据转发给任意数量的观众，服务器的开销与观众数量无关
+// 观众以Tools/BroadcastViewer连接中继，解码并显示每帧的实体变换
+//
+// 流格式(小端)：每帧为 uint32 帧长度(不含自身) + SFrameHeader + count个uint32实体id + 编码后的变换(CTransformCodec默认格式)
+class CBroadcastStream
+{
+public:
+	static constexpr uint32 FrameMagic = 0x54534342; // 'BCST'
+
+	struct SFrameHeader
+	{
+		uint32 magic;
+		uint32 frameIndex;
+		// 采集时的服务器时间(秒)
+		float serverTime;
+		uint32 entityCount;
+	};
+
+	struct SEntityTransform
+	{
+		EntityId entityId;
+		QuatT transform;
+	};
+
+	~CBroadcastStream() { Close(); }
+
+	// 在本机回环地址上监听中继连接，port为0时关闭
+	bool Listen(uint16 port);
+	void Close();
+	bool IsListening() const { return m_listenSocket != CRY_INVALID_SOCKET; }
+	uint16 GetPort() const { return m_port; }
+
+	// 编码一帧并放入延迟队列，队列超过maxQueuedFrames时丢弃最早的帧(尚未发布，会告警)
+	// 调用方按延迟×采集速率给出maxQueuedFrames，使延迟内的帧都能等到发布
+	void Capture(float serverTime, const std::vector<SEntityTransform>& entities, size_t maxQueuedFrames);
+	// 接受新的中继连接，发布已到延迟时间的帧
+	void Update(float serverTime, float delay);
+
+	size_t GetRelayCount() const { return m_relays.size(); }
+	size_t GetQueuedFrameCount() const { return m_delayedFrames.size(); }
+
+protected:
+	struct SFrame
+	{
+		float captureTime;
+		std::vector<uint8> bytes;
+	};
+
+	struct SRelay
+	{
+		CRYSOCKET socket;
+		// 尚未发送完的数据
+		std::vector<uint8> pendingBytes;
+	};
+
+	void AcceptRelays();
+	void Publish(const SFrame& frame);
+	// 尽量发送待发数据，连接断开时返回false
+	bool FlushRelay(SRelay& relay);
+
+protected:
+	// 每个中继最多积压的字节数，超过时断开过慢的中继
+	static constexpr size_t MaxRelayBacklog = 4 * 1024 * 1024;
+
+	CTransformCodec m_codec;
+	CRYSOCKET m_listenSocket = CRY_INVALID_SOCKET;
+	uint16 m_port = 0;
+	std::vector<SRelay> m_relays;
+	std::deque<SFrame> m_delayedFrames;
+	uint32 m_frameIndex = 0;
+	// 自上次发布以来未发布就被丢弃的帧数，连续丢弃只告警一次
+	uint32 m_evictedFrameCount = 0;
+
+	// Capture复用的缓冲
+	std::vector<QuatT> m_transforms;
+	std::vector<uint8> m_encodedTransforms;
+};
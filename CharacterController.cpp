@@ -0,0 +1,369 @@
+#include "StdAfx.h"
+#include "CharacterController.h"
+#include "TerrainHeightCache.h"
+
+#include <CryPhysics/physinterface.h>
+#include <CryThreading/IJobManager.h>
+
+#include <algorithm>
+#include <functional>
+
+namespace
+{
+	// 每个作业处理的角色数量，以及一次解析最多拆分出的作业数量
+	constexpr size_t MovesPerJob = 64;
+	constexpr size_t MaxJobs = 32;
+}
+
+void CCharacterController::BuildStaticGeometry()
+{
+	std::vector<AABB> staticBoxes;
+
+	if (gEnv->pPhysicalWorld != nullptr)
+	{
+		const float terrainSize = static_cast<float>(gEnv->p3DEngine->GetTerrainSize());
+
+		IPhysicalEntity** ppEntities = nullptr;
+		const int entityCount = gEnv->pPhysicalWorld->GetEntitiesInBox(Vec3(0.f, 0.f, -1000.f), Vec3(terrainSize, terrainSize, 4000.f), ppEntities, ent_static);
+
+		staticBoxes.reserve(entityCount);
+		for (int i = 0; i < entityCount; ++i)
+		{
+			pe_params_bbox boundingBox;
+			if (ppEntities[i]->GetParams(&boundingBox) != 0)
+			{
+				staticBoxes.emplace_back(boundingBox.BBox[0], boundingBox.BBox[1]);
+			}
+		}
+	}
+
+	BuildStaticGeometry(std::move(staticBoxes));
+}
+
+void CCharacterController::BuildStaticGeometry(std::vector<AABB>&& staticBoxes)
+{
+	Clear();
+
+	// 忽略覆盖大片区域的物体，它们的包围盒会挡住所有移动
+	for (const AABB& box : staticBoxes)
+	{
+		if (box.max.x - box.min.x <= MaxStaticBoxExtent && box.max.y - box.min.y <= MaxStaticBoxExtent)
+		{
+			m_staticBoxes.push_back(box);
+		}
+	}
+
+	if (m_staticBoxes.empty())
+		return;
+
+	Vec2 gridMin(FLT_MAX, FLT_MAX);
+	Vec2 gridMax(-FLT_MAX, -FLT_MAX);
+	for (const AABB& box : m_staticBoxes)
+	{
+		gridMin.x = min(gridMin.x, box.min.x);
+		gridMin.y = min(gridMin.y, box.min.y);
+		gridMax.x = max(gridMax.x, box.max.x);
+		gridMax.y = max(gridMax.y, box.max.y);
+	}
+
+	m_gridOrigin = gridMin;
+	m_gridWidth = static_cast<int>((gridMax.x - gridMin.x) / GridCellSize) + 1;
+	m_gridHeight = static_cast<int>((gridMax.y - gridMin.y) / GridCellSize) + 1;
+
+	const auto forEachCell = [this](const AABB& box, const std::function<void(int cellIndex)>& func)
+	{
+		const int minX = static_cast<int>((box.min.x - m_gridOrigin.x) / GridCellSize);
+		const int minY = static_cast<int>((box.min.y - m_gridOrigin.y) / GridCellSize);
+		const int maxX = min(static_cast<int>((box.max.x - m_gridOrigin.x) / GridCellSize), m_gridWidth - 1);
+		const int maxY = min(static_cast<int>((box.max.y - m_gridOrigin.y) / GridCellSize), m_gridHeight - 1);
+
+		for (int y = minY; y <= maxY; ++y)
+		{
+			for (int x = minX; x <= maxX; ++x)
+			{
+				func(y * m_gridWidth + x);
+			}
+		}
+	};
+
+	// 两遍建立CSR：先统计每个单元的数量，再填入索引
+	m_cellStart.assign(m_gridWidth * m_gridHeight + 1, 0);
+	for (const AABB& box : m_staticBoxes)
+	{
+		forEachCell(box, [this](int cellIndex) { ++m_cellStart[cellIndex + 1]; });
+	}
+
+	for (size_t i = 1; i < m_cellStart.size(); ++i)
+	{
+		m_cellStart[i] += m_cellStart[i - 1];
+	}
+
+	m_cellBoxes.resize(m_cellStart.back());
+	std::vector<uint32> cellFill(m_cellStart.begin(), m_cellStart.end() - 1);
+	for (uint32 boxIndex = 0; boxIndex < m_staticBoxes.size(); ++boxIndex)
+	{
+		forEachCell(m_staticBoxes[boxIndex], [this, &cellFill, boxIndex](int cellIndex) { m_cellBoxes[cellFill[cellIndex]++] = boxIndex; });
+	}
+}
+
+void CCharacterController::Clear()
+{
+	m_staticBoxes.clear();
+	m_cellStart.clear();
+	m_cellBoxes.clear();
+	m_gridWidth = 0;
+	m_gridHeight = 0;
+}
+
+void CCharacterController::ResolveMoves(SMove* pMoves, size_t count, const CTerrainHeightCache& terrain) const
+{
+	if (count <= MovesPerJob || gEnv->pJobManager == nullptr)
+	{
+		std::vector<uint32> scratch;
+		ResolveRange(pMoves, count, terrain, scratch);
+		return;
+	}
+
+	const size_t jobCount = min((count + MovesPerJob - 1) / MovesPerJob, MaxJobs);
+	const size_t movesPerJob = (count + jobCount - 1) / jobCount;
+
+	// 前jobCount - 1段交给工作线程，最后一段在当前线程解析
+	JobManager::SJobState jobStates[MaxJobs];
+	for (size_t jobIndex = 0; jobIndex + 1 < jobCount; ++jobIndex)
+	{
+		SMove* pJobMoves = pMoves + jobIndex * movesPerJob;
+		gEnv->pJobManager->AddLambdaJob("CharacterController::ResolveMoves", [this, pJobMoves, movesPerJob, &terrain]()
+		{
+			std::vector<uint32> scratch;
+			ResolveRange(pJobMoves, movesPerJob, terrain, scratch);
+		}, JobManager::eRegularPriority, &jobStates[jobIndex]);
+	}
+
+	const size_t lastBegin = (jobCount - 1) * movesPerJob;
+	std::vector<uint32> scratch;
+	ResolveRange(pMoves + lastBegin, count - lastBegin, terrain, scratch);
+
+	for (size_t jobIndex = 0; jobIndex + 1 < jobCount; ++jobIndex)
+	{
+		gEnv->pJobManager->WaitForJob(jobStates[jobIndex]);
+	}
+}
+
+void CCharacterController::ResolveRange(SMove* pMoves, size_t count, const CTerrainHeightCache& terrain, std::vector<uint32>& scratch) const
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		ResolveMove(pMoves[i], terrain, scratch);
+	}
+}
+
+void CCharacterController::ResolveMove(SMove& move, const CTerrainHeightCache& terrain, std::vector<uint32>& scratch) const
+{
+	// 角色在地面上行走，只使用位移的水平部分
+	const Vec3 horizontalDisplacement(move.displacement.x, move.displacement.y, 0.f);
+
+	Vec3 position = SweepAndSlide(move.position, horizontalDisplacement, scratch);
+	position = ClipToTerrain(move.position, position, terrain);
+
+	// 地面高度取地形与脚下可站立的静态物体中较高者
+	float groundHeight = terrain.IsValid() ? terrain.GetHeight(position.x, position.y) : -FLT_MAX;
+
+	const AABB footArea(Vec3(position.x - m_params.radius, position.y - m_params.radius, position.z - m_params.height),
+		Vec3(position.x + m_params.radius, position.y + m_params.radius, position.z + m_params.stepHeight));
+	GatherCandidates(footArea, scratch);
+	for (const uint32 boxIndex : scratch)
+	{
+		const AABB& box = m_staticBoxes[boxIndex];
+		const bool bUnderFoot = position.x >= box.min.x - m_params.radius && position.x <= box.max.x + m_params.radius
+			&& position.y >= box.min.y - m_params.radius && position.y <= box.max.y + m_params.radius;
+
+		if (bUnderFoot && box.max.z <= position.z + m_params.stepHeight)
+		{
+			groundHeight = max(groundHeight, box.max.z);
+		}
+	}
+
+	// 重力，站在地面上时在台阶高度内向下吸附，走下坡时不会腾空
+	move.verticalVelocity -= m_params.gravity * move.timeStep;
+	position.z += move.verticalVelocity * move.timeStep;
+
+	const bool bSnapToGround = move.bGrounded && position.z - groundHeight <= m_params.stepHeight;
+	if (position.z <= groundHeight || bSnapToGround)
+	{
+		position.z = groundHeight;
+		move.verticalVelocity = 0.f;
+		move.bGrounded = true;
+	}
+	else
+	{
+		move.bGrounded = false;
+	}
+
+	move.position = position;
+}
+
+Vec3 CCharacterController::SweepAndSlide(const Vec3& start, const Vec3& displacement, std::vector<uint32>& scratch) const
+{
+	Vec3 position = start;
+	Vec3 remaining = displacement;
+
+	if (m_staticBoxes.empty())
+	{
+		return position + remaining;
+	}
+
+	for (int iteration = 0; iteration < m_params.maxSlideIterations; ++iteration)
+	{
+		const float remainingLength = remaining.GetLength();
+		if (remainingLength < 0.0001f)
+			break;
+
+		// 胶囊与包围盒的闵可夫斯基和近似为包围盒按半径与高度扩展，扫掠退化为线段与扩展盒求交
+		AABB sweptArea(position, position);
+		sweptArea.Add(position + remaining);
+		sweptArea.min -= Vec3(m_params.radius, m_params.radius, m_params.height);
+		sweptArea.max += Vec3(m_params.radius, m_params.radius, 0.f);
+		GatherCandidates(sweptArea, scratch);
+
+		float hitTime = 1.f;
+		Vec3 hitNormal(ZERO);
+
+		for (const uint32 boxIndex : scratch)
+		{
+			const AABB& box = m_staticBoxes[boxIndex];
+
+			// 低于台阶高度的物体可以直接走上去
+			if (box.max.z <= position.z + m_params.stepHeight)
+				continue;
+
+			// 竖直方向上不重叠
+			if (box.min.z >= position.z + m_params.height)
+				continue;
+
+			const Vec2 expandedMin(box.min.x - m_params.radius, box.min.y - m_params.radius);
+			const Vec2 expandedMax(box.max.x + m_params.radius, box.max.y + m_params.radius);
+
+			// 水平面上的slab求交
+			float enterTime = -FLT_MAX;
+			float exitTime = FLT_MAX;
+			Vec3 enterNormal(ZERO);
+			bool bMiss = false;
+
+			for (int axis = 0; axis < 2 && !bMiss; ++axis)
+			{
+				const float origin = position[axis];
+				const float direction = remaining[axis];
+				const float slabMin = axis == 0 ? expandedMin.x : expandedMin.y;
+				const float slabMax = axis == 0 ? expandedMax.x : expandedMax.y;
+
+				if (fabs_tpl(direction) < 1e-6f)
+				{
+					bMiss = origin <= slabMin || origin >= slabMax;
+					continue;
+				}
+
+				const float invDirection = 1.f / direction;
+				float nearTime = (slabMin - origin) * invDirection;
+				float farTime = (slabMax - origin) * invDirection;
+				float normalSign = -1.f;
+				if (nearTime > farTime)
+				{
+					std::swap(nearTime, farTime);
+					normalSign = 1.f;
+				}
+
+				if (nearTime > enterTime)
+				{
+					enterTime = nearTime;
+					enterNormal = ZERO;
+					enterNormal[axis] = normalSign;
+				}
+				exitTime = min(exitTime, farTime);
+				bMiss = enterTime > exitTime;
+			}
+
+			// 起点已在盒内时不阻挡，避免角色卡死在物体内部
+			if (bMiss || enterTime < 0.f || enterTime >= hitTime)
+				continue;
+
+			hitTime = enterTime;
+			hitNormal = enterNormal;
+		}
+
+		if (hitTime >= 1.f)
+		{
+			position += remaining;
+			break;
+		}
+
+		// 移动到接触点前skinWidth处，剩余位移去掉法线方向的分量后沿表面滑动
+		const float moveTime = max(hitTime - m_params.skinWidth / remainingLength, 0.f);
+		position += remaining * moveTime;
+		remaining *= 1.f - moveTime;
+		remaining -= hitNormal * remaining.Dot(hitNormal);
+	}
+
+	return position;
+}
+
+Vec3 CCharacterController::ClipToTerrain(const Vec3& start, const Vec3& end, const CTerrainHeightCache& terrain) const
+{
+	if (!terrain.IsValid())
+		return end;
+
+	const Vec3 displacement = end - start;
+	const float length = displacement.GetLength2D();
+	if (length < 0.0001f)
+		return end;
+
+	// 以不超过胶囊半径的步长沿位移检查地形，相邻样本之间的坡度(升高/水平距离)超过最大坡度时视为墙
+	// 坡度与每帧的位移长度无关：慢速走上陡坡同样被阻挡，快速走上缓坡不会被阻挡
+	const int stepCount = static_cast<int>(length / m_params.radius) + 1;
+	const float stepLength = length / static_cast<float>(stepCount);
+	const float maxRise = stepLength * tan_tpl(DEG2RAD(clamp_tpl(m_params.maxSlopeAngle, 0.f, 89.f)));
+
+	Vec3 lastValid = start;
+	float previousHeight = terrain.GetHeight(start.x, start.y);
+
+	for (int step = 1; step <= stepCount; ++step)
+	{
+		const Vec3 point = start + displacement * (static_cast<float>(step) / stepCount);
+		const float height = terrain.GetHeight(point.x, point.y);
+
+		// 低于脚下的地形(站在静态物体上或走下坡)不阻挡
+		if (height > start.z && height - previousHeight > maxRise)
+		{
+			return lastValid;
+		}
+		previousHeight = height;
+		lastValid = point;
+	}
+
+	return end;
+}
+
+void CCharacterController::GatherCandidates(const AABB& area, std::vector<uint32>& candidates) const
+{
+	candidates.clear();
+
+	if (m_cellStart.empty())
+		return;
+
+	const int minX = max(static_cast<int>((area.min.x - m_gridOrigin.x) / GridCellSize), 0);
+	const int minY = max(static_cast<int>((area.min.y - m_gridOrigin.y) / GridCellSize), 0);
+	const int maxX = min(static_cast<int>((area.max.x - m_gridOrigin.x) / GridCellSize), m_gridWidth - 1);
+	const int maxY = min(static_cast<int>((area.max.y - m_gridOrigin.y) / GridCellSize), m_gridHeight - 1);
+
+	for (int y = minY; y <= maxY; ++y)
+	{
+		for (int x = minX; x <= maxX; ++x)
+		{
+			const int cellIndex = y * m_gridWidth + x;
+			candidates.insert(candidates.end(), m_cellBoxes.begin() + m_cellStart[cellIndex], m_cellBoxes.begin() + m_cellStart[cellIndex + 1]);
+		}
+	}
+
+	// 跨越多个单元的包围盒只保留一次
+	std::sort(candidates.begin(), candidates.end());
+	candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <vector>
+
+class CTerrainHeightCache;
+
+// 轻量的运动学角色控制器
+// 玩家以竖直胶囊体表示，水平位移对静态几何体做扫掠(sweep)并沿碰撞面滑动，竖直方向受重力并落在地形高度场上
+// 静态几何体在关卡加载时收集为包围盒并建立均匀网格索引，解析过程只读取这些数据，可以批量在工作线程上并行执行
+class CCharacterController
+{
+public:
+	// 一个角色本帧的移动
+	struct SMove
+	{
+		// 输入为当前位置(胶囊底部)，输出为解析后的位置
+		Vec3 position;
+		// 本帧期望的水平位移
+		Vec3 displacement;
+		// 竖直速度，输入输出
+		float verticalVelocity;
+		// 输出：是否站在地面上
+		bool bGrounded;
+		// 本次积分的时长，降频模拟的玩家为自上次模拟以来累积的时间
+		float timeStep;
+	};
+
+	struct SParams
+	{
+		float radius = 0.4f;
+		float height = 1.8f;
+		// 可以直接走上的台阶高度
+		float stepHeight = 0.35f;
+		// 可以走上的最大地形坡度(度)
+		float maxSlopeAngle = 45.f;
+		float gravity = 9.81f;
+		// 与碰撞面保持的距离，避免下一帧从内部开始扫掠
+		float skinWidth = 0.01f;
+		int maxSlideIterations = 3;
+	};
+
+	// 从物理世界收集当前关卡的静态几何体
+	void BuildStaticGeometry();
+	// 以给定的包围盒建立静态几何体索引
+	void BuildStaticGeometry(std::vector<AABB>&& staticBoxes);
+	void Clear();
+
+	SParams& GetParams() { return m_params; }
+	size_t GetStaticBoxCount() const { return m_staticBoxes.size(); }
+
+	// 批量解析所有移动，数量较多时拆分为作业(job)在工作线程上并行执行
+	void ResolveMoves(SMove* pMoves, size_t count, const CTerrainHeightCache& terrain) const;
+
+protected:
+	// 解析连续的一段移动，scratch为候选包围盒的临时缓冲
+	void ResolveRange(SMove* pMoves, size_t count, const CTerrainHeightCache& terrain, std::vector<uint32>& scratch) const;
+	void ResolveMove(SMove& move, const CTerrainHeightCache& terrain, std::vector<uint32>& scratch) const;
+
+	// 水平扫掠并滑动，返回实际位移后的位置
+	Vec3 SweepAndSlide(const Vec3& start, const Vec3& displacement, std::vector<uint32>& scratch) const;
+	// 沿位移检查地形，遇到坡度超过maxSlopeAngle的上坡时截断位移
+	Vec3 ClipToTerrain(const Vec3& start, const Vec3& end, const CTerrainHeightCache& terrain) const;
+
+	// 收集与区域相交的静态包围盒索引(去重)
+	void GatherCandidates(const AABB& area, std::vector<uint32>& candidates) const;
+
+protected:
+	// 网格单元边长(米)
+	static constexpr float GridCellSize = 8.f;
+	// 水平尺寸超过此值的静态物体(通常是覆盖整个关卡的网格)不参与碰撞
+	static constexpr float MaxStaticBoxExtent = 128.f;
+
+	SParams m_params;
+
+	std::vector<AABB> m_staticBoxes;
+
+	// 网格索引(CSR)：单元i中的包围盒为m_cellBoxes[m_cellStart[i], m_cellStart[i + 1])
+	Vec2 m_gridOrigin = Vec2(ZERO);
+	int m_gridWidth = 0;
+	int m_gridHeight = 0;
+	std::vector<uint32> m_cellStart;
+	std::vector<uint32> m_cellBoxes;
+};
@@ -0,0 +1,158 @@
+#include "StdAfx.h"
+#include "ClockSync.h"
+
+bool CClockSync::ShouldSendRequest(const CTimeValue& now, float interval) const
+{
+	if (m_lastRequestTime.GetValue() == 0)
+		return true;
+
+	const float requestInterval = m_filterCount < FilterSize ? min(interval, static_cast<float>(InitialRequestInterval)) : interval;
+	return (now - m_lastRequestTime).GetSeconds() >= requestInterval;
+}
+
+void CClockSync::OnResponse(const CTimeValue& clientSendTime, const CTimeValue& serverReceiveTime, const CTimeValue& serverSendTime, const CTimeValue& clientReceiveTime)
+{
+	const double t0 = clientSendTime.GetSeconds();
+	const double t1 = serverReceiveTime.GetSeconds();
+	const double t2 = serverSendTime.GetSeconds();
+	const double t3 = clientReceiveTime.GetSeconds();
+
+	// 往返时间不含服务器处理时间，偏移为两个单程差值的平均
+	const SSample sample{ (t0 + t3) * 0.5, (t3 - t0) - (t2 - t1), ((t1 - t0) + (t2 - t3)) * 0.5 };
+	if (sample.roundTripTime < 0.0 || t3 < t0)
+		return;
+
+	m_filter[m_filterNext] = sample;
+	m_filterNext = (m_filterNext + 1) % FilterSize;
+	m_filterCount = min(m_filterCount + 1, static_cast<size_t>(FilterSize));
+	++m_sampleCount;
+
+	// 往返时间最短的样本受排队延迟与不对称路径的影响最小
+	const SSample* pBest = &m_filter[0];
+	for (size_t i = 1; i < m_filterCount; ++i)
+	{
+		if (m_filter[i].roundTripTime < pBest->roundTripTime)
+		{
+			pBest = &m_filter[i];
+		}
+	}
+
+	m_roundTripTime = static_cast<float>(pBest->roundTripTime);
+	m_offset = static_cast<float>(pBest->offset);
+
+	if (pBest->localTime == m_lastSelectedTime)
+		return;
+
+	m_lastSelectedTime = pBest->localTime;
+	m_driftSamples[m_driftNext] = *pBest;
+	m_driftNext = (m_driftNext + 1) % DriftWindow;
+	m_driftCount = min(m_driftCount + 1, static_cast<size_t>(DriftWindow));
+
+	FitDrift();
+	m_bSynchronized = true;
+}
+
+void CClockSync::FitDrift()
+{
+	const SSample& newest = m_driftSamples[(m_driftNext + DriftWindow - 1) % DriftWindow];
+
+	double minTime = newest.localTime;
+	double meanTime = 0.0;
+	double meanOffset = 0.0;
+	for (size_t i = 0; i < m_driftCount; ++i)
+	{
+		minTime = min(minTime, m_driftSamples[i].localTime);
+		meanTime += m_driftSamples[i].localTime;
+		meanOffset += m_driftSamples[i].offset;
+	}
+	meanTime /= static_cast<double>(m_driftCount);
+	meanOffset /= static_cast<double>(m_driftCount);
+
+	// 样本覆盖的时间太短时漂移无法与噪声区分，只使用最新的偏移
+	if (m_driftCount < MinDriftSamples || newest.localTime - minTime < MinDriftSpan)
+	{
+		m_modelTime = newest.localTime;
+		m_modelOffset = newest.offset;
+		m_drift = 0.0;
+		return;
+	}
+
+	double covariance = 0.0;
+	double variance = 0.0;
+	for (size_t i = 0; i < m_driftCount; ++i)
+	{
+		const double dt = m_driftSamples[i].localTime - meanTime;
+		covariance += dt * (m_driftSamples[i].offset - meanOffset);
+		variance += dt * dt;
+	}
+
+	m_drift = variance > 0.0 ? clamp_tpl(covariance / variance, -MaxDrift, static_cast<double>(MaxDrift)) : 0.0;
+	m_modelTime = meanTime;
+	m_modelOffset = meanOffset;
+}
+
+void CClockSync::Update(const CTimeValue& frameStartTime)
+{
+	if (gEnv->bServer)
+	{
+		m_localFrameTime = frameStartTime;
+		m_serverFrameTime = frameStartTime;
+		return;
+	}
+
+	const double localTime = frameStartTime.GetSeconds();
+	const double targetTime = localTime + (m_bSynchronized ? EstimateOffset(localTime) : 0.0);
+
+	// 第一次同步时直接采用估计值，此前的时间只是本地时间，不要求单调
+	if (!m_bHasFrameTime)
+	{
+		m_localFrameTime = frameStartTime;
+		m_serverFrameTime = CTimeValue(targetTime);
+		m_bHasFrameTime = m_bSynchronized;
+		return;
+	}
+
+	const double elapsed = max((frameStartTime - m_localFrameTime).GetSeconds(), 0.0);
+	const double freeRunningTime = m_serverFrameTime.GetSeconds() + elapsed;
+	const double error = targetTime - freeRunningTime;
+
+	// 落后太多时直接跳到估计值，其余情况以有限速率校正，服务器时间永不倒退
+	double serverTime = freeRunningTime;
+	if (error > StepThreshold)
+	{
+		serverTime = targetTime;
+	}
+	else
+	{
+		const double maxCorrection = elapsed * SlewRate;
+		serverTime += clamp_tpl(error, -maxCorrection, maxCorrection);
+	}
+
+	m_localFrameTime = frameStartTime;
+	m_serverFrameTime = CTimeValue(serverTime);
+}
+
+void CClockSync::Reset()
+{
+	m_filterCount = 0;
+	m_filterNext = 0;
+	m_lastSelectedTime = -1.0;
+	m_driftCount = 0;
+	m_driftNext = 0;
+	m_modelTime = 0.0;
+	m_modelOffset = 0.0;
+	m_drift = 0.0;
+	m_bSynchronized = false;
+	m_roundTripTime = 0.f;
+	m_offset = 0.f;
+	m_sampleCount = 0;
+	m_lastRequestTime = CTimeValue();
+	m_bHasFrameTime = false;
+	m_channelRoundTripTimes.clear();
+}
+
+float CClockSync::GetChannelRoundTripTime(int channelId) const
+{
+	auto it = m_channelRoundTripTimes.find(channelId);
+	return it != m_channelRoundTripTimes.end() ? it->second : 0.f;
+}
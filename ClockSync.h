@@ -0,0 +1,99 @@
+#pragma once
+
+#include <array>
+#include <unordered_map>
+
+// 网络时钟同步
+// 客户端定期经本地玩家向服务器发送请求，以NTP的四个时间戳(客户端发送t0、服务器收到t1、服务器回复t2、客户端收到t3)计算往返时间与时钟偏移
+// 最近若干个样本中往返时间最短的一个排队最少，以它的偏移为准；对较长时间内的偏移做最小二乘拟合得到时钟漂移
+// 对外的服务器时间只向前走：小的误差以有限的速率平滑校正(slew)，大的向前误差直接跳变
+//
+// 服务器以自己的GetAsyncTime为基准，服务器上估计值即本地时间；同时按频道记录客户端报告的往返时间，供延迟补偿等使用
+class CClockSync
+{
+public:
+	// 客户端：是否应该发送下一个请求，尚未同步时以较短的间隔发送
+	bool ShouldSendRequest(const CTimeValue& now, float interval) const;
+	void OnRequestSent(const CTimeValue& now) { m_lastRequestTime = now; }
+	// 客户端：收到服务器的回复，时间戳为t0..t3
+	void OnResponse(const CTimeValue& clientSendTime, const CTimeValue& serverReceiveTime, const CTimeValue& serverSendTime, const CTimeValue& clientReceiveTime);
+
+	// 每帧以帧开始时间调用一次，推进平滑校正后的服务器时间
+	void Update(const CTimeValue& frameStartTime);
+	void Reset();
+
+	// 本帧开始时的估计服务器时间，同步后单调递增
+	CTimeValue GetServerTime() const { return m_serverFrameTime; }
+	// 把本地时间(如输入事件的时间戳)换算为服务器时间，与本帧使用相同的偏移
+	CTimeValue ToServerTime(const CTimeValue& localTime) const { return localTime + (m_serverFrameTime - m_localFrameTime); }
+	// 本帧开始时的服务器tick编号，tickRate为每秒tick数
+	int64 GetServerTick(int tickRate) const { return static_cast<int64>(floor(m_serverFrameTime.GetSeconds() * static_cast<double>(tickRate))); }
+
+	bool IsSynchronized() const { return m_bSynchronized; }
+	// 最近一次选中样本的往返时间与偏移(秒)
+	float GetRoundTripTime() const { return m_roundTripTime; }
+	float GetOffset() const { return m_offset; }
+	// 拟合的时钟漂移(百万分之一)
+	float GetDriftPpm() const { return static_cast<float>(m_drift * 1e6); }
+	uint32 GetSampleCount() const { return m_sampleCount; }
+
+	// 服务器：客户端在请求中报告的往返时间
+	void OnClientReport(int channelId, float roundTripTime) { m_channelRoundTripTimes[channelId] = roundTripTime; }
+	// 没有报告时返回0
+	float GetChannelRoundTripTime(int channelId) const;
+	void RemoveChannel(int channelId) { m_channelRoundTripTimes.erase(channelId); }
+	const std::unordered_map<int, float>& GetChannelRoundTripTimes() const { return m_channelRoundTripTimes; }
+
+protected:
+	struct SSample
+	{
+		// 样本在本地时钟上的时间(t0与t3的中点)
+		double localTime;
+		double roundTripTime;
+		double offset;
+	};
+
+	// 选择最短往返时间的样本窗口
+	static constexpr size_t FilterSize = 8;
+	// 拟合漂移使用的已选样本数，以及开始拟合前需要覆盖的时长(秒)
+	static constexpr size_t DriftWindow = 16;
+	static constexpr size_t MinDriftSamples = 4;
+	static constexpr double MinDriftSpan = 10.0;
+	static constexpr double MaxDrift = 500e-6;
+	// 平滑校正的最大速率(相对于经过的时间)，以及向前直接跳变的阈值(秒)
+	static constexpr double SlewRate = 0.05;
+	static constexpr double StepThreshold = 0.25;
+	// 尚未同步时的请求间隔(秒)
+	static constexpr float InitialRequestInterval = 0.25f;
+
+	void FitDrift();
+	// 以模型估计的本地时间localTime处的偏移(秒)
+	double EstimateOffset(double localTime) const { return m_modelOffset + m_drift * (localTime - m_modelTime); }
+
+	std::array<SSample, FilterSize> m_filter;
+	size_t m_filterCount = 0;
+	size_t m_filterNext = 0;
+	// 上一次选中的样本时间，同一样本不重复加入漂移窗口
+	double m_lastSelectedTime = -1.0;
+
+	std::array<SSample, DriftWindow> m_driftSamples;
+	size_t m_driftCount = 0;
+	size_t m_driftNext = 0;
+
+	// 偏移模型：offset(t) = m_modelOffset + m_drift * (t - m_modelTime)
+	double m_modelTime = 0.0;
+	double m_modelOffset = 0.0;
+	double m_drift = 0.0;
+
+	bool m_bSynchronized = false;
+	float m_roundTripTime = 0.f;
+	float m_offset = 0.f;
+	uint32 m_sampleCount = 0;
+	CTimeValue m_lastRequestTime;
+
+	CTimeValue m_localFrameTime;
+	CTimeValue m_serverFrameTime;
+	bool m_bHasFrameTime = false;
+
+	std::unordered_map<int, float> m_channelRoundTripTimes;
+};
@@ -0,0 +1,168 @@
+#include "StdAfx.h"
+#include "FlightRecorder.h"
+
+#include <CrySystem/File/ICryPak.h>
+
+namespace
+{
+	const char* const s_sectionNames[] =
+	{
+		"admission",
+		"movement",
+		"lockstep",
+		"zones",
+		"replication",
+		"broadcast",
+		"level",
+		"timers"
+	};
+
+	static_assert(CRY_ARRAY_COUNT(s_sectionNames) == CFlightRecorder::SectionCount, "Missing flight recorder section name");
+
+	uint32 ToMicroseconds(const CTimeValue& duration)
+	{
+		return static_cast<uint32>(max(duration.GetMicroSecondsAsInt64(), static_cast<int64>(0)));
+	}
+}
+
+void CFlightRecorder::BeginTick()
+{
+	m_tickStartTime = gEnv->pTimer->GetAsyncTime();
+
+	memset(&m_currentRecord, 0, sizeof(m_currentRecord));
+	m_currentRecord.frameId = gEnv->nMainFrameID;
+	m_currentRecord.serverTimeMs = static_cast<uint32>(gEnv->pTimer->GetFrameStartTime().GetMilliSecondsAsInt64());
+	m_currentRecord.frameMicroseconds = m_bHasPreviousTick ? ToMicroseconds(m_tickStartTime - m_previousTickStartTime) : 0;
+
+	m_previousTickStartTime = m_tickStartTime;
+	m_bHasPreviousTick = true;
+}
+
+void CFlightRecorder::EndTick(size_t playerCount, uint32 replicatedBytes, float spikeThresholdMs, float dumpSeconds)
+{
+	m_currentRecord.updateMicroseconds = ToMicroseconds(gEnv->pTimer->GetAsyncTime() - m_tickStartTime);
+	m_currentRecord.replicatedBytes = replicatedBytes;
+	m_currentRecord.playerCount = static_cast<uint16>(min(playerCount, static_cast<size_t>(0xFFFF)));
+	m_currentRecord.connects = static_cast<uint8>(min(m_connects.exchange(0, std::memory_order_relaxed), 0xFFu));
+	m_currentRecord.disconnects = static_cast<uint8>(min(m_disconnects.exchange(0, std::memory_order_relaxed), 0xFFu));
+
+	// 本模块累计分配的字节数，差值即上一个tick以来的分配
+	CryModuleMemoryInfo memoryInfo;
+	memset(&memoryInfo, 0, sizeof(memoryInfo));
+	CryModuleGetMemoryInfo(&memoryInfo);
+	m_currentRecord.allocatedBytes = static_cast<uint32>(min<uint64>(memoryInfo.allocated - m_lastAllocatedBytes, 0xFFFFFFFFu));
+	m_lastAllocatedBytes = memoryInfo.allocated;
+
+	// 先写入记录再发布索引，读者只读取已发布的记录
+	const uint32 writeIndex = m_writeIndex.load(std::memory_order_relaxed);
+	m_records[writeIndex % Capacity] = m_currentRecord;
+	m_writeIndex.store(writeIndex + 1, std::memory_order_release);
+
+	if (spikeThresholdMs <= 0.f)
+		return;
+
+	const uint32 thresholdMicroseconds = static_cast<uint32>(spikeThresholdMs * 1000.f);
+	if (m_currentRecord.frameMicroseconds < thresholdMicroseconds && m_currentRecord.updateMicroseconds < thresholdMicroseconds)
+		return;
+
+	// 持续卡顿时只写出第一次
+	const CTimeValue now = gEnv->pTimer->GetAsyncTime();
+	if (m_bHasAutoDumped && (now - m_lastAutoDumpTime).GetSeconds() < AutoDumpCooldown)
+		return;
+
+	m_lastAutoDumpTime = now;
+	m_bHasAutoDumped = true;
+
+	CryLogAlways("[FlightRecorder] Tick took %.1f ms (frame %.1f ms), over the %.1f ms threshold",
+		static_cast<float>(m_currentRecord.updateMicroseconds) / 1000.f, static_cast<float>(m_currentRecord.frameMicroseconds) / 1000.f, spikeThresholdMs);
+	Dump(dumpSeconds, static_cast<uint32>(spikeThresholdMs));
+}
+
+void CFlightRecorder::AddSectionTime(ESection section, const CTimeValue& duration)
+{
+	uint16& sectionMicroseconds = m_currentRecord.sectionMicroseconds[static_cast<size_t>(section)];
+	sectionMicroseconds = static_cast<uint16>(min(static_cast<uint32>(sectionMicroseconds) + ToMicroseconds(duration), 0xFFFFu));
+}
+
+bool CFlightRecorder::Dump(float seconds, uint32 triggerThresholdMs)
+{
+	// 快照缓冲只有一份，上一次写出完成前不开始新的写出
+	if (IsDumping())
+	{
+		CryLogAlways("[FlightRecorder] Previous dump is still being written, skipped");
+		return false;
+	}
+
+	const uint32 writeIndex = m_writeIndex.load(std::memory_order_acquire);
+	const uint32 availableCount = min(writeIndex, Capacity);
+	if (availableCount == 0)
+		return false;
+
+	// 从最新的记录往回，直到覆盖所要求的时长
+	const uint32 newestTimeMs = m_records[(writeIndex - 1) % Capacity].serverTimeMs;
+	const uint32 requestedMs = static_cast<uint32>(max(seconds, 0.f) * 1000.f);
+
+	uint32 recordCount = 1;
+	while (recordCount < availableCount && newestTimeMs - m_records[(writeIndex - 1 - recordCount) % Capacity].serverTimeMs <= requestedMs)
+	{
+		++recordCount;
+	}
+
+	// 环形缓冲中的记录最多分为两段连续的内存
+	const uint32 firstIndex = (writeIndex - recordCount) % Capacity;
+	const uint32 firstCount = min(recordCount, Capacity - firstIndex);
+	memcpy(m_dumpRecords, m_records + firstIndex, firstCount * sizeof(STickRecord));
+	memcpy(m_dumpRecords + firstCount, m_records, (recordCount - firstCount) * sizeof(STickRecord));
+
+	memset(&m_dumpHeader, 0, sizeof(m_dumpHeader));
+	m_dumpHeader.magic = FileMagic;
+	m_dumpHeader.version = FileVersion;
+	m_dumpHeader.recordSize = sizeof(STickRecord);
+	m_dumpHeader.sectionCount = SectionCount;
+	m_dumpHeader.recordCount = recordCount;
+	m_dumpHeader.triggerThresholdMs = triggerThresholdMs;
+	for (size_t i = 0; i < SectionCount; ++i)
+	{
+		cry_strcpy(m_dumpHeader.sectionNames[i], s_sectionNames[i]);
+	}
+
+	cry_sprintf(m_dumpPath, "%%USER%%/FlightRecorder/flight_%u.frec", m_dumpRecords[recordCount - 1].frameId);
+
+	// 文件IO在作业中进行，没有作业管理器时直接写出
+	if (gEnv->pJobManager != nullptr)
+	{
+		gEnv->pJobManager->AddLambdaJob("FlightRecorder::WriteDump", [this]() { WriteDump(); }, JobManager::eStreamPriority, &m_dumpJobState);
+	}
+	else
+	{
+		WriteDump();
+	}
+	return true;
+}
+
+CFlightRecorder::~CFlightRecorder()
+{
+	if (gEnv->pJobManager != nullptr)
+	{
+		gEnv->pJobManager->WaitForJob(m_dumpJobState);
+	}
+}
+
+void CFlightRecorder::WriteDump()
+{
+	gEnv->pCryPak->MakeDir("%USER%/FlightRecorder");
+
+	FILE* pFile = gEnv->pCryPak->FOpen(m_dumpPath, "wb");
+	if (pFile == nullptr)
+	{
+		CryWarning(VALIDATOR_MODULE_GAME, VALIDATOR_WARNING, "[FlightRecorder] Failed to open %s for writing", m_dumpPath);
+		return;
+	}
+
+	gEnv->pCryPak->FWrite(&m_dumpHeader, sizeof(m_dumpHeader), 1, pFile);
+	gEnv->pCryPak->FWrite(m_dumpRecords, sizeof(STickRecord), m_dumpHeader.recordCount, pFile);
+	gEnv->pCryPak->FClose(pFile);
+
+	m_dumpCount.fetch_add(1, std::memory_order_relaxed);
+	CryLogAlways("[FlightRecorder] Wrote %u ticks to %s", m_dumpHeader.recordCount, m_dumpPath);
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <CryThreading/IJobManager.h>
+
+#include <atomic>
+
+// 飞行记录器
+// 始终运行，每个tick把各分段耗时、玩家数量、连接与断开、复制字节数与内存分配写成一条定长记录，放入固定大小的环形缓冲
+// 写入只在主线程进行，连接等事件计数可在任意线程累加，整个过程无锁也不分配内存
+// tick超过阈值或执行控制台命令时把最近若干秒的记录复制到预先分配的快照缓冲，由作业写入磁盘，主线程不分配也不做文件IO
+// 写出的文件由Tools/FlightRecorderDump转换为可读的时间线
+//
+// 文件格式(小端)：SFileHeader + recordCount个STickRecord
+class CFlightRecorder
+{
+public:
+	static constexpr uint32 FileMagic = 0x43455246; // 'FREC'
+	static constexpr uint32 FileVersion = 1;
+
+	// MainUpdate中分别计时的分段
+	enum class ESection : uint8
+	{
+		Admission = 0,
+		Movement,
+		Lockstep,
+		Zones,
+		Replication,
+		Broadcast,
+		Level,
+		Timers,
+
+		Count
+	};
+
+	static constexpr size_t SectionCount = static_cast<size_t>(ESection::Count);
+	static constexpr size_t SectionNameLength = 16;
+
+	struct STickRecord
+	{
+		uint32 frameId;
+		// 服务器时间(毫秒)
+		uint32 serverTimeMs;
+		// 从上一个tick开始到此tick开始的间隔，包含引擎其余部分的耗时
+		uint32 frameMicroseconds;
+		// 插件MainUpdate的耗时
+		uint32 updateMicroseconds;
+		// 复制调度器本tick刷新的预计字节数
+		uint32 replicatedBytes;
+		// 本模块在上一个tick中分配的字节数
+		uint32 allocatedBytes;
+		// 各分段耗时，超过65535微秒时饱和
+		uint16 sectionMicroseconds[SectionCount];
+		uint16 playerCount;
+		uint8 connects;
+		uint8 disconnects;
+	};
+	static_assert(sizeof(STickRecord) == 44, "Tools/FlightRecorderDump reads this layout");
+
+	struct SFileHeader
+	{
+		uint32 magic;
+		uint32 version;
+		uint32 recordSize;
+		uint32 sectionCount;
+		uint32 recordCount;
+		// 触发写出的tick的耗时阈值(毫秒)，手动写出时为0
+		uint32 triggerThresholdMs;
+		char sectionNames[SectionCount][SectionNameLength];
+	};
+
+	// 在作用域内计时一个分段
+	class CSectionScope
+	{
+	public:
+		CSectionScope(CFlightRecorder& recorder, ESection section)
+			: m_recorder(recorder)
+			, m_section(section)
+			, m_startTime(gEnv->pTimer->GetAsyncTime())
+		{}
+		~CSectionScope() { m_recorder.AddSectionTime(m_section, gEnv->pTimer->GetAsyncTime() - m_startTime); }
+
+	private:
+		CFlightRecorder& m_recorder;
+		ESection m_section;
+		CTimeValue m_startTime;
+	};
+
+	CFlightRecorder() = default;
+	// 等待仍在进行的写出
+	~CFlightRecorder();
+
+	CFlightRecorder(const CFlightRecorder&) = delete;
+	CFlightRecorder& operator=(const CFlightRecorder&) = delete;
+
+	void BeginTick();
+	// 结束当前tick并写入环形缓冲，tick耗时超过spikeThresholdMs(大于0时)时自动写出最近dumpSeconds秒
+	void EndTick(size_t playerCount, uint32 replicatedBytes, float spikeThresholdMs, float dumpSeconds);
+
+	void AddSectionTime(ESection section, const CTimeValue& duration);
+	// 可在任意线程调用
+	void OnConnect() { m_connects.fetch_add(1, std::memory_order_relaxed); }
+	void OnDisconnect() { m_disconnects.fetch_add(1, std::memory_order_relaxed); }
+
+	// 把最近seconds秒的记录复制到快照缓冲，由作业写入%USER%/FlightRecorder
+	// 返回是否开始写出，没有记录或上一次写出仍在进行时返回false
+	bool Dump(float seconds, uint32 triggerThresholdMs = 0);
+	bool IsDumping() const { return m_dumpJobState.IsRunning(); }
+
+	uint32 GetRecordedTickCount() const { return m_writeIndex.load(std::memory_order_acquire); }
+	uint32 GetDumpCount() const { return m_dumpCount.load(std::memory_order_relaxed); }
+
+protected:
+	// 2的幂，60Hz下约68秒
+	static constexpr uint32 Capacity = 4096;
+	// 持续卡顿时两次自动写出之间的最短间隔(秒)
+	static constexpr float AutoDumpCooldown = 30.f;
+
+	STickRecord m_records[Capacity];
+	// 已写入的记录总数，记录i位于m_records[i % Capacity]
+	std::atomic<uint32> m_writeIndex{ 0 };
+
+	STickRecord m_currentRecord;
+	CTimeValue m_tickStartTime;
+	CTimeValue m_previousTickStartTime;
+	bool m_bHasPreviousTick = false;
+	uint64 m_lastAllocatedBytes = 0;
+
+	std::atomic<uint32> m_connects{ 0 };
+	std::atomic<uint32> m_disconnects{ 0 };
+
+	CTimeValue m_lastAutoDumpTime;
+	bool m_bHasAutoDumped = false;
+	std::atomic<uint32> m_dumpCount{ 0 };
+
+	// 写出作业使用的快照，作业运行期间主线程不修改
+	void WriteDump();
+
+	SFileHeader m_dumpHeader;
+	STickRecord m_dumpRecords[Capacity];
+	char m_dumpPath[64];
+	JobManager::SJobState m_dumpJobState;
+};
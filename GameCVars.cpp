@@ -0,0 +1,143 @@
+#include "StdAfx.h"
+#include "GameCVars.h"
+
+#include <CrySystem/IConsole.h>
+
+void SGameCVars::Register()
+{
+	REGISTER_CVAR2("g_reconnectGracePeriod", &g_reconnectGracePeriod, g_reconnectGracePeriod, VF_NULL,
+		"Seconds a disconnected player's entity is kept dormant for a fast reconnect. 0 disables the reconnect cache.");
+	REGISTER_CVAR2("g_levelPreload", &g_levelPreload, g_levelPreload, VF_NULL,
+		"Stream a level's resources in the background before switching to it.");
+
+	REGISTER_CVAR2("g_maxPlayers", &g_maxPlayers, g_maxPlayers, VF_NULL,
+		"Maximum number of players admitted to the server.");
+	REGISTER_CVAR2("g_admissionTickBudget", &g_admissionTickBudget, g_admissionTickBudget, VF_NULL,
+		"Average time in milliseconds the server spends in its game update per tick, excluding the frame cap sleep, above which new connections are queued instead of admitted. 0 disables the check.");
+	REGISTER_CVAR2("g_admissionRatePerTick", &g_admissionRatePerTick, g_admissionRatePerTick, VF_NULL,
+		"Maximum number of queued connections admitted per tick.");
+	REGISTER_CVAR2("g_admissionQueueSize", &g_admissionQueueSize, g_admissionQueueSize, VF_NULL,
+		"Maximum number of connections waiting for admission. Further connections are rejected.");
+
+	REGISTER_CVAR2("g_terrainCacheSpacing", &g_terrainCacheSpacing, g_terrainCacheSpacing, VF_NULL,
+		"Sample spacing in meters of the terrain height cache built at level load. Takes effect on the next level load.\n"
+		"Lockstep ground heights are looked up in this cache, so every peer must use the same value.");
+	REGISTER_CVAR2("g_groundClamp", &g_groundClamp, g_groundClamp, VF_NULL,
+		"Clamp every alive player to the cached terrain height each tick. Only used when g_characterController is 0.");
+	REGISTER_CVAR2("g_characterController", &g_characterController, g_characterController, VF_NULL,
+		"Resolve player movement with the swept-capsule character controller (static geometry, terrain and gravity).");
+	REGISTER_CVAR2("g_maxSlopeAngle", &g_maxSlopeAngle, g_maxSlopeAngle, VF_NULL,
+		"Steepest terrain slope in degrees the character controller lets a player walk up. Steeper slopes block movement like walls.");
+	REGISTER_CVAR2("g_playerSeparation", &g_playerSeparation, g_playerSeparation, VF_NULL,
+		"Fraction of the overlap between two player capsules removed each tick. 0 disables player-vs-player collision.");
+	REGISTER_CVAR2("g_spawnSpacing", &g_spawnSpacing, g_spawnSpacing, VF_NULL,
+		"Spacing in meters of the spiral spawn pattern around the map center.");
+	REGISTER_CVAR2("g_spawnPointCount", &g_spawnPointCount, g_spawnPointCount, VF_NULL,
+		"Number of spawn points on the spiral. Spawns cycle through them, so repeated respawns stay near the spawn center.");
+
+	REGISTER_CVAR2("g_simulationLod", &g_simulationLod, g_simulationLod, VF_NULL,
+		"Simulate players far from every observer (local camera on clients, real players on the server) at a reduced tick rate.");
+	REGISTER_CVAR2("g_simulationLodDistance1", &g_simulationLodDistance1, g_simulationLodDistance1, VF_NULL,
+		"Distance in meters from the nearest observer beyond which players are simulated every 2nd tick.");
+	REGISTER_CVAR2("g_simulationLodDistance2", &g_simulationLodDistance2, g_simulationLodDistance2, VF_NULL,
+		"Distance in meters from the nearest observer beyond which players are simulated every 4th tick.");
+	REGISTER_CVAR2("g_simulationLodDistance3", &g_simulationLodDistance3, g_simulationLodDistance3, VF_NULL,
+		"Distance in meters from the nearest observer beyond which players are simulated every 8th tick.");
+
+	REGISTER_CVAR2("g_replicationScheduler", &g_replicationScheduler, g_replicationScheduler, VF_NULL,
+		"Schedule server-side aspect replication by priority within a per-client byte budget. 0 marks aspects dirty immediately.");
+	REGISTER_CVAR2("g_replicationBudget", &g_replicationBudget, g_replicationBudget, VF_NULL,
+		"Bytes per second of scheduled aspect updates each remote client may receive.");
+	REGISTER_CVAR2("g_replicationDistanceScale", &g_replicationDistanceScale, g_replicationDistanceScale, VF_NULL,
+		"Distance in meters at which an entity's replication priority has dropped to half of a nearby entity's.");
+	REGISTER_CVAR2("g_precisionLodDistance", &g_precisionLodDistance, g_precisionLodDistance, VF_NULL,
+		"Distance in meters beyond which player transforms are replicated with 16-bit fixed-point positions and yaw-only rotation.");
+	REGISTER_CVAR2("g_movementSendRate", &g_movementSendRate, g_movementSendRate, VF_NULL,
+		"Maximum number of player movement updates sent per second. 0 sends at tick rate. Status changes are not limited.");
+	REGISTER_CVAR2("g_snapshotCache", &g_snapshotCache, g_snapshotCache, VF_NULL,
+		"Batch-encode every player's movement once per frame for each precision profile, and copy each player's bytes into every channel.\n"
+		"0 encodes each player separately for every channel, for comparison.");
+	REGISTER_CVAR2("g_broadcastPort", &g_broadcastPort, g_broadcastPort, VF_NULL,
+		"Loopback TCP port the shared spectator stream is published on for broadcast relays. 0 disables broadcasting.");
+	REGISTER_CVAR2("g_broadcastDelay", &g_broadcastDelay, g_broadcastDelay, VF_NULL,
+		"Delay in seconds before a captured spectator frame is published to relays.");
+	REGISTER_CVAR2("g_broadcastRate", &g_broadcastRate, g_broadcastRate, VF_NULL,
+		"Number of spectator frames captured per second. 0 captures every tick.");
+	REGISTER_CVAR2("g_zoneCount", &g_zoneCount, g_zoneCount, VF_NULL,
+		"Number of zone server processes the map is split into along the X axis. 1 disables zoning.\n"
+		"Run one process per zone on the same host, each with its own sv_port and g_zoneIndex.");
+	REGISTER_CVAR2("g_zoneIndex", &g_zoneIndex, g_zoneIndex, VF_NULL,
+		"Zone owned by this server process, 0 to g_zoneCount - 1.");
+	REGISTER_CVAR2("g_zoneBasePort", &g_zoneBasePort, g_zoneBasePort, VF_NULL,
+		"Zone processes link to each other over 127.0.0.1 on g_zoneBasePort + g_zoneIndex.");
+	REGISTER_CVAR2("g_zoneGhostDistance", &g_zoneGhostDistance, g_zoneGhostDistance, VF_NULL,
+		"Players closer than this distance in meters to a zone border are ghosted to the neighbouring zone.");
+	REGISTER_CVAR2("g_zoneHandoffMargin", &g_zoneHandoffMargin, g_zoneHandoffMargin, VF_NULL,
+		"Distance in meters a player must cross past a zone border before it is handed off to the neighbouring zone.");
+	REGISTER_CVAR2("g_zoneHandoffTimeout", &g_zoneHandoffTimeout, g_zoneHandoffTimeout, VF_NULL,
+		"Seconds a handed off player waits in the destination zone for its client to reconnect.");
+	REGISTER_CVAR2("g_lockstep", &g_lockstep, g_lockstep, VF_NULL,
+		"Deterministic lockstep/rollback mode: only player inputs cross the network and every peer simulates player movement in fixed point.\n"
+		"Must be set on the server and every client before the match starts.");
+	REGISTER_CVAR2("g_lockstepTickRate", &g_lockstepTickRate, g_lockstepTickRate, VF_NULL,
+		"Fixed simulation ticks per second in lockstep mode. Must match on every peer.");
+	REGISTER_CVAR2("g_lockstepPrediction", &g_lockstepPrediction, g_lockstepPrediction, VF_NULL,
+		"Ticks remote players are predicted past their last received input in lockstep mode. Late inputs roll the player back and re-simulate.");
+	REGISTER_CVAR2("g_lockstepChecksumInterval", &g_lockstepChecksumInterval, g_lockstepChecksumInterval, VF_NULL,
+		"Lockstep ticks between client checksum reports. The server only sends a player's authoritative state to clients whose rolling checksum diverged. 0 disables desync detection. Lockstep mode only, regular mode keeps replicating movement to every channel.");
+	REGISTER_CVAR2("g_clockSyncInterval", &g_clockSyncInterval, g_clockSyncInterval, VF_NULL,
+		"Seconds between clock synchronization requests once a client is synchronized with the server. Requests are sent faster until the filter is full.");
+	REGISTER_CVAR2("g_inputBindings", &g_inputBindings, g_inputBindings, VF_NULL,
+		"Local player key rebinding as comma separated action=key pairs, e.g. \"moveforward=up,moveback=down\". Key names are input symbol names. Applied when the local player spawns.");
+	REGISTER_CVAR2("g_flightRecorderSpikeMs", &g_flightRecorderSpikeMs, g_flightRecorderSpikeMs, VF_NULL,
+		"Frame or game update time in milliseconds that makes the flight recorder write its recent ticks to %USER%/FlightRecorder. 0 only writes on g_flightRecorderDump.");
+	REGISTER_CVAR2("g_flightRecorderDumpSeconds", &g_flightRecorderDumpSeconds, g_flightRecorderDumpSeconds, VF_NULL,
+		"Seconds of flight recorder history written per dump.");
+}
+
+void SGameCVars::Unregister()
+{
+	if (IConsole* pConsole = gEnv->pConsole)
+	{
+		pConsole->UnregisterVariable("g_reconnectGracePeriod", true);
+		pConsole->UnregisterVariable("g_levelPreload", true);
+		pConsole->UnregisterVariable("g_maxPlayers", true);
+		pConsole->UnregisterVariable("g_admissionTickBudget", true);
+		pConsole->UnregisterVariable("g_admissionRatePerTick", true);
+		pConsole->UnregisterVariable("g_admissionQueueSize", true);
+		pConsole->UnregisterVariable("g_terrainCacheSpacing", true);
+		pConsole->UnregisterVariable("g_groundClamp", true);
+		pConsole->UnregisterVariable("g_characterController", true);
+		pConsole->UnregisterVariable("g_maxSlopeAngle", true);
+		pConsole->UnregisterVariable("g_playerSeparation", true);
+		pConsole->UnregisterVariable("g_spawnSpacing", true);
+		pConsole->UnregisterVariable("g_spawnPointCount", true);
+		pConsole->UnregisterVariable("g_simulationLod", true);
+		pConsole->UnregisterVariable("g_simulationLodDistance1", true);
+		pConsole->UnregisterVariable("g_simulationLodDistance2", true);
+		pConsole->UnregisterVariable("g_simulationLodDistance3", true);
+		pConsole->UnregisterVariable("g_replicationScheduler", true);
+		pConsole->UnregisterVariable("g_replicationBudget", true);
+		pConsole->UnregisterVariable("g_replicationDistanceScale", true);
+		pConsole->UnregisterVariable("g_precisionLodDistance", true);
+		pConsole->UnregisterVariable("g_movementSendRate", true);
+		pConsole->UnregisterVariable("g_snapshotCache", true);
+		pConsole->UnregisterVariable("g_broadcastPort", true);
+		pConsole->UnregisterVariable("g_broadcastDelay", true);
+		pConsole->UnregisterVariable("g_broadcastRate", true);
+		pConsole->UnregisterVariable("g_zoneCount", true);
+		pConsole->UnregisterVariable("g_zoneIndex", true);
+		pConsole->UnregisterVariable("g_zoneBasePort", true);
+		pConsole->UnregisterVariable("g_zoneGhostDistance", true);
+		pConsole->UnregisterVariable("g_zoneHandoffMargin", true);
+		pConsole->UnregisterVariable("g_zoneHandoffTimeout", true);
+		pConsole->UnregisterVariable("g_lockstep", true);
+		pConsole->UnregisterVariable("g_lockstepTickRate", true);
+		pConsole->UnregisterVariable("g_lockstepPrediction", true);
+		pConsole->UnregisterVariable("g_lockstepChecksumInterval", true);
+		pConsole->UnregisterVariable("g_clockSyncInterval", true);
+		pConsole->UnregisterVariable("g_inputBindings", true);
+		pConsole->UnregisterVariable("g_flightRecorderSpikeMs", true);
+		pConsole->UnregisterVariable("g_flightRecorderDumpSeconds", true);
+	}
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+// 游戏插件使用的控制台变量(CVar)
+// 在CGamePlugin::Initialize中注册，在CGamePlugin析构时注销
+struct SGameCVars
+{
+	// 断线后保留玩家实体的宽限期(秒)，0为禁用断线重连
+	float g_reconnectGracePeriod = 10.f;
+	// 切换关卡前是否先在后台预加载关卡资源
+	int g_levelPreload = 1;
+
+	// 准入控制：玩家上限、帧耗时预算(毫秒，0为不限制)、每帧最多准入的排队连接数、排队上限
+	int g_maxPlayers = 64;
+	float g_admissionTickBudget = 40.f;
+	int g_admissionRatePerTick = 2;
+	int g_admissionQueueSize = 32;
+
+	// 地形高度缓存的采样间距(米)，以及是否每帧把玩家贴合到地面
+	float g_terrainCacheSpacing = 2.f;
+	int g_groundClamp = 1;
+	// 是否使用胶囊体角色控制器解析玩家移动(碰撞、滑动与重力)，关闭时仅使用g_groundClamp
+	int g_characterController = 1;
+	// 角色控制器可以走上的最大地形坡度(度)
+	float g_maxSlopeAngle = 45.f;
+	// 每帧消除玩家之间重叠的比例(0..1)，0为禁用玩家之间的碰撞
+	float g_playerSeparation = 0.5f;
+	// 出生点螺旋的间距(米)与出生点数量，用完后从螺旋中心重新开始
+	float g_spawnSpacing = 1.5f;
+	int g_spawnPointCount = 64;
+
+	// 模拟LOD：是否启用，以及每2、4、8帧模拟一次的距离带起点(米)
+	int g_simulationLod = 1;
+	float g_simulationLodDistance1 = 50.f;
+	float g_simulationLodDistance2 = 100.f;
+	float g_simulationLodDistance3 = 200.f;
+
+	// 复制调度：是否启用，每个客户端每秒的字节预算，以及优先级随距离衰减的尺度(米)
+	int g_replicationScheduler = 1;
+	int g_replicationBudget = 8192;
+	float g_replicationDistanceScale = 25.f;
+	// 超过此距离(米)的接收者只收到低精度的坐标与偏航角
+	float g_precisionLodDistance = 50.f;
+	// 移动方面每秒最多发送的次数，0为每帧发送
+	float g_movementSendRate = 0.f;
+	// 同一帧内是否在所有频道之间共享编码后的方面数据
+	int g_snapshotCache = 1;
+
+	// 观战广播：发布给中继进程的本机端口(0为禁用)、广播延迟(秒)、每秒采集的帧数(0为每帧)
+	int g_broadcastPort = 0;
+	float g_broadcastDelay = 30.f;
+	float g_broadcastRate = 20.f;
+
+	// 区域分片：区域数量(1为不分区)、本进程拥有的区域编号、区域进程之间互相连接的基础端口(区域i监听基础端口+i)
+	int g_zoneCount = 1;
+	int g_zoneIndex = 0;
+	int g_zoneBasePort = 64200;
+	// 距离边界多少米内的玩家以幽灵复制到相邻区域，越过边界多少米后移交，以及等待客户端连接到目标区域的时长(秒)
+	float g_zoneGhostDistance = 20.f;
+	float g_zoneHandoffMargin = 2.f;
+	float g_zoneHandoffTimeout = 10.f;
+
+	// 锁步/回滚模式：只传输输入，所有对等端以定点数确定性地模拟玩家移动(所有对等端必须使用相同的tick频率)
+	int g_lockstep = 0;
+	int g_lockstepTickRate = 30;
+	// 远程玩家在最后收到的输入之后预测的tick数
+	int g_lockstepPrediction = 3;
+	// 客户端每隔多少个锁步tick报告一次各玩家的校验和，0为不报告
+	int g_lockstepChecksumInterval = 6;
+
+	// 客户端同步后发送时钟同步请求的间隔(秒)
+	float g_clockSyncInterval = 1.f;
+
+	// 本地玩家的按键重新绑定，格式为"动作=按键"并以逗号分隔，如"moveforward=up,moveback=down"，未列出的动作使用默认按键
+	const char* g_inputBindings = "";
+
+	// 飞行记录器：tick超过此毫秒数时写出最近g_flightRecorderDumpSeconds秒的记录，0为只在命令时写出
+	float g_flightRecorderSpikeMs = 100.f;
+	float g_flightRecorderDumpSeconds = 10.f;
+
+	void Register();
+	void Unregister();
+};
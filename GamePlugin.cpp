@@ -5,11 +5,16 @@
 
 #include <IGameObjectSystem.h>
 #include <IGameObject.h>
+#include <ILevelSystem.h>
+
+#include <CrySystem/IConsole.h>
 
 #include <CrySchematyc/Env/IEnvRegistry.h>
 #include <CrySchematyc/Env/EnvPackage.h>
 #include <CrySchematyc/Utils/SharedString.h>
 
+#include <algorithm>
+
 // Included only once per DLL module.
 #include <CryCore/Platform/platform_impl.inl>
 
@@ -23,6 +28,27 @@ CGamePlugin::~CGamePlugin()
 
 	gEnv->pSystem->GetISystemEventDispatcher()->RemoveListener(this);
 
+	m_cvars.Unregister();
+
+	if (gEnv->pConsole)
+	{
+		gEnv->pConsole->RemoveCommand("g_changeMap");
+		gEnv->pConsole->RemoveCommand("g_preloadLevel");
+		gEnv->pConsole->RemoveCommand("g_cancelPreload");
+		gEnv->pConsole->RemoveCommand("g_startupReport");
+		gEnv->pConsole->RemoveCommand("g_spawnBots");
+		gEnv->pConsole->RemoveCommand("g_removeBots");
+		gEnv->pConsole->RemoveCommand("g_benchPlayerBroadphase");
+		gEnv->pConsole->RemoveCommand("g_benchTransformCodec");
+		gEnv->pConsole->RemoveCommand("g_replicationStats");
+		gEnv->pConsole->RemoveCommand("g_zoneStatus");
+		gEnv->pConsole->RemoveCommand("g_zoneTeleport");
+		gEnv->pConsole->RemoveCommand("g_lockstepStats");
+		gEnv->pConsole->RemoveCommand("g_flightRecorderDump");
+		gEnv->pConsole->RemoveCommand("g_inputLatencyStats");
+		gEnv->pConsole->RemoveCommand("g_clockSyncStats");
+	}
+
 	if (gEnv->pSchematyc)
 	{
 		gEnv->pSchematyc->GetEnvRegistry().DeregisterPackage(CGamePlugin::GetCID());
@@ -31,12 +57,167 @@ CGamePlugin::~CGamePlugin()
 
 bool CGamePlugin::Initialize(SSystemGlobalEnvironment& env, const SSystemInitParams& initParams)
 {
+	m_startupProfiler.BeginPhase(CStartupProfiler::EPhase::PluginLoad);
+
 	// 注册来接收引擎事件，在此处我们需要ESYSTEM_EVENT_GAME_POST_INIT来加载地图
 	gEnv->pSystem->GetISystemEventDispatcher()->RegisterListener(this, "CGamePlugin");
+
+	m_cvars.Register();
+
+	// 锁步模拟的地面高度来自地形高度场缓存
+	m_lockstep.SetTerrain(&m_terrainHeightCache);
+
+	REGISTER_COMMAND("g_changeMap", &CGamePlugin::CmdChangeMap, VF_NULL,
+		"Changes to the given level while keeping connected players and their state, only the world is swapped.\n"
+		"Usage: g_changeMap <level>");
+	REGISTER_COMMAND("g_preloadLevel", &CGamePlugin::CmdPreloadLevel, VF_NULL,
+		"Streams a level's resources in the background so a later map change only has to swap the world.\n"
+		"Usage: g_preloadLevel <level>");
+	REGISTER_COMMAND("g_cancelPreload", &CGamePlugin::CmdCancelPreload, VF_NULL,
+		"Cancels the background level preload. A map change waiting for it loads the level directly.");
+	REGISTER_COMMAND("g_startupReport", &CGamePlugin::CmdStartupReport, VF_NULL,
+		"Logs the per-phase startup timing report.");
+	REGISTER_COMMAND("g_spawnBots", &CGamePlugin::CmdSpawnBots, VF_NULL,
+		"Spawns server-side bot players driven by scripted input.\n"
+		"Usage: g_spawnBots <count>");
+	REGISTER_COMMAND("g_removeBots", &CGamePlugin::CmdRemoveBots, VF_NULL,
+		"Removes server-side bot players, all of them if no count is given.\n"
+		"Usage: g_removeBots [count]");
+	REGISTER_COMMAND("g_benchPlayerBroadphase", &CGamePlugin::CmdBenchPlayerBroadphase, VF_NULL,
+		"Times the player-vs-player broadphase and separation with 100, 1000 and 10000 synthetic bodies.\n"
+		"Usage: g_benchPlayerBroadphase [iterations]");
+	REGISTER_COMMAND("g_benchTransformCodec", &CGamePlugin::CmdBenchTransformCodec, VF_NULL,
+		"Times the batch transform encoder and decoder with 100, 1000 and 10000 transforms and checks the round-trip error bounds.\n"
+		"Usage: g_benchTransformCodec [iterations]");
+	REGISTER_COMMAND("g_replicationStats", &CGamePlugin::CmdReplicationStats, VF_NULL,
+		"Logs the replication scheduler backlog and the snapshot cache hit rate of the last frame.");
+	REGISTER_COMMAND("g_zoneStatus", &CGamePlugin::CmdZoneStatus, VF_NULL,
+		"Logs the zone owned by this server process, the linked neighbouring zones, ghosts and handoffs.");
+	REGISTER_COMMAND("g_zoneTeleport", &CGamePlugin::CmdZoneTeleport, VF_NULL,
+		"Moves a player owned by this server to the center of the given zone, which hands it off to that zone's server.\n"
+		"Usage: g_zoneTeleport <channelId> <zone>");
+	REGISTER_COMMAND("g_lockstepStats", &CGamePlugin::CmdLockstepStats, VF_NULL,
+		"Logs the lockstep tick, simulated players, rollbacks and inputs that arrived too late to roll back.");
+	REGISTER_COMMAND("g_flightRecorderDump", &CGamePlugin::CmdFlightRecorderDump, VF_NULL,
+		"Writes the last seconds of per-tick flight recorder data to %USER%/FlightRecorder.\n"
+		"Usage: g_flightRecorderDump [seconds] (defaults to g_flightRecorderDumpSeconds)");
+	REGISTER_COMMAND("g_inputLatencyStats", &CGamePlugin::CmdInputLatencyStats, VF_NULL,
+		"Logs per-channel histograms of the time from an input change on the client to the server applying it and echoing it back.\n"
+		"Usage: g_inputLatencyStats [reset]");
+	REGISTER_COMMAND("g_clockSyncStats", &CGamePlugin::CmdClockSyncStats, VF_NULL,
+		"Logs the estimated server time, round trip, clock offset and drift on clients, or the round trips reported by each channel on the server.");
+
+	// 启用MainUpdate
+	EnableUpdate(EUpdateStep::MainUpdate, true);
+
+	m_startupProfiler.EndPhase(CStartupProfiler::EPhase::PluginLoad);
 	
 	return true;
 }
 
+void CGamePlugin::MainUpdate(float frameTime)
+{
+	m_flightRecorder.BeginTick();
+	const CTimeValue updateStartTime = gEnv->pTimer->GetAsyncTime();
+
+	// 本帧所有功能使用同一个估计的服务器时间
+	UpdateClockSync();
+
+	// 释放已经没有读者的旧版本玩家注册表
+	m_players.CollectGarbage();
+
+	if (gEnv->bServer)
+	{
+		CFlightRecorder::CSectionScope section(m_flightRecorder, CFlightRecorder::ESection::Admission);
+		// 以上一帧服务器更新本身的耗时衡量负载，帧率上限的休眠时间不计入
+		m_admissionController.UpdateTickTime(m_lastUpdateTime);
+		AdmitPendingConnections();
+	}
+
+	// 锁步模式下移动由确定性模拟在所有对等端上重现，不经过角色控制器与移动方面
+	if (IsLockstepEnabled())
+	{
+		CFlightRecorder::CSectionScope section(m_flightRecorder, CFlightRecorder::ESection::Lockstep);
+		UpdateLockstep(frameTime);
+	}
+	else
+	{
+		CFlightRecorder::CSectionScope section(m_flightRecorder, CFlightRecorder::ESection::Movement);
+		UpdateSimulationLod();
+		UpdatePlayerMovement();
+	}
+
+	// 移交越过边界的玩家，在此之后m_players只包含仍由本区域拥有的玩家
+	if (gEnv->bServer)
+	{
+		CFlightRecorder::CSectionScope section(m_flightRecorder, CFlightRecorder::ESection::Zones);
+		UpdateZones();
+	}
+
+	// 在各客户端的带宽预算内刷新等待复制的方面
+	if (gEnv->bServer)
+	{
+		CFlightRecorder::CSectionScope section(m_flightRecorder, CFlightRecorder::ESection::Replication);
+
+		// 远离所有客户端的玩家以低精度复制位置与朝向
+		// 移动在此之前已经解析完毕，所有玩家的变换在这里批量编码一次，网络序列化只复制各自的槽位
+		m_snapshotEntries.clear();
+		IterateOverPlayers([this](CPlayerComponent& player)
+		{
+			const Vec3 position = player.GetEntity()->GetWorldPos();
+			const float distance = m_replicationScheduler.GetNearestClientDistance(position);
+			player.SetMovementPrecision(CNetPrecision::SelectProfile(distance, m_cvars));
+
+			player.SetSnapshotSlot(static_cast<uint32>(m_snapshotEntries.size()));
+			m_snapshotEntries.push_back(CSnapshotCache::SEntry{ player.GetEntityId(), QuatT(position, player.GetEntity()->GetWorldRotation()) });
+		});
+
+		if (m_cvars.g_snapshotCache != 0)
+		{
+			m_snapshotCache.Build(m_snapshotEntries);
+		}
+
+		m_replicationScheduler.Update(frameTime, m_cvars, [](EntityId entityId, NetworkAspectType aspect)
+		{
+			if (IEntity* pEntity = gEnv->pEntitySystem->GetEntity(entityId))
+			{
+				pEntity->GetNetEntity()->MarkAspectsDirty(aspect);
+			}
+		});
+	}
+
+	if (gEnv->bServer)
+	{
+		CFlightRecorder::CSectionScope section(m_flightRecorder, CFlightRecorder::ESection::Broadcast);
+		UpdateBroadcast();
+	}
+
+	{
+		CFlightRecorder::CSectionScope section(m_flightRecorder, CFlightRecorder::ESection::Level);
+		UpdatePendingLevel();
+	}
+
+	// 关卡开始后的第一帧，启动完成
+	if (m_startupProfiler.HasEnded(CStartupProfiler::EPhase::LevelLoad) && !m_startupProfiler.HasEnded(CStartupProfiler::EPhase::FirstTick))
+	{
+		m_startupProfiler.EndPhase(CStartupProfiler::EPhase::FirstTick);
+		m_startupProfiler.LogReport();
+	}
+
+	// 触发到期的定时器(如宽限期内未能重连的休眠玩家)，没有定时器时几乎没有开销
+	{
+		CFlightRecorder::CSectionScope section(m_flightRecorder, CFlightRecorder::ESection::Timers);
+		m_timingWheel.Advance(gEnv->pTimer->GetFrameStartTime());
+	}
+
+	// 关卡加载期间的长帧是预期的，不触发写出
+	const bool bCanDetectSpikes = m_cvars.g_flightRecorderSpikeMs > 0.f && m_startupProfiler.HasEnded(CStartupProfiler::EPhase::FirstTick) && m_pendingLevel.empty();
+	m_flightRecorder.EndTick(m_players.GetSize(), gEnv->bServer ? m_replicationScheduler.GetLastFlushBytes() : 0,
+		bCanDetectSpikes ? m_cvars.g_flightRecorderSpikeMs : 0.f, m_cvars.g_flightRecorderDumpSeconds);
+
+	m_lastUpdateTime = (gEnv->pTimer->GetAsyncTime() - updateStartTime).GetSeconds();
+}
+
 void CGamePlugin::OnSystemEvent(ESystemEvent event, UINT_PTR wparam, UINT_PTR lparam)
 {
 	switch (event)
@@ -44,6 +225,8 @@ void CGamePlugin::OnSystemEvent(ESystemEvent event, UINT_PTR wparam, UINT_PTR lp
 		// 当游戏框架(game framework)初始化完成后调用，已经准备好开始游戏逻辑
 		case ESYSTEM_EVENT_GAME_POST_INIT:
 		{
+			m_startupProfiler.BeginPhase(CStartupProfiler::EPhase::GamePostInit);
+
 			// 监听客户端连接事件，以便创建本地玩家
 			gEnv->pGameFramework->AddNetworkedClientListener(*this);
 
@@ -51,13 +234,17 @@ void CGamePlugin::OnSystemEvent(ESystemEvent event, UINT_PTR wparam, UINT_PTR lp
 			if (!gEnv->IsEditor())
 			{
 				// 在服务器模式中加载范例地图
-				gEnv->pConsole->ExecuteString("map example s", false, true);
+				RequestLevel("example", false);
 			}
+
+			m_startupProfiler.EndPhase(CStartupProfiler::EPhase::GamePostInit);
 		}
 		break;
 
 		case ESYSTEM_EVENT_REGISTER_SCHEMATYC_ENV:
 		{
+			m_startupProfiler.BeginPhase(CStartupProfiler::EPhase::SchematycRegistration);
+
 			// 注册所有属于此插件(plug-in)的组件(component)
 			auto staticAutoRegisterLambda = [](Schematyc::IEnvRegistrar& registrar)
 			{
@@ -77,29 +264,198 @@ void CGamePlugin::OnSystemEvent(ESystemEvent event, UINT_PTR wparam, UINT_PTR lp
 						)
 				);
 			}
+
+			m_startupProfiler.EndPhase(CStartupProfiler::EPhase::SchematycRegistration);
+		}
+		break;
+
+		case ESYSTEM_EVENT_LEVEL_LOAD_START:
+		{
+			m_startupProfiler.BeginPhase(CStartupProfiler::EPhase::LevelLoad);
+		}
+		break;
+
+		case ESYSTEM_EVENT_LEVEL_LOAD_END:
+		{
+			m_terrainHeightCache.Build(m_cvars.g_terrainCacheSpacing);
+			CryLog("[TerrainHeightCache] Built, %" PRISIZE_T " KB", m_terrainHeightCache.GetMemoryUsage() / 1024);
+
+			m_characterController.BuildStaticGeometry();
+			CryLog("[CharacterController] Collected %" PRISIZE_T " static boxes", m_characterController.GetStaticBoxCount());
+
+			m_startupProfiler.EndPhase(CStartupProfiler::EPhase::LevelLoad);
+			m_startupProfiler.BeginPhase(CStartupProfiler::EPhase::FirstTick);
+
+			// 旧关卡已经卸载，没有被消耗的标记不再适用
+			m_bSeamlessTransition = false;
+		}
+		break;
+
+		case ESYSTEM_EVENT_LEVEL_LOAD_ERROR:
+		{
+			// 加载失败，之后的卸载不是这次切换的一部分
+			m_bSeamlessTransition = false;
 		}
 		break;
 		
 		case ESYSTEM_EVENT_LEVEL_UNLOAD:
 		{
-			m_players.clear();
+			m_persistentPlayers.clear();
+
+			// 无缝切换：记录每个玩家的状态，频道在新关卡中以bIsReset重新连接时恢复
+			if (m_bSeamlessTransition)
+			{
+				CPlayerRegistry::CReadScope players(m_players);
+				for (const std::pair<const int, EntityId>& playerPair : *players)
+				{
+					// 机器人没有频道，不会以bIsReset重新连接
+					if (playerPair.first < 0)
+						continue;
+
+					if (IEntity* pPlayerEntity = gEnv->pEntitySystem->GetEntity(playerPair.second))
+					{
+						const QuatT transform = QuatT(pPlayerEntity->GetWorldTM());
+						const uint32 localPlayerFlag = pPlayerEntity->GetFlags() & ENTITY_FLAG_LOCAL_PLAYER;
+
+						m_persistentPlayers.emplace(playerPair.first, SPersistentPlayer{ playerPair.second, pPlayerEntity->GetName(), localPlayerFlag, transform.t, transform.q });
+					}
+				}
+
+				m_bSeamlessTransition = false;
+			}
+
+			m_players.Clear();
+			m_nextBotKey = -1;
+			m_botCount = 0;
+			// 休眠实体随关卡一起销毁
+			m_reconnectCache.Clear();
+			m_timingWheel.Clear();
+			// 排队中的频道会随关卡重置重新请求连接
+			m_admissionController.Clear();
+
+			m_terrainHeightCache.Clear();
+			m_characterController.Clear();
+			m_playerBroadphase.Clear();
+			// 客户端在新关卡中准备好游戏后重新加入
+			m_replicationScheduler.Clear();
+			m_snapshotCache.Clear();
+			m_spawnIndex = 0;
+			m_nextBroadcastCaptureTime = 0.f;
+			// 幽灵随关卡一起销毁
+			m_zoneGhosts.clear();
+			m_ghostedPlayers.clear();
+			m_handoffSourceZones.clear();
+			m_lockstep.Clear();
+			m_lockstepTick = 0;
+			m_lockstepAccumulator = 0.f;
+			m_lockstepChecksumReports.clear();
+			// 本地玩家实体随关卡销毁，客户端之后可能连接到时钟无关的另一台服务器(如区域移交)，重新同步
+			m_localPlayerId = INVALID_ENTITYID;
+			if (!gEnv->bServer)
+			{
+				m_clockSync.Reset();
+			}
 		}
 		break;
 	}
 }
 
 bool CGamePlugin::OnClientConnectionReceived(int channelId, bool bIsReset)
+{
+	m_flightRecorder.OnConnect();
+
+	// 无缝切换地图后频道被重置，沿用切换前的玩家
+	auto persistentIt = bIsReset ? m_persistentPlayers.find(channelId) : m_persistentPlayers.end();
+	if (persistentIt != m_persistentPlayers.end())
+	{
+		SpawnPlayer(channelId, &persistentIt->second);
+
+		// 标记为已恢复，准备好游戏时在保留的位置直接复活
+		m_restoredChannels.insert(channelId);
+		m_persistentPlayers.erase(persistentIt);
+		return true;
+	}
+
+	INetChannel* pNetChannel = gEnv->pGameFramework->GetNetChannel(channelId);
+
+	// 观战只经广播中继提供延迟的共享流，不接受直接连接的观战者，避免实时复制泄露给观众
+	if (IsSpectatorChannel(pNetChannel))
+	{
+		const char* szRejectReason = "Spectators must watch through a broadcast relay with BroadcastViewer";
+		CryLogAlways("[Broadcast] Rejected spectator channel %d: %s", channelId, szRejectReason);
+		pNetChannel->Disconnect(eDC_ServerFull, szRejectReason);
+		return true;
+	}
+
+	// 准入控制，本地玩家(非专用服务器的主机)总是立即准入
+	if (pNetChannel != nullptr && !pNetChannel->IsLocal())
+	{
+		// 剥离昵称中的会话令牌，不让它出现在日志与其他客户端上
+		string nickname;
+		const uint64 sessionToken = CReconnectCache::ParseNicknameToken(pNetChannel->GetNickname(), nickname);
+		if (sessionToken != 0)
+		{
+			pNetChannel->SetNickname(nickname.c_str());
+
+			// 宽限期内重新连接(或区域移交)，直接把新频道绑定到休眠中的玩家实体，跳过准入与生成
+			if (ResumeDormantPlayer(channelId, sessionToken))
+			{
+				return true;
+			}
+		}
+
+		string rejectReason;
+		switch (m_admissionController.OnConnectionRequested(channelId, m_players.GetSize() - m_botCount, m_cvars, rejectReason))
+		{
+			case CAdmissionController::EResult::Admit:
+				break;
+
+			case CAdmissionController::EResult::Queue:
+			{
+				// 暂时接受连接，在MainUpdate中按速率生成玩家
+				CryLog("[Admission] Channel %d queued (%" PRISIZE_T " pending, tick %.1f ms)", channelId, m_admissionController.GetPendingCount(), m_admissionController.GetAverageTickTime());
+				return true;
+			}
+
+			case CAdmissionController::EResult::Reject:
+			{
+				// 只以Disconnect拒绝，客户端收到具体原因；返回false会让引擎以通用原因再断开一次
+				CryLogAlways("[Admission] Rejected channel %d: %s", channelId, rejectReason.c_str());
+				pNetChannel->Disconnect(eDC_ServerFull, rejectReason.c_str());
+				return true;
+			}
+		}
+	}
+
+	SpawnPlayer(channelId, nullptr);
+
+	return true;
+}
+
+void CGamePlugin::SpawnPlayer(int channelId, const SPersistentPlayer* pPersistentPlayer)
 {
 	// 接收到一个客户端的连接，创建一个玩家实体与组件
 	SEntitySpawnParams spawnParams;
 	spawnParams.pClass = gEnv->pEntitySystem->GetClassRegistry()->GetDefaultClass();
 	
 	// 为此玩家实体设定一个独有名称
-	const string playerName = string().Format("Player%" PRISIZE_T, m_players.size());
+	const string playerName = string().Format("Player%" PRISIZE_T, m_players.GetSize());
 	spawnParams.sName = playerName;
-	
+
+	if (pPersistentPlayer != nullptr)
+	{
+		// 使用相同的实体id与名称，频道与实体的绑定在切换前后保持一致
+		spawnParams.id = pPersistentPlayer->entityId;
+		spawnParams.sName = pPersistentPlayer->name;
+		spawnParams.nFlags |= pPersistentPlayer->localPlayerFlag;
+
+		// 保持原位置，但不能低于新关卡的地形
+		spawnParams.vPosition = pPersistentPlayer->position;
+		spawnParams.vPosition.z = max(spawnParams.vPosition.z, gEnv->p3DEngine->GetTerrainZ(spawnParams.vPosition.x, spawnParams.vPosition.y));
+		spawnParams.qRotation = pPersistentPlayer->rotation;
+	}
 	// 设定本地玩家细节(details)
-	if (m_players.empty() && !gEnv->IsDedicated())
+	else if (m_players.IsEmpty() && !gEnv->IsDedicated())
 	{
 		spawnParams.id = LOCAL_PLAYER_ENTITY_ID;
 		spawnParams.nFlags |= ENTITY_FLAG_LOCAL_PLAYER;
@@ -117,24 +473,110 @@ bool CGamePlugin::OnClientConnectionReceived(int channelId, bool bIsReset)
 		if (pPlayer != nullptr)
 		{
 			// 将其放入用于存储的Map
-			m_players.emplace(std::make_pair(channelId, pPlayerEntity->GetId()));
+			m_players.Insert(channelId, pPlayerEntity->GetId());
 		}
 	}
+}
+
+bool CGamePlugin::ResumeDormantPlayer(int channelId, uint64 sessionToken)
+{
+	const EntityId dormantEntityId = m_reconnectCache.TakeDormant(sessionToken);
+	IEntity* pPlayerEntity = gEnv->pEntitySystem->GetEntity(dormantEntityId);
+	CPlayerComponent* pPlayer = pPlayerEntity != nullptr ? pPlayerEntity->GetComponent<CPlayerComponent>() : nullptr;
+	if (pPlayer == nullptr)
+		return false;
+
+	// 实体保持原位置与状态，准备好游戏时在原位置复活
+	pPlayerEntity->GetNetEntity()->SetChannelId(channelId);
+	pPlayer->SetDormant(false);
+	m_players.Insert(channelId, dormantEntityId);
 
+	// 从其他区域移交来的玩家：通知源区域移除它保留的副本
+	auto sourceIt = m_handoffSourceZones.find(sessionToken);
+	if (sourceIt != m_handoffSourceZones.end())
+	{
+		m_zoneLink.SendHandoffClaimed(sourceIt->second, sessionToken);
+		m_handoffSourceZones.erase(sourceIt);
+	}
+
+	CryLog("[Reconnect] Channel %d resumed %s", channelId, pPlayerEntity->GetName());
 	return true;
 }
 
+void CGamePlugin::SetNicknameToken(uint64 sessionToken)
+{
+	ICVar* pNickname = gEnv->pConsole->GetCVar("cl_nickname");
+	if (pNickname == nullptr)
+	{
+		CryWarning(VALIDATOR_MODULE_GAME, VALIDATOR_WARNING, "cl_nickname is not registered, reconnecting will not resume the previous player");
+		return;
+	}
+
+	pNickname->Set(CReconnectCache::AppendNicknameToken(pNickname->GetString(), sessionToken).c_str());
+}
+
+void CGamePlugin::AdmitPendingConnections()
+{
+	m_admissionController.AdmitPending(m_players.GetSize() - m_botCount, m_cvars, [this](int channelId, bool bReady)
+	{
+		SpawnPlayer(channelId, nullptr);
+
+		// 排队期间客户端已经准备好游戏，补上Revive
+		if (bReady)
+		{
+			OnClientReadyForGameplay(channelId, false);
+		}
+	});
+}
+
 bool CGamePlugin::OnClientReadyForGameplay(int channelId, bool bIsReset)
 {
+	// 仍在准入队列中，生成玩家后再Revive
+	if (m_admissionController.OnChannelReady(channelId))
+	{
+		return true;
+	}
+
 	// 当网络回报这个客户端已经连接并准备好游戏时Revive玩家
-	auto it = m_players.find(channelId);
-	if (it != m_players.end())
+	const EntityId playerEntityId = m_players.Find(channelId);
+	if (playerEntityId != INVALID_ENTITYID)
 	{
-		if (IEntity* pPlayerEntity = gEnv->pEntitySystem->GetEntity(it->second))
+		if (IEntity* pPlayerEntity = gEnv->pEntitySystem->GetEntity(playerEntityId))
 		{
 			if (CPlayerComponent* pPlayer = pPlayerEntity->GetComponent<CPlayerComponent>())
 			{
-				pPlayer->OnReadyForGameplayOnServer();
+				// 重连的玩家已经生成过，切换地图的玩家已恢复到原位置，在原位置复活即可
+				const bool bRestored = m_restoredChannels.erase(channelId) > 0;
+				if (pPlayer->IsAlive() || bRestored)
+				{
+					pPlayer->OnReconnectedOnServer();
+				}
+				else
+				{
+					pPlayer->OnReadyForGameplayOnServer();
+				}
+
+				// 远程客户端开始占用复制预算，本地客户端不经过网络
+				INetChannel* pNetChannel = gEnv->pGameFramework->GetNetChannel(channelId);
+				if (pNetChannel != nullptr && !pNetChannel->IsLocal())
+				{
+					m_replicationScheduler.AddClient(channelId, playerEntityId);
+
+					// 每次准备好游戏时换发新的会话令牌，只发给该频道，断线重连时客户端出示它取回休眠的玩家
+					pPlayer->SendSessionTokenOnServer(m_reconnectCache.IssueSessionToken(channelId));
+
+					// 锁步模式下复活时的出生状态只发给了当时在线的频道，新加入的客户端需要其他玩家的状态与输入历史才能模拟他们
+					if (IsLockstepEnabled())
+					{
+						IterateOverPlayers([channelId, playerEntityId](CPlayerComponent& player)
+						{
+							if (player.GetEntityId() != playerEntityId)
+							{
+								player.SendLockstepHistoryOnServer(channelId);
+							}
+						});
+					}
+				}
 			}
 		}
 	}
@@ -144,19 +586,1041 @@ bool CGamePlugin::OnClientReadyForGameplay(int channelId, bool bIsReset)
 
 void CGamePlugin::OnClientDisconnected(int channelId, EDisconnectionCause cause, const char* description, bool bKeepClient)
 {
+	m_flightRecorder.OnDisconnect();
+
+	const uint64 sessionToken = m_reconnectCache.OnChannelDisconnected(channelId);
+
+	m_persistentPlayers.erase(channelId);
+	m_restoredChannels.erase(channelId);
+	m_admissionController.OnChannelDisconnected(channelId);
+	m_replicationScheduler.RemoveClient(channelId);
+	m_inputLatencyTracker.RemoveChannel(channelId);
+	m_clockSync.RemoveChannel(channelId);
+	m_lockstepChecksumReports.erase(std::remove_if(m_lockstepChecksumReports.begin(), m_lockstepChecksumReports.end(),
+		[channelId](const SLockstepChecksumReport& report) { return report.channelId == channelId; }), m_lockstepChecksumReports.end());
+
 	// 客户端断开连接，移除此实体，并从map中移除
-	auto it = m_players.find(channelId);
-	if (it != m_players.end())
+	const EntityId playerEntityId = m_players.Find(channelId);
+	if (playerEntityId != INVALID_ENTITYID)
+	{
+		// 非主动断线(如移动网络短暂掉线)时保留实体，等待同一会话重新连接
+		const bool bCanReconnect = sessionToken != 0 && m_cvars.g_reconnectGracePeriod > 0.f
+			&& (bKeepClient || cause == eDC_Timeout || cause == eDC_ICMPError);
+
+		IEntity* pPlayerEntity = gEnv->pEntitySystem->GetEntity(playerEntityId);
+		CPlayerComponent* pPlayer = pPlayerEntity != nullptr ? pPlayerEntity->GetComponent<CPlayerComponent>() : nullptr;
+
+		if (bCanReconnect && pPlayer != nullptr)
+		{
+			pPlayerEntity->GetNetEntity()->SetChannelId(0);
+			pPlayer->SetDormant(true);
+
+			m_reconnectCache.StoreDormant(sessionToken, playerEntityId, m_cvars.g_reconnectGracePeriod);
+		}
+		else
+		{
+			gEnv->pEntitySystem->RemoveEntity(playerEntityId);
+		}
+
+		m_players.Erase(channelId);
+	}
+}
+
+void CGamePlugin::ChangeMapSeamless(const char* szLevelName)
+{
+	if (!gEnv->bServer || gEnv->IsEditor())
+	{
+		CryWarning(VALIDATOR_MODULE_GAME, VALIDATOR_WARNING, "g_changeMap can only be used on a running server");
+		return;
+	}
+
+	// 在关卡卸载时保留玩家，已连接的频道会以bIsReset重新进入新关卡，不需要重新连接
+	RequestLevel(szLevelName, true);
+}
+
+void CGamePlugin::RequestLevel(const char* szLevelName, bool bSeamless)
+{
+	m_pendingLevel = szLevelName;
+	m_bPendingSeamless = bSeamless;
+
+	// 只在关卡运行期间切换关卡时预加载，使当前关卡在读取期间继续运行
+	// 没有运行中的关卡(如启动时的第一个关卡)时预加载只会推迟map命令，直接加载
+	const ILevelSystem* pLevelSystem = gEnv->pGameFramework->GetILevelSystem();
+	m_bPendingPreload = m_cvars.g_levelPreload != 0 && pLevelSystem != nullptr && pLevelSystem->GetCurrentLevel() != nullptr;
+	if (m_bPendingPreload)
+	{
+		m_startupProfiler.BeginPhase(CStartupProfiler::EPhase::LevelPreload);
+		m_levelPreloader.Preload(szLevelName);
+	}
+
+	UpdatePendingLevel();
+}
+
+void CGamePlugin::UpdatePendingLevel()
+{
+	if (m_pendingLevel.empty())
+		return;
+
+	// 等待后台预加载完成，切换时只需替换世界
+	if (m_bPendingPreload && !m_levelPreloader.IsFinished(m_pendingLevel.c_str()))
+		return;
+
+	m_startupProfiler.EndPhase(CStartupProfiler::EPhase::LevelPreload);
+
+	// map命令对不存在的关卡什么都不做，不会卸载当前关卡，此时不能留下无缝切换的标记
+	const ILevelSystem* pLevelSystem = gEnv->pGameFramework->GetILevelSystem();
+	if (pLevelSystem == nullptr || pLevelSystem->GetLevelInfo(m_pendingLevel.c_str()) == nullptr)
+	{
+		CryWarning(VALIDATOR_MODULE_GAME, VALIDATOR_WARNING, "Unknown level '%s', staying on the current level", m_pendingLevel.c_str());
+		m_pendingLevel.clear();
+		return;
+	}
+
+	// 标记在卸载当前关卡时消耗，加载失败或完成时清除，之后的卸载(如断线)不会被当作无缝切换
+	m_bSeamlessTransition = m_bPendingSeamless;
+	gEnv->pConsole->ExecuteString(string().Format("map %s s", m_pendingLevel.c_str()), false, true);
+
+	m_pendingLevel.clear();
+}
+
+void CGamePlugin::CmdChangeMap(IConsoleCmdArgs* pArgs)
+{
+	if (pArgs->GetArgCount() < 2)
+	{
+		CryLogAlways("Usage: g_changeMap <level>");
+		return;
+	}
+
+	CGamePlugin::GetInstance()->ChangeMapSeamless(pArgs->GetArg(1));
+}
+
+void CGamePlugin::CmdPreloadLevel(IConsoleCmdArgs* pArgs)
+{
+	if (pArgs->GetArgCount() < 2)
+	{
+		CryLogAlways("Usage: g_preloadLevel <level>");
+		return;
+	}
+
+	CGamePlugin::GetInstance()->m_levelPreloader.Preload(pArgs->GetArg(1));
+}
+
+void CGamePlugin::CmdCancelPreload(IConsoleCmdArgs* pArgs)
+{
+	CGamePlugin* pGamePlugin = CGamePlugin::GetInstance();
+	pGamePlugin->m_levelPreloader.Cancel();
+
+	// 等待预加载的关卡切换不再等待，下一帧直接执行map命令
+	pGamePlugin->m_bPendingPreload = false;
+	CryLogAlways("[LevelPreloader] Preload cancelled");
+}
+
+void CGamePlugin::CmdStartupReport(IConsoleCmdArgs* pArgs)
+{
+	CGamePlugin::GetInstance()->m_startupProfiler.LogReport();
+}
+
+void CGamePlugin::SpawnBots(int count)
+{
+	if (!gEnv->bServer)
+	{
+		CryWarning(VALIDATOR_MODULE_GAME, VALIDATOR_WARNING, "Bots can only be spawned on the server");
+		return;
+	}
+
+	std::vector<std::pair<int, EntityId>> spawnedBots;
+	spawnedBots.reserve(count);
+
+	for (int i = 0; i < count; ++i)
+	{
+		const int botKey = m_nextBotKey--;
+
+		SEntitySpawnParams spawnParams;
+		spawnParams.pClass = gEnv->pEntitySystem->GetClassRegistry()->GetDefaultClass();
+
+		const string botName = string().Format("Bot%d", -botKey);
+		spawnParams.sName = botName;
+		spawnParams.nFlags |= ENTITY_FLAG_NEVER_NETWORK_STATIC;
+
+		if (IEntity* pBotEntity = gEnv->pEntitySystem->SpawnEntity(spawnParams))
+		{
+			if (CPlayerComponent* pPlayer = pBotEntity->GetOrCreateComponentClass<CPlayerComponent>())
+			{
+				pPlayer->EnableBotInput(static_cast<uint32>(pBotEntity->GetId()) * 2654435761u);
+				spawnedBots.emplace_back(botKey, pBotEntity->GetId());
+			}
+		}
+	}
+
+	// 一次性发布到注册表，再按真实玩家的流程在服务器上Revive
+	m_players.InsertRange(spawnedBots);
+	m_botCount += spawnedBots.size();
+
+	for (const std::pair<int, EntityId>& bot : spawnedBots)
+	{
+		if (CPlayerComponent* pPlayer = gEnv->pEntitySystem->GetEntity(bot.second)->GetComponent<CPlayerComponent>())
+		{
+			pPlayer->OnReadyForGameplayOnServer();
+		}
+	}
+
+	CryLogAlways("[Bots] Spawned %" PRISIZE_T " bots, %" PRISIZE_T " players in total", spawnedBots.size(), m_players.GetSize());
+}
+
+void CGamePlugin::RemoveBots(int count)
+{
+	std::vector<int> removedBots;
+
+	{
+		CPlayerRegistry::CReadScope players(m_players);
+		for (const std::pair<const int, EntityId>& playerPair : *players)
+		{
+			if (count >= 0 && removedBots.size() >= static_cast<size_t>(count))
+				break;
+
+			if (playerPair.first < 0)
+			{
+				gEnv->pEntitySystem->RemoveEntity(playerPair.second);
+				removedBots.push_back(playerPair.first);
+			}
+		}
+	}
+
+	m_players.EraseRange(removedBots);
+	m_botCount -= removedBots.size();
+
+	CryLogAlways("[Bots] Removed %" PRISIZE_T " bots", removedBots.size());
+}
+
+void CGamePlugin::CmdSpawnBots(IConsoleCmdArgs* pArgs)
+{
+	if (pArgs->GetArgCount() < 2)
 	{
-		gEnv->pEntitySystem->RemoveEntity(it->second);
+		CryLogAlways("Usage: g_spawnBots <count>");
+		return;
+	}
+
+	CGamePlugin::GetInstance()->SpawnBots(max(atoi(pArgs->GetArg(1)), 0));
+}
+
+void CGamePlugin::CmdRemoveBots(IConsoleCmdArgs* pArgs)
+{
+	const int count = pArgs->GetArgCount() >= 2 ? max(atoi(pArgs->GetArg(1)), 0) : -1;
+	CGamePlugin::GetInstance()->RemoveBots(count);
+}
+
+void CGamePlugin::CmdBenchPlayerBroadphase(IConsoleCmdArgs* pArgs)
+{
+	const int iterations = pArgs->GetArgCount() >= 2 ? max(atoi(pArgs->GetArg(1)), 1) : 100;
 
-		m_players.erase(it);
+	// 稀疏分布(每平方米0.1个)与密集人群(每平方米1个)两种情况
+	for (const int bodyCount : { 100, 1000, 10000 })
+	{
+		const float sparseTime = CPlayerBroadphase::Benchmark(bodyCount, 0.1f, iterations);
+		const float crowdTime = CPlayerBroadphase::Benchmark(bodyCount, 1.f, iterations);
+		CryLogAlways("[PlayerBroadphase] %5d bodies: %.3f ms sparse, %.3f ms crowd (%d iterations)", bodyCount, sparseTime, crowdTime, iterations);
+	}
+}
+
+void CGamePlugin::UpdateSimulationLod()
+{
+	m_simulationLod.ClearObservers();
+
+	if (m_cvars.g_simulationLod == 0)
+	{
+		IterateOverPlayers([](CPlayerComponent& player) { player.SetSimulationInterval(1); });
+		return;
 	}
+
+	// 客户端(包括主机)以本地相机为观察者
+	if (!gEnv->IsDedicated())
+	{
+		m_simulationLod.AddObserver(gEnv->pSystem->GetViewCamera().GetPosition());
+	}
+
+	// 服务器上每个真实玩家都是观察者，机器人不是
+	if (gEnv->bServer)
+	{
+		IterateOverPlayers([this](CPlayerComponent& player)
+		{
+			if (player.IsAlive() && !player.IsDormant() && !player.IsBot())
+			{
+				m_simulationLod.AddObserver(player.GetEntity()->GetWorldPos());
+			}
+		});
+	}
+
+	// 观察者按网格索引，每个玩家只与附近的观察者比较距离
+	m_simulationLod.BuildObserverGrid(m_cvars);
+
+	IterateOverPlayers([this](CPlayerComponent& player)
+	{
+		player.SetSimulationInterval(m_simulationLod.ComputeInterval(player.GetEntity()->GetWorldPos(), m_cvars));
+	});
+}
+
+void CGamePlugin::CmdBenchTransformCodec(IConsoleCmdArgs* pArgs)
+{
+	const int iterations = pArgs->GetArgCount() >= 2 ? max(atoi(pArgs->GetArg(1)), 1) : 100;
+
+	for (const CTransformCodec::ERotationEncoding rotationEncoding : { CTransformCodec::ERotationEncoding::SmallestThree, CTransformCodec::ERotationEncoding::YawPitch })
+	{
+		CTransformCodec::SFormat format;
+		format.rotationEncoding = rotationEncoding;
+		const CTransformCodec codec(format);
+
+		const char* szEncodingName = rotationEncoding == CTransformCodec::ERotationEncoding::SmallestThree ? "smallest-three" : "yaw/pitch";
+		CryLogAlways("[TransformCodec] %s, %u bits per transform, error bounds %.4f m / %.4f rad", szEncodingName, codec.GetBitsPerTransform(), codec.GetMaxPositionError(), codec.GetMaxRotationError());
+
+		for (const size_t transformCount : { 100, 1000, 10000 })
+		{
+			const CTransformCodec::SBenchmarkResult result = codec.Benchmark(transformCount, iterations);
+			// 允许浮点舍入造成的微小超出
+			const bool bWithinBounds = result.maxPositionError <= codec.GetMaxPositionError() * 1.001f && result.maxRotationError <= codec.GetMaxRotationError() * 1.001f;
+
+			CryLogAlways("[TransformCodec] %5" PRISIZE_T " transforms: encode %.3f ms, decode %.3f ms, %" PRISIZE_T " bytes, max error %.4f m / %.4f rad%s",
+				transformCount, result.encodeMilliseconds, result.decodeMilliseconds, result.encodedBytes, result.maxPositionError, result.maxRotationError,
+				bWithinBounds ? "" : " (exceeds bounds!)");
+		}
+	}
+}
+
+void CGamePlugin::CmdReplicationStats(IConsoleCmdArgs* pArgs)
+{
+	const CGamePlugin* pGamePlugin = CGamePlugin::GetInstance();
+	const CReplicationScheduler& scheduler = pGamePlugin->m_replicationScheduler;
+	const CSnapshotCache& snapshotCache = pGamePlugin->m_snapshotCache;
+
+	CryLogAlways("[Replication] %" PRISIZE_T " clients, %" PRISIZE_T " aspects pending, last frame flushed %" PRISIZE_T " aspects (%u bytes)",
+		scheduler.GetClientCount(), scheduler.GetPendingCount(), scheduler.GetLastFlushCount(), scheduler.GetLastFlushBytes());
+	CryLogAlways("[Replication] Snapshot: batch-encoded %" PRISIZE_T " players in %.3f ms last frame", snapshotCache.GetSlotCount(), snapshotCache.GetLastBuildMilliseconds());
+
+	const CInputLatencyTracker::SHistogram roundTrip = pGamePlugin->m_inputLatencyTracker.GetCombinedRoundTrip();
+	CryLogAlways("[Replication] Input round trip: %u samples, avg %.1f ms, p95 <=%u ms, max %u ms",
+		roundTrip.count, roundTrip.GetAverageMs(), roundTrip.GetPercentileMs(0.95f), roundTrip.maxMs);
+}
+
+void CGamePlugin::UpdateClockSync()
+{
+	if (!gEnv->bServer && m_localPlayerId != INVALID_ENTITYID)
+	{
+		const CTimeValue now = gEnv->pTimer->GetAsyncTime();
+		if (m_clockSync.ShouldSendRequest(now, m_cvars.g_clockSyncInterval))
+		{
+			IEntity* pPlayerEntity = gEnv->pEntitySystem->GetEntity(m_localPlayerId);
+			if (CPlayerComponent* pPlayer = pPlayerEntity != nullptr ? pPlayerEntity->GetComponent<CPlayerComponent>() : nullptr)
+			{
+				pPlayer->SendClockSyncRequest(now, m_clockSync.GetRoundTripTime());
+				m_clockSync.OnRequestSent(now);
+			}
+		}
+	}
+
+	m_clockSync.Update(gEnv->pTimer->GetFrameStartTime());
+}
+
+void CGamePlugin::CmdClockSyncStats(IConsoleCmdArgs* pArgs)
+{
+	const CClockSync& clockSync = CGamePlugin::GetInstance()->m_clockSync;
+
+	if (gEnv->bServer)
+	{
+		CryLogAlways("[ClockSync] Server time %.3f s, %" PRISIZE_T " channels reporting", clockSync.GetServerTime().GetSeconds(), clockSync.GetChannelRoundTripTimes().size());
+		for (const std::pair<const int, float>& channelPair : clockSync.GetChannelRoundTripTimes())
+		{
+			CryLogAlways("[ClockSync]   Channel %d: round trip %.1f ms", channelPair.first, channelPair.second * 1000.f);
+		}
+		return;
+	}
+
+	if (!clockSync.IsSynchronized())
+	{
+		CryLogAlways("[ClockSync] Not synchronized yet (%u samples)", clockSync.GetSampleCount());
+		return;
+	}
+
+	CryLogAlways("[ClockSync] Estimated server time %.3f s, round trip %.1f ms, offset %.1f ms, drift %.1f ppm, %u samples",
+		clockSync.GetServerTime().GetSeconds(), clockSync.GetRoundTripTime() * 1000.f, clockSync.GetOffset() * 1000.f, clockSync.GetDriftPpm(), clockSync.GetSampleCount());
+}
+
+void CGamePlugin::CmdInputLatencyStats(IConsoleCmdArgs* pArgs)
+{
+	CGamePlugin* pGamePlugin = CGamePlugin::GetInstance();
+
+	if (pArgs->GetArgCount() > 1 && stricmp(pArgs->GetArg(1), "reset") == 0)
+	{
+		pGamePlugin->m_inputLatencyTracker.Clear();
+		CryLogAlways("[InputLatency] Histograms reset");
+		return;
+	}
+
+	pGamePlugin->m_inputLatencyTracker.LogReport();
+}
+
+void CGamePlugin::UpdatePlayerMovement()
+{
+	m_movementEntities.clear();
+	m_moves.clear();
+
+	IterateOverPlayers([this](CPlayerComponent& player)
+	{
+		if (!player.IsAlive() || player.IsDormant())
+			return;
+
+		CCharacterController::SMove move;
+		move.position = player.GetEntity()->GetWorldPos();
+		move.displacement = player.ConsumeDesiredDisplacement();
+		move.verticalVelocity = player.GetVerticalVelocity();
+		move.bGrounded = player.IsGrounded();
+		move.timeStep = player.ConsumeStepTime();
+
+		// 模拟LOD跳过的玩家本帧没有需要解析的移动
+		if (move.timeStep <= 0.f)
+			return;
+
+		m_movementEntities.push_back(player.GetEntityId());
+		m_moves.push_back(move);
+	});
+
+	if (m_moves.empty())
+		return;
+
+	// 玩家之间的推开先于角色控制器计算并加入期望位移，与自身移动一起对静态几何体扫掠，不会被推进墙里
+	if (m_cvars.g_playerSeparation > 0.f)
+	{
+		SeparatePlayers();
+	}
+
+	if (m_cvars.g_characterController != 0)
+	{
+		// 所有玩家的扫掠在一次调用中批量解析
+		m_characterController.GetParams().maxSlopeAngle = m_cvars.g_maxSlopeAngle;
+		m_characterController.ResolveMoves(m_moves.data(), m_moves.size(), m_terrainHeightCache);
+	}
+	else
+	{
+		for (CCharacterController::SMove& move : m_moves)
+		{
+			move.position += move.displacement;
+		}
+
+		// 不使用角色控制器时，以一次批量查询把所有玩家贴合到地面
+		if (m_cvars.g_groundClamp != 0 && m_terrainHeightCache.IsValid())
+		{
+			m_groundClampX.resize(m_moves.size());
+			m_groundClampY.resize(m_moves.size());
+			m_groundClampHeights.resize(m_moves.size());
+
+			for (size_t i = 0; i < m_moves.size(); ++i)
+			{
+				m_groundClampX[i] = m_moves[i].position.x;
+				m_groundClampY[i] = m_moves[i].position.y;
+			}
+
+			m_terrainHeightCache.GetHeights(m_groundClampX.data(), m_groundClampY.data(), m_groundClampHeights.data(), m_moves.size());
+
+			for (size_t i = 0; i < m_moves.size(); ++i)
+			{
+				m_moves[i].position.z = m_groundClampHeights[i];
+			}
+		}
+	}
+
+	for (size_t i = 0; i < m_moves.size(); ++i)
+	{
+		if (IEntity* pPlayerEntity = gEnv->pEntitySystem->GetEntity(m_movementEntities[i]))
+		{
+			CPlayerComponent* pPlayer = pPlayerEntity->GetComponent<CPlayerComponent>();
+			if (!pPlayerEntity->GetWorldPos().IsEquivalent(m_moves[i].position))
+			{
+				pPlayerEntity->SetPos(m_moves[i].position);
+
+				if (gEnv->bServer && pPlayer != nullptr)
+				{
+					pPlayer->OnMovedOnServer();
+				}
+			}
+
+			if (pPlayer != nullptr)
+			{
+				pPlayer->SetMovementState(m_moves[i].verticalVelocity, m_moves[i].bGrounded);
+
+				if (gEnv->bServer)
+				{
+					pPlayer->OnMovementResolvedOnServer();
+				}
+			}
+		}
+	}
+}
+
+void CGamePlugin::SeparatePlayers()
+{
+	const CCharacterController::SParams& controllerParams = m_characterController.GetParams();
+	m_playerBroadphase.SetDimensions(controllerParams.radius, controllerParams.height);
+
+	// 增量更新网格，只有跨越单元的玩家需要移动桶位
+	for (size_t i = 0; i < m_moves.size(); ++i)
+	{
+		m_playerBroadphase.UpdateBody(m_movementEntities[i], m_moves[i].position, static_cast<uint32>(i));
+	}
+	m_playerBroadphase.RemoveStaleBodies();
+
+	m_separationCorrections.assign(m_moves.size(), Vec3(ZERO));
+	m_playerBroadphase.ComputeSeparation(min(m_cvars.g_playerSeparation, 1.f), m_separationCorrections);
+
+	for (size_t i = 0; i < m_moves.size(); ++i)
+	{
+		m_moves[i].displacement += m_separationCorrections[i];
+	}
+}
+
+void CGamePlugin::UpdateBroadcast()
+{
+	// 端口改变时重新监听
+	if (m_cvars.g_broadcastPort != m_broadcastPort)
+	{
+		m_broadcastPort = m_cvars.g_broadcastPort;
+		if (m_broadcastPort > 0 && m_broadcastPort <= 0xFFFF)
+		{
+			m_broadcastStream.Listen(static_cast<uint16>(m_broadcastPort));
+		}
+		else
+		{
+			m_broadcastStream.Close();
+		}
+	}
+
+	if (!m_broadcastStream.IsListening())
+		return;
+
+	const float serverTime = gEnv->pTimer->GetFrameStartTime().GetSeconds();
+
+	if (serverTime >= m_nextBroadcastCaptureTime)
+	{
+		m_nextBroadcastCaptureTime = m_cvars.g_broadcastRate > 0.f ? serverTime + 1.f / m_cvars.g_broadcastRate : serverTime;
+
+		// 所有观众共享同一份世界快照，不按观众裁剪
+		m_broadcastEntities.clear();
+		IterateOverPlayers([this](CPlayerComponent& player)
+		{
+			if (player.IsAlive() && !player.IsDormant())
+			{
+				m_broadcastEntities.push_back(CBroadcastStream::SEntityTransform{ player.GetEntityId(), QuatT(player.GetEntity()->GetWorldTM()) });
+			}
+		});
+
+		// 延迟队列须容纳延迟内采集的全部帧，速率为0时每帧采集，按当前帧率估计，留一倍余量应对帧率波动
+		const float captureRate = m_cvars.g_broadcastRate > 0.f ? m_cvars.g_broadcastRate : max(gEnv->pTimer->GetFrameRate(), 1.f);
+		const size_t maxQueuedFrames = static_cast<size_t>(max(m_cvars.g_broadcastDelay, 0.f) * captureRate * 2.f) + 1;
+
+		m_broadcastStream.Capture(serverTime, m_broadcastEntities, maxQueuedFrames);
+	}
+
+	m_broadcastStream.Update(serverTime, max(m_cvars.g_broadcastDelay, 0.f));
+}
+
+bool CGamePlugin::IsSpectatorChannel(INetChannel* pNetChannel)
+{
+	if (pNetChannel == nullptr || pNetChannel->IsLocal())
+		return false;
+
+	const char* szNickname = pNetChannel->GetNickname();
+	return szNickname != nullptr && strncmp(szNickname, SpectatorNicknamePrefix, strlen(SpectatorNicknamePrefix)) == 0;
+}
+
+void CGamePlugin::UpdateLockstep(float frameTime)
+{
+	m_lockstep.Configure(m_cvars.g_lockstepTickRate);
+	m_lockstep.SetPredictionTicks(m_cvars.g_lockstepPrediction);
+
+	// 长时间卡顿后最多追赶一秒
+	const float tickTime = 1.f / static_cast<float>(m_lockstep.GetTickRate());
+	m_lockstepAccumulator = min(m_lockstepAccumulator + frameTime, 1.f);
+
+	while (m_lockstepAccumulator >= tickTime)
+	{
+		m_lockstepAccumulator -= tickTime;
+
+		// 客户端没有玩家注册表，以模拟中的玩家为准
+		m_lockstep.GetPlayerIds(m_lockstepEntities);
+		for (const EntityId entityId : m_lockstepEntities)
+		{
+			IEntity* pPlayerEntity = gEnv->pEntitySystem->GetEntity(entityId);
+			CPlayerComponent* pPlayer = pPlayerEntity != nullptr ? pPlayerEntity->GetComponent<CPlayerComponent>() : nullptr;
+			if (pPlayer == nullptr)
+			{
+				m_lockstep.RemovePlayer(entityId);
+				continue;
+			}
+
+			if (pPlayer->IsLockstepOwner() && pPlayer->IsAlive() && !pPlayer->IsDormant())
+			{
+				pPlayer->UpdateLockstepInput(m_lockstepTick);
+			}
+		}
+
+		++m_lockstepTick;
+		m_lockstep.Advance(m_lockstepTick);
+
+		// 客户端定期通过本地玩家报告各玩家已确认的校验和，主机与服务器共享模拟不需要报告
+		if (!gEnv->bServer && m_cvars.g_lockstepChecksumInterval > 0 && m_lockstepTick % static_cast<uint32>(m_cvars.g_lockstepChecksumInterval) == 0)
+		{
+			for (const EntityId entityId : m_lockstepEntities)
+			{
+				IEntity* pPlayerEntity = gEnv->pEntitySystem->GetEntity(entityId);
+				CPlayerComponent* pPlayer = pPlayerEntity != nullptr ? pPlayerEntity->GetComponent<CPlayerComponent>() : nullptr;
+				if (pPlayer != nullptr && pPlayer->IsLocalClient())
+				{
+					pPlayer->ReportLockstepChecksums(m_lockstepEntities);
+					break;
+				}
+			}
+		}
+	}
+
+	if (gEnv->bServer)
+	{
+		VerifyLockstepChecksums();
+	}
+
+	m_lockstep.GetPlayerIds(m_lockstepEntities);
+	for (const EntityId entityId : m_lockstepEntities)
+	{
+		QuatT transform;
+		IEntity* pPlayerEntity = gEnv->pEntitySystem->GetEntity(entityId);
+		if (pPlayerEntity != nullptr && m_lockstep.GetTransform(entityId, transform))
+		{
+			pPlayerEntity->SetWorldTM(Matrix34(transform));
+		}
+	}
+}
+
+void CGamePlugin::QueueLockstepChecksum(const SLockstepChecksumReport& report)
+{
+	for (SLockstepChecksumReport& queuedReport : m_lockstepChecksumReports)
+	{
+		if (queuedReport.channelId == report.channelId && queuedReport.entityId == report.entityId)
+		{
+			queuedReport = report;
+			return;
+		}
+	}
+
+	m_lockstepChecksumReports.push_back(report);
+}
+
+void CGamePlugin::VerifyLockstepChecksums()
+{
+	for (size_t i = 0; i < m_lockstepChecksumReports.size();)
+	{
+		const SLockstepChecksumReport report = m_lockstepChecksumReports[i];
+		const CLockstepSimulation::EChecksumResult result = m_lockstep.VerifyChecksum(report.entityId, report.epoch, report.tick, report.checksum);
+
+		if (result == CLockstepSimulation::EChecksumResult::Pending)
+		{
+			++i;
+			continue;
+		}
+
+		m_lockstepChecksumReports[i] = m_lockstepChecksumReports.back();
+		m_lockstepChecksumReports.pop_back();
+
+		// 一致时不发送任何状态
+		if (result != CLockstepSimulation::EChecksumResult::Diverged)
+			continue;
+
+		IEntity* pPlayerEntity = gEnv->pEntitySystem->GetEntity(report.entityId);
+		if (CPlayerComponent* pPlayer = pPlayerEntity != nullptr ? pPlayerEntity->GetComponent<CPlayerComponent>() : nullptr)
+		{
+			CryLog("[Lockstep] Channel %d diverged on %s at tick %u, sending authoritative state", report.channelId, pPlayerEntity->GetName(), report.tick);
+			pPlayer->SendLockstepCorrectionOnServer(report.channelId, report.epoch, report.tick);
+		}
+	}
+}
+
+void CGamePlugin::CmdFlightRecorderDump(IConsoleCmdArgs* pArgs)
+{
+	CGamePlugin* pGamePlugin = CGamePlugin::GetInstance();
+	const float seconds = pArgs->GetArgCount() > 1 ? static_cast<float>(atof(pArgs->GetArg(1))) : pGamePlugin->m_cvars.g_flightRecorderDumpSeconds;
+
+	if (!pGamePlugin->m_flightRecorder.Dump(seconds))
+	{
+		CryLogAlways("[FlightRecorder] Nothing written (%u ticks recorded)", pGamePlugin->m_flightRecorder.GetRecordedTickCount());
+	}
+}
+
+void CGamePlugin::CmdLockstepStats(IConsoleCmdArgs* pArgs)
+{
+	const CGamePlugin* pGamePlugin = CGamePlugin::GetInstance();
+	const CLockstepSimulation& lockstep = pGamePlugin->m_lockstep;
+
+	CryLogAlways("[Lockstep] Tick %u at %d Hz, %" PRISIZE_T " players, %u rollbacks re-simulating %u ticks, %u inputs too late to roll back",
+		pGamePlugin->m_lockstepTick, lockstep.GetTickRate(), lockstep.GetPlayerCount(), lockstep.GetRollbackCount(), lockstep.GetResimulatedTickCount(), lockstep.GetLateInputCount());
+
+	// 服务器上为比较的结果，客户端上为收到的校正
+	if (gEnv->bServer)
+	{
+		const uint32 checkCount = lockstep.GetChecksumMatchCount() + lockstep.GetChecksumDivergenceCount();
+		CryLogAlways("[Lockstep] Checksums: %u verified, %u diverged (%.2f%%), %" PRISIZE_T " waiting",
+			checkCount, lockstep.GetChecksumDivergenceCount(), checkCount > 0 ? 100.f * static_cast<float>(lockstep.GetChecksumDivergenceCount()) / static_cast<float>(checkCount) : 0.f,
+			pGamePlugin->m_lockstepChecksumReports.size());
+	}
+	else
+	{
+		CryLogAlways("[Lockstep] Corrections received: %u", lockstep.GetCorrectionCount());
+	}
+}
+
+void CGamePlugin::UpdateZones()
+{
+	// 区域配置改变时重新连接，关卡加载前地图大小未知
+	const float worldSize = static_cast<float>(gEnv->p3DEngine->GetTerrainSize());
+	if (m_cvars.g_zoneCount != m_zoneConfigCount || m_cvars.g_zoneIndex != m_zoneConfigIndex || m_cvars.g_zoneBasePort != m_zoneConfigBasePort)
+	{
+		m_zoneConfigCount = m_cvars.g_zoneCount;
+		m_zoneConfigIndex = m_cvars.g_zoneIndex;
+		m_zoneConfigBasePort = m_cvars.g_zoneBasePort;
+
+		ClearZoneGhosts();
+		m_zoneLink.Stop();
+		m_zoneMap.Configure(m_zoneConfigCount, m_zoneConfigIndex, worldSize);
+
+		if (m_zoneMap.IsEnabled())
+		{
+			const ICVar* pServerPort = gEnv->pConsole->GetCVar("sv_port");
+			const uint16 gamePort = static_cast<uint16>(pServerPort != nullptr ? pServerPort->GetIVal() : 0);
+			m_zoneLink.Start(m_zoneMap.GetLocalZone(), m_zoneMap.GetZoneCount(), static_cast<uint16>(m_zoneConfigBasePort), gamePort);
+		}
+	}
+	else if (m_zoneMap.IsEnabled())
+	{
+		m_zoneMap.Configure(m_zoneConfigCount, m_zoneConfigIndex, worldSize);
+	}
+
+	if (!m_zoneMap.IsEnabled() || worldSize <= 0.f)
+		return;
+
+	CZoneLink::SCallbacks callbacks;
+	callbacks.onHandoff = [this](int sourceZone, const CZoneLink::SPlayerHandoff& handoff) { OnZoneHandoff(sourceZone, handoff); };
+	callbacks.onGhost = [this](int sourceZone, const CZoneLink::SGhostState& ghost) { OnZoneGhost(sourceZone, ghost); };
+	callbacks.onGhostRemove = [this](int sourceZone, EntityId sourceEntityId) { RemoveZoneGhost(sourceZone, sourceEntityId); };
+	callbacks.onHandoffClaimed = [this](int targetZone, uint64 handoffToken) { OnZoneHandoffClaimed(targetZone, handoffToken); };
+	m_zoneLink.Update(callbacks);
+
+	const int localZone = m_zoneMap.GetLocalZone();
+	const int frameId = gEnv->nMainFrameID;
+	std::vector<int> handedOffKeys;
+
+	{
+		CPlayerRegistry::CReadScope players(m_players);
+		for (const std::pair<const int, EntityId>& playerPair : *players)
+		{
+			IEntity* pPlayerEntity = gEnv->pEntitySystem->GetEntity(playerPair.second);
+			CPlayerComponent* pPlayer = pPlayerEntity != nullptr ? pPlayerEntity->GetComponent<CPlayerComponent>() : nullptr;
+			if (pPlayer == nullptr || !pPlayer->IsAlive() || pPlayer->IsDormant())
+				continue;
+
+			const EntityId entityId = playerPair.second;
+			const QuatT transform = QuatT(pPlayerEntity->GetWorldTM());
+
+			auto ghostedIt = m_ghostedPlayers.find(entityId);
+			const uint32 prevZoneMask = ghostedIt != m_ghostedPlayers.end() ? ghostedIt->second.zoneMask : 0;
+
+			// 移交：客户端以本次移交的随机令牌在目标区域取回玩家，没有会话令牌的频道(本地主机)留在本区域
+			const int targetZone = m_zoneMap.GetHandoffZone(transform.t, m_cvars.g_zoneHandoffMargin);
+			const bool bBot = playerPair.first < 0;
+			const bool bRemoteClient = !bBot && m_reconnectCache.GetSessionToken(playerPair.first) != 0;
+			if (targetZone != localZone && (bBot || bRemoteClient) && m_zoneLink.IsConnected(targetZone))
+			{
+				CZoneLink::SPlayerHandoff handoff = {};
+				pPlayer->WriteHandoff(handoff);
+				handoff.handoffToken = bBot ? 0 : CReconnectCache::GenerateSessionToken();
+
+				if (!m_zoneLink.SendHandoff(targetZone, handoff))
+					continue;
+
+				// 目标区域收到移交时自行移除它的幽灵，其他区域的幽灵在此移除
+				for (int zone = 0; zone < m_zoneMap.GetZoneCount(); ++zone)
+				{
+					if (zone != targetZone && (prevZoneMask & (1u << zone)) != 0)
+					{
+						m_zoneLink.SendGhostRemove(zone, entityId);
+					}
+				}
+				if (ghostedIt != m_ghostedPlayers.end())
+				{
+					m_ghostedPlayers.erase(ghostedIt);
+				}
+
+				if (bBot)
+				{
+					gEnv->pEntitySystem->RemoveEntity(entityId);
+					--m_botCount;
+				}
+				else
+				{
+					// 令牌只经RMI发给拥有者，客户端断开后重新连接到目标区域(完整的断开、连接与关卡加载，不是无缝切换)
+					// 目标区域确认客户端取回玩家(HandoffClaimed)之前本区域以同一令牌保留隐藏、不模拟的休眠副本，转移失败时客户端仍可回到本区域
+					// 即两个区域最多在g_zoneHandoffTimeout秒内同时持有该玩家，期间只有目标区域的副本可能被取回并模拟
+					pPlayer->TransferToZoneOnServer(m_zoneLink.GetGamePort(targetZone), handoff.handoffToken);
+					pPlayerEntity->GetNetEntity()->SetChannelId(0);
+					pPlayer->SetDormant(true);
+					m_reconnectCache.StoreDormant(handoff.handoffToken, entityId, m_cvars.g_zoneHandoffTimeout);
+				}
+
+				handedOffKeys.push_back(playerPair.first);
+				++m_handoffCount;
+				continue;
+			}
+
+			// 幽灵：边界附近的玩家每帧把变换发送给相邻区域，离开边界后移除
+			const uint32 zoneMask = m_zoneMap.GetGhostZoneMask(transform.t, m_cvars.g_zoneGhostDistance);
+			if (zoneMask == 0 && prevZoneMask == 0)
+				continue;
+
+			uint32 sentZoneMask = 0;
+			for (int zone = 0; zone < m_zoneMap.GetZoneCount(); ++zone)
+			{
+				const uint32 zoneBit = 1u << zone;
+				if ((zoneMask & zoneBit) != 0)
+				{
+					if (m_zoneLink.SendGhost(zone, CZoneLink::SGhostState{ entityId, transform.t, transform.q }))
+					{
+						sentZoneMask |= zoneBit;
+					}
+				}
+				else if ((prevZoneMask & zoneBit) != 0)
+				{
+					m_zoneLink.SendGhostRemove(zone, entityId);
+				}
+			}
+
+			if (sentZoneMask != 0)
+			{
+				m_ghostedPlayers[entityId] = SGhostedPlayer{ sentZoneMask, frameId };
+			}
+			else if (ghostedIt != m_ghostedPlayers.end())
+			{
+				m_ghostedPlayers.erase(ghostedIt);
+			}
+		}
+	}
+
+	if (!handedOffKeys.empty())
+	{
+		m_players.EraseRange(handedOffKeys);
+	}
+
+	// 本帧没有更新的幽灵属于已断开、死亡或休眠的玩家
+	for (auto it = m_ghostedPlayers.begin(); it != m_ghostedPlayers.end();)
+	{
+		if (it->second.frameId == frameId)
+		{
+			++it;
+			continue;
+		}
+
+		for (int zone = 0; zone < m_zoneMap.GetZoneCount(); ++zone)
+		{
+			if ((it->second.zoneMask & (1u << zone)) != 0)
+			{
+				m_zoneLink.SendGhostRemove(zone, it->first);
+			}
+		}
+		it = m_ghostedPlayers.erase(it);
+	}
+}
+
+void CGamePlugin::OnZoneHandoff(int sourceZone, const CZoneLink::SPlayerHandoff& handoff)
+{
+	// 幽灵由真实的玩家取代
+	RemoveZoneGhost(sourceZone, handoff.sourceEntityId);
+
+	SEntitySpawnParams spawnParams;
+	spawnParams.pClass = gEnv->pEntitySystem->GetClassRegistry()->GetDefaultClass();
+	spawnParams.sName = handoff.name;
+	spawnParams.vPosition = handoff.position;
+	spawnParams.qRotation = handoff.rotation;
+	if (handoff.bBot)
+	{
+		spawnParams.nFlags |= ENTITY_FLAG_NEVER_NETWORK_STATIC;
+	}
+
+	IEntity* pPlayerEntity = gEnv->pEntitySystem->SpawnEntity(spawnParams);
+	if (pPlayerEntity == nullptr)
+		return;
+
+	CPlayerComponent* pPlayer = pPlayerEntity->GetOrCreateComponentClass<CPlayerComponent>();
+	if (pPlayer == nullptr)
+	{
+		gEnv->pEntitySystem->RemoveEntity(pPlayerEntity->GetId());
+		return;
+	}
+
+	pPlayer->ReadHandoffOnServer(handoff);
+
+	if (handoff.bBot)
+	{
+		m_players.Insert(m_nextBotKey--, pPlayerEntity->GetId());
+		++m_botCount;
+	}
+	else
+	{
+		// 等待客户端以移交令牌连接，由ResumeDormantPlayer把它的频道绑定到此实体，并通知源区域移除它的副本
+		pPlayer->SetDormant(true);
+		m_reconnectCache.StoreDormant(handoff.handoffToken, pPlayerEntity->GetId(), m_cvars.g_zoneHandoffTimeout);
+
+		const uint64 handoffToken = handoff.handoffToken;
+		m_handoffSourceZones[handoffToken] = sourceZone;
+		m_timingWheel.Schedule(m_cvars.g_zoneHandoffTimeout, [this, handoffToken]() { m_handoffSourceZones.erase(handoffToken); });
+	}
+
+	CryLog("[Zones] Received %s from zone %d", handoff.name, sourceZone);
+}
+
+void CGamePlugin::OnZoneHandoffClaimed(int targetZone, uint64 handoffToken)
+{
+	// 客户端已在目标区域取回玩家，不会再回到本区域
+	const EntityId entityId = m_reconnectCache.TakeDormant(handoffToken);
+	if (entityId == INVALID_ENTITYID)
+		return;
+
+	gEnv->pEntitySystem->RemoveEntity(entityId);
+	CryLog("[Zones] Handoff to zone %d claimed, removed dormant copy", targetZone);
+}
+
+void CGamePlugin::OnZoneGhost(int sourceZone, const CZoneLink::SGhostState& ghost)
+{
+	const uint64 ghostKey = (static_cast<uint64>(sourceZone) << 32) | ghost.sourceEntityId;
+	const QuatT transform(ghost.position, ghost.rotation);
+
+	auto ghostIt = m_zoneGhosts.find(ghostKey);
+	if (ghostIt != m_zoneGhosts.end())
+	{
+		if (IEntity* pGhostEntity = gEnv->pEntitySystem->GetEntity(ghostIt->second))
+		{
+			if (CPlayerComponent* pGhost = pGhostEntity->GetComponent<CPlayerComponent>())
+			{
+				pGhost->ApplyGhostStateOnServer(transform);
+			}
+		}
+		return;
+	}
+
+	SEntitySpawnParams spawnParams;
+	spawnParams.pClass = gEnv->pEntitySystem->GetClassRegistry()->GetDefaultClass();
+	const string ghostName = string().Format("Ghost%d_%u", sourceZone, ghost.sourceEntityId);
+	spawnParams.sName = ghostName;
+	spawnParams.vPosition = ghost.position;
+	spawnParams.qRotation = ghost.rotation;
+	spawnParams.nFlags |= ENTITY_FLAG_NEVER_NETWORK_STATIC;
+
+	if (IEntity* pGhostEntity = gEnv->pEntitySystem->SpawnEntity(spawnParams))
+	{
+		if (CPlayerComponent* pGhost = pGhostEntity->GetOrCreateComponentClass<CPlayerComponent>())
+		{
+			pGhost->ApplyGhostStateOnServer(transform);
+			m_zoneGhosts.emplace(ghostKey, pGhostEntity->GetId());
+		}
+	}
+}
+
+void CGamePlugin::RemoveZoneGhost(int sourceZone, EntityId sourceEntityId)
+{
+	const uint64 ghostKey = (static_cast<uint64>(sourceZone) << 32) | sourceEntityId;
+
+	auto ghostIt = m_zoneGhosts.find(ghostKey);
+	if (ghostIt != m_zoneGhosts.end())
+	{
+		gEnv->pEntitySystem->RemoveEntity(ghostIt->second);
+		m_zoneGhosts.erase(ghostIt);
+	}
+}
+
+void CGamePlugin::ClearZoneGhosts()
+{
+	for (const std::pair<const uint64, EntityId>& ghost : m_zoneGhosts)
+	{
+		gEnv->pEntitySystem->RemoveEntity(ghost.second);
+	}
+	m_zoneGhosts.clear();
+	m_ghostedPlayers.clear();
+}
+
+void CGamePlugin::CmdZoneStatus(IConsoleCmdArgs* pArgs)
+{
+	const CGamePlugin* pGamePlugin = CGamePlugin::GetInstance();
+	const CZoneMap& zoneMap = pGamePlugin->m_zoneMap;
+
+	if (!zoneMap.IsEnabled())
+	{
+		CryLogAlways("[Zones] Zoning is disabled (g_zoneCount 1)");
+		return;
+	}
+
+	CryLogAlways("[Zones] Zone %d of %d: %" PRISIZE_T " linked zones, %" PRISIZE_T " owned players, %" PRISIZE_T " ghosts received, %" PRISIZE_T " players ghosted, %u handoffs sent",
+		zoneMap.GetLocalZone(), zoneMap.GetZoneCount(), pGamePlugin->m_zoneLink.GetConnectedCount(), pGamePlugin->m_players.GetSize(),
+		pGamePlugin->m_zoneGhosts.size(), pGamePlugin->m_ghostedPlayers.size(), pGamePlugin->m_handoffCount);
+}
+
+void CGamePlugin::CmdZoneTeleport(IConsoleCmdArgs* pArgs)
+{
+	CGamePlugin* pGamePlugin = CGamePlugin::GetInstance();
+	const CZoneMap& zoneMap = pGamePlugin->m_zoneMap;
+
+	if (!gEnv->bServer || !zoneMap.IsEnabled() || pArgs->GetArgCount() < 3)
+	{
+		CryLogAlways("[Zones] Usage: g_zoneTeleport <channelId> <zone> (server with g_zoneCount > 1)");
+		return;
+	}
+
+	const int channelId = atoi(pArgs->GetArg(1));
+	const int zone = atoi(pArgs->GetArg(2));
+	IEntity* pPlayerEntity = gEnv->pEntitySystem->GetEntity(pGamePlugin->m_players.Find(channelId));
+	CPlayerComponent* pPlayer = pPlayerEntity != nullptr ? pPlayerEntity->GetComponent<CPlayerComponent>() : nullptr;
+	if (pPlayer == nullptr || zone < 0 || zone >= zoneMap.GetZoneCount())
+	{
+		CryLogAlways("[Zones] No player on channel %d or zone %d does not exist", channelId, zone);
+		return;
+	}
+
+	// 下一次UpdateZones发现玩家在其他区域时移交，用于脚本化测试移交
+	const Vec2 center = zoneMap.GetZoneCenter(zone);
+	const Vec3 position(center.x, center.y, gEnv->p3DEngine->GetTerrainZ(center.x, center.y));
+	pPlayer->TeleportOnServer(Matrix34::Create(Vec3(1.f), pPlayerEntity->GetWorldRotation(), position));
+	CryLogAlways("[Zones] Teleported channel %d to zone %d", channelId, zone);
+}
+
+Vec2 CGamePlugin::GetSpawnCenter() const
+{
+	if (m_zoneMap.IsEnabled())
+	{
+		return m_zoneMap.GetZoneCenter(m_zoneMap.GetLocalZone());
+	}
+
+	const float terrainCenter = gEnv->p3DEngine->GetTerrainSize() / 2.f;
+	return Vec2(terrainCenter, terrainCenter);
+}
+
+Vec2 CGamePlugin::GetNextSpawnOffset()
+{
+	// 黄金角螺旋：半径随sqrt(index)增长，相邻出生点的间距大致恒定
+	const float goldenAngle = 2.39996323f;
+	// 出生点数量有限，循环使用，反复复活不会使半径无限增长而出生到区域或地形之外
+	const uint32 spawnPointCount = static_cast<uint32>(max(m_cvars.g_spawnPointCount, 1));
+	const uint32 spawnIndex = m_spawnIndex % spawnPointCount;
+	m_spawnIndex = (spawnIndex + 1) % spawnPointCount;
+	const float radius = m_cvars.g_spawnSpacing * sqrt_tpl(static_cast<float>(spawnIndex));
+	const float angle = static_cast<float>(spawnIndex) * goldenAngle;
+
+	return Vec2(cos_tpl(angle) * radius, sin_tpl(angle) * radius);
 }
 
 void CGamePlugin::IterateOverPlayers(std::function<void(CPlayerComponent& player)> func) const
 {
-	for (const std::pair<int, EntityId>& playerPair : m_players)
+	CPlayerRegistry::CReadScope players(m_players);
+	for (const std::pair<const int, EntityId>& playerPair : *players)
 	{
 		if (IEntity* pPlayerEntity = gEnv->pEntitySystem->GetEntity(playerPair.second))
 		{
@@ -5,6 +5,30 @@
 #include <CryEntitySystem/IEntityClass.h>
 #include <CryNetwork/INetwork.h>
 
+#include <unordered_set>
+
+#include "AdmissionController.h"
+#include "BroadcastStream.h"
+#include "CharacterController.h"
+#include "ClockSync.h"
+#include "FlightRecorder.h"
+#include "GameCVars.h"
+#include "InputLatencyTracker.h"
+#include "LevelPreloader.h"
+#include "LockstepSimulation.h"
+#include "PlayerBroadphase.h"
+#include "PlayerRegistry.h"
+#include "ReconnectCache.h"
+#include "ReplicationScheduler.h"
+#include "SimulationLod.h"
+#include "SnapshotCache.h"
+#include "StartupProfiler.h"
+#include "TerrainHeightCache.h"
+#include "TimingWheel.h"
+#include "TransformCodec.h"
+#include "ZoneLink.h"
+#include "ZoneMap.h"
+
 class CPlayerComponent;
 
 // 应用程序入口
@@ -30,6 +54,8 @@ public:
 	
 	// 从磁盘加载插件后不久调用，这通常是初始化任何第三方API和自定义代码的地方
 	virtual bool Initialize(SSystemGlobalEnvironment& env, const SSystemInitParams& initParams) override;
+	// 每帧主更新，用于处理断线重连宽限期等插件级逻辑
+	virtual void MainUpdate(float frameTime) override;
 	// ~Cry::IEnginePlugin
 
 	// ISystemEventListener
@@ -54,8 +80,76 @@ public:
 	// ~INetworkedClientListener
 
 	// Helper function，用来为每个游戏中的玩家调用特定函数
+	// 遍历的是调用时的快照，可在任意线程调用(组件访问本身仍需调用方保证安全)
 	void IterateOverPlayers(std::function<void(CPlayerComponent& player)> func) const;
 
+	const SGameCVars& GetCVars() const { return m_cvars; }
+
+	// 无缝切换到指定地图：保留已连接玩家的频道与状态，只替换世界
+	void ChangeMapSeamless(const char* szLevelName);
+	// 在后台预加载关卡，完成后再以服务器模式加载，bSeamless为true时保留已连接玩家
+	void RequestLevel(const char* szLevelName, bool bSeamless);
+
+	// 生成/移除服务器端机器人玩家，机器人以负数作为注册表中的键
+	void SpawnBots(int count);
+	void RemoveBots(int count);
+
+	// 关卡加载时构建的地形高度缓存，可在任意线程查询
+	const CTerrainHeightCache& GetTerrainHeightCache() const { return m_terrainHeightCache; }
+
+	// 下一个出生点相对出生中心的偏移，按螺旋排列避免玩家叠在同一点
+	Vec2 GetNextSpawnOffset();
+	// 出生中心：不分区时为地图中心，分区时为本进程拥有的区域的中心
+	Vec2 GetSpawnCenter() const;
+
+	// 服务器上的复制调度器，实体通过它请求复制而不是直接标记方面为脏
+	CReplicationScheduler& GetReplicationScheduler() { return m_replicationScheduler; }
+	// 每帧编码一次的方面数据，NetSerialize在各频道之间共享
+	CSnapshotCache& GetSnapshotCache() { return m_snapshotCache; }
+
+	// 共享的服务器时钟：客户端上为同步后的估计值，服务器上为本地时间
+	// 需要与服务器对齐的功能(插值、延迟补偿、输入时间戳)应使用它而不是本地帧时间
+	CClockSync& GetClockSync() { return m_clockSync; }
+	CTimeValue GetServerTime() const { return m_clockSync.GetServerTime(); }
+	// 客户端成为本地玩家的实体，时钟同步请求经由它发送
+	void SetLocalPlayer(EntityId entityId) { m_localPlayerId = entityId; }
+
+	// 客户端：服务器发来的会话令牌，附加到连接昵称上，断线后重新连接时随连接请求出示
+	void SetSessionToken(uint64 sessionToken) { SetNicknameToken(sessionToken); }
+	// 客户端：被移交到另一个区域，在那里出示移交令牌而不是当前的会话令牌
+	void SetHandoffToken(uint64 handoffToken) { SetNicknameToken(handoffToken); }
+
+	// 延迟执行的游戏逻辑(重生、宽限期、超时等)通过时间轮调度，而不是各自每帧检查时间戳
+	// 关卡卸载时所有定时器不触发地取消
+	CTimingWheel& GetTimingWheel() { return m_timingWheel; }
+
+	// 输入从客户端按键到服务器应用的延迟统计，服务器上按频道，客户端上为频道0
+	CInputLatencyTracker& GetInputLatencyTracker() { return m_inputLatencyTracker; }
+
+	// 锁步模式下所有对等端共享的确定性模拟，tick为本地的锁步tick计数
+	bool IsLockstepEnabled() const { return m_cvars.g_lockstep != 0; }
+	CLockstepSimulation& GetLockstepSimulation() { return m_lockstep; }
+	uint32 GetLockstepTick() const { return m_lockstepTick; }
+
+	// 客户端报告的某个玩家在tick的滚动校验和，服务器确认到该tick后比较，只在分歧时发送权威状态
+	// 只用于锁步模式：常规模式下MovementAspect的脏标记对所有频道同时生效，远程观察者并不预测该玩家，
+	// 无法因拥有者的校验和一致而对单个频道省略移动复制，常规模式仍以MovementAspect与本地误差阈值校正
+	struct SLockstepChecksumReport
+	{
+		int channelId;
+		EntityId entityId;
+		uint16 epoch;
+		uint32 tick;
+		uint32 checksum;
+	};
+	void QueueLockstepChecksum(const SLockstepChecksumReport& report);
+
+	// 昵称以此前缀开头的连接为观战者，服务器拒绝直接连接，观战者应连接到广播中继
+	static constexpr const char* SpectatorNicknamePrefix = "[spectator]";
+
+	// 玩家注册表，工作线程可通过CPlayerRegistry::CReadScope读取一致的快照
+	const CPlayerRegistry& GetPlayerRegistry() const { return m_players; }
+
 	// Helper function，用来取得CGamePlugin实例
 	// 注意CGamePlugin被声明为单例(singleton)，所以CreateClassInstance将总是返回同一指针
 	static CGamePlugin* GetInstance()
@@ -63,7 +157,175 @@ public:
 		return cryinterface_cast<CGamePlugin>(CGamePlugin::s_factory.CreateClassInstance().get());
 	}
 	
+protected:
+	// 无缝切换地图时跨越关卡卸载保留的玩家状态
+	struct SPersistentPlayer
+	{
+		EntityId entityId;
+		string name;
+		uint32 localPlayerFlag;
+		Vec3 position;
+		Quat rotation;
+	};
+
+	// 预加载完成后执行等待中的关卡切换
+	void UpdatePendingLevel();
+
+	// 生成玩家实体与组件，pPersistentPlayer不为空时恢复无缝切换地图前的玩家
+	void SpawnPlayer(int channelId, const SPersistentPlayer* pPersistentPlayer);
+	// 连接昵称带有的令牌匹配休眠玩家时，把新频道绑定到该实体，不再生成新玩家
+	bool ResumeDormantPlayer(int channelId, uint64 sessionToken);
+	// 客户端：把令牌写入cl_nickname的后缀，此后的connect随连接请求出示它
+	static void SetNicknameToken(uint64 sessionToken);
+	// 以有限速率准入排队中的连接
+	void AdmitPendingConnections();
+	// 收集观察者并为每个玩家选择模拟间隔
+	void UpdateSimulationLod();
+	// 收集所有存活玩家本帧的期望位移，批量解析碰撞后应用
+	void UpdatePlayerMovement();
+	// 把互相重叠的玩家推开，推开的距离加入m_moves的期望位移，由角色控制器解析碰撞
+	void SeparatePlayers();
+	// 锁步模式：按固定频率采集本地拥有的玩家的输入，推进确定性模拟并把结果应用到实体
+	void UpdateLockstep(float frameTime);
+	// 推进估计的服务器时间，客户端按间隔发送同步请求
+	void UpdateClockSync();
+	// 服务器比较客户端报告的校验和，向发生分歧的客户端发送校正
+	void VerifyLockstepChecksums();
+	// 按广播速率采集整个世界并发布延迟到期的帧
+	void UpdateBroadcast();
+	static bool IsSpectatorChannel(INetChannel* pNetChannel);
+	// 区域分片：处理相邻区域的消息，移交越过边界的玩家，把边界附近的玩家复制为幽灵
+	void UpdateZones();
+	void OnZoneHandoff(int sourceZone, const CZoneLink::SPlayerHandoff& handoff);
+	void OnZoneHandoffClaimed(int targetZone, uint64 handoffToken);
+	void OnZoneGhost(int sourceZone, const CZoneLink::SGhostState& ghost);
+	void RemoveZoneGhost(int sourceZone, EntityId sourceEntityId);
+	// 移除所有幽灵，用于区域配置改变
+	void ClearZoneGhosts();
+
+	// 控制台命令 g_changeMap <level>
+	static void CmdChangeMap(IConsoleCmdArgs* pArgs);
+	// 控制台命令 g_preloadLevel <level>
+	static void CmdPreloadLevel(IConsoleCmdArgs* pArgs);
+	// 控制台命令 g_cancelPreload
+	static void CmdCancelPreload(IConsoleCmdArgs* pArgs);
+	// 控制台命令 g_startupReport
+	static void CmdStartupReport(IConsoleCmdArgs* pArgs);
+	// 控制台命令 g_spawnBots <count> / g_removeBots [count]
+	static void CmdSpawnBots(IConsoleCmdArgs* pArgs);
+	static void CmdRemoveBots(IConsoleCmdArgs* pArgs);
+	// 控制台命令 g_benchPlayerBroadphase [iterations]
+	static void CmdBenchPlayerBroadphase(IConsoleCmdArgs* pArgs);
+	// 控制台命令 g_benchTransformCodec [iterations]
+	static void CmdBenchTransformCodec(IConsoleCmdArgs* pArgs);
+	// 控制台命令 g_replicationStats
+	static void CmdReplicationStats(IConsoleCmdArgs* pArgs);
+	// 控制台命令 g_zoneStatus
+	static void CmdZoneStatus(IConsoleCmdArgs* pArgs);
+	static void CmdZoneTeleport(IConsoleCmdArgs* pArgs);
+	// 控制台命令 g_clockSyncStats
+	static void CmdClockSyncStats(IConsoleCmdArgs* pArgs);
+	// 控制台命令 g_inputLatencyStats [reset]
+	static void CmdInputLatencyStats(IConsoleCmdArgs* pArgs);
+	// 控制台命令 g_flightRecorderDump [seconds]
+	static void CmdFlightRecorderDump(IConsoleCmdArgs* pArgs);
+	// 控制台命令 g_lockstepStats
+	static void CmdLockstepStats(IConsoleCmdArgs* pArgs);
+
 protected:
 	// 包含各个玩家组件的Map，键为在OnClientConnectionReceived中接收的频道id
-	std::unordered_map<int, EntityId> m_players;
+	// 可在任意线程读取快照，写入只发生在网络回调与关卡卸载中
+	CPlayerRegistry m_players;
+
+	// 延迟执行的游戏逻辑定时器，每帧在MainUpdate中推进
+	CTimingWheel m_timingWheel;
+
+	// 短暂断线的玩家实体在此休眠等待重连，宽限期过后移除
+	CReconnectCache m_reconnectCache{ m_timingWheel };
+
+	// 下一个机器人的注册表键(负数，不与频道id冲突)
+	int m_nextBotKey = -1;
+	// 机器人不占用客户端的玩家名额
+	size_t m_botCount = 0;
+
+	// 服务器过载时新连接在此排队
+	CAdmissionController m_admissionController;
+	// 上一帧MainUpdate本身的耗时(秒)，准入控制以它衡量服务器负载
+	float m_lastUpdateTime = 0.f;
+
+	// 无缝切换地图期间保留的玩家，键为频道id，在频道重置(bIsReset)后恢复
+	std::unordered_map<int, SPersistentPlayer> m_persistentPlayers;
+	// 已从m_persistentPlayers恢复、尚未准备好游戏的频道
+	std::unordered_set<int> m_restoredChannels;
+	// 正在进行的关卡切换是否为无缝切换，在执行map命令时设置，在卸载旧关卡、加载完成或失败时清除
+	bool m_bSeamlessTransition = false;
+
+	// 等待预加载完成后加载的关卡
+	string m_pendingLevel;
+	bool m_bPendingSeamless = false;
+	// 等待的关卡是否在后台预加载，完成后才执行map命令
+	bool m_bPendingPreload = false;
+	CLevelPreloader m_levelPreloader;
+
+	CStartupProfiler m_startupProfiler;
+	CFlightRecorder m_flightRecorder;
+
+	CTerrainHeightCache m_terrainHeightCache;
+	CCharacterController m_characterController;
+	CPlayerBroadphase m_playerBroadphase;
+	CSimulationLod m_simulationLod;
+	CReplicationScheduler m_replicationScheduler;
+	CSnapshotCache m_snapshotCache;
+	// 每帧收集的快照输入，复用以免每帧分配
+	std::vector<CSnapshotCache::SEntry> m_snapshotEntries;
+	CInputLatencyTracker m_inputLatencyTracker;
+	CClockSync m_clockSync;
+	EntityId m_localPlayerId = INVALID_ENTITYID;
+
+	CBroadcastStream m_broadcastStream;
+	// 上次尝试监听的端口，监听失败时不在每帧重试
+	int m_broadcastPort = 0;
+	float m_nextBroadcastCaptureTime = 0.f;
+	std::vector<CBroadcastStream::SEntityTransform> m_broadcastEntities;
+
+	CLockstepSimulation m_lockstep;
+	uint32 m_lockstepTick = 0;
+	// 尚未满一个锁步tick的时间
+	float m_lockstepAccumulator = 0.f;
+	std::vector<EntityId> m_lockstepEntities;
+	// 等待服务器模拟确认到所报告tick的校验和，每个频道与玩家只保留最新的一个
+	std::vector<SLockstepChecksumReport> m_lockstepChecksumReports;
+
+	// 区域分片，m_players只包含本区域拥有的玩家，幽灵另行记录
+	CZoneMap m_zoneMap;
+	CZoneLink m_zoneLink;
+	// 当前生效的区域配置，cvar改变时重新配置
+	int m_zoneConfigCount = 1;
+	int m_zoneConfigIndex = 0;
+	int m_zoneConfigBasePort = 0;
+	// 相邻区域拥有的玩家在本区域的幽灵实体，键为(源区域 << 32 | 源实体id)
+	std::unordered_map<uint64, EntityId> m_zoneGhosts;
+	// 收到的移交中尚未被客户端取回的，<移交令牌, 源区域>，取回时通知源区域
+	std::unordered_map<uint64, int> m_handoffSourceZones;
+	// 本区域的玩家已作为幽灵复制到的区域
+	struct SGhostedPlayer
+	{
+		uint32 zoneMask;
+		int frameId;
+	};
+	std::unordered_map<EntityId, SGhostedPlayer> m_ghostedPlayers;
+	uint32 m_handoffCount = 0;
+
+	// 本关卡已分配的出生点数量
+	uint32 m_spawnIndex = 0;
+
+	// UpdatePlayerMovement每帧复用的缓冲
+	std::vector<EntityId> m_movementEntities;
+	std::vector<CCharacterController::SMove> m_moves;
+	std::vector<float> m_groundClampX;
+	std::vector<float> m_groundClampY;
+	std::vector<float> m_groundClampHeights;
+	std::vector<Vec3> m_separationCorrections;
+
+	SGameCVars m_cvars;
 };
\ No newline at end of file
@@ -0,0 +1,107 @@
+#include "StdAfx.h"
+#include "InputLatencyTracker.h"
+
+constexpr uint32 CInputLatencyTracker::BucketLimitsMs[];
+
+namespace
+{
+	void LogHistogram(const char* szLabel, const CInputLatencyTracker::SHistogram& histogram)
+	{
+		if (histogram.count == 0)
+		{
+			CryLogAlways("[InputLatency]   %-10s no samples", szLabel);
+			return;
+		}
+
+		CryLogAlways("[InputLatency]   %-10s %u samples, avg %.1f ms, p50 <=%u ms, p95 <=%u ms, p99 <=%u ms, max %u ms", szLabel, histogram.count,
+			histogram.GetAverageMs(), histogram.GetPercentileMs(0.5f), histogram.GetPercentileMs(0.95f), histogram.GetPercentileMs(0.99f), histogram.maxMs);
+
+		string buckets;
+		for (size_t i = 0; i < CInputLatencyTracker::BucketCount; ++i)
+		{
+			if (i + 1 < CInputLatencyTracker::BucketCount)
+			{
+				buckets.AppendFormat(" <=%u:%u", CInputLatencyTracker::BucketLimitsMs[i], histogram.buckets[i]);
+			}
+			else
+			{
+				buckets.AppendFormat(" >%u:%u", CInputLatencyTracker::BucketLimitsMs[i - 1], histogram.buckets[i]);
+			}
+		}
+		CryLogAlways("[InputLatency]   %-10s%s", "", buckets.c_str());
+	}
+}
+
+void CInputLatencyTracker::SHistogram::Add(uint32 valueMs)
+{
+	size_t bucket = 0;
+	while (bucket + 1 < BucketCount && valueMs > BucketLimitsMs[bucket])
+	{
+		++bucket;
+	}
+
+	++buckets[bucket];
+	++count;
+	totalMs += valueMs;
+	maxMs = max(maxMs, valueMs);
+}
+
+uint32 CInputLatencyTracker::SHistogram::GetPercentileMs(float percentile) const
+{
+	if (count == 0)
+		return 0;
+
+	const uint32 targetCount = max(static_cast<uint32>(ceil_tpl(static_cast<float>(count) * percentile)), 1u);
+
+	uint32 cumulativeCount = 0;
+	for (size_t i = 0; i + 1 < BucketCount; ++i)
+	{
+		cumulativeCount += buckets[i];
+		if (cumulativeCount >= targetCount)
+			return min(BucketLimitsMs[i], maxMs);
+	}
+
+	return maxMs;
+}
+
+CInputLatencyTracker::SHistogram CInputLatencyTracker::GetCombinedRoundTrip() const
+{
+	SHistogram combined;
+	for (const std::pair<const int, SChannel>& channelPair : m_channels)
+	{
+		const SHistogram& roundTrip = channelPair.second.roundTrip;
+		for (size_t i = 0; i < BucketCount; ++i)
+		{
+			combined.buckets[i] += roundTrip.buckets[i];
+		}
+		combined.count += roundTrip.count;
+		combined.totalMs += roundTrip.totalMs;
+		combined.maxMs = max(combined.maxMs, roundTrip.maxMs);
+	}
+
+	return combined;
+}
+
+void CInputLatencyTracker::LogReport() const
+{
+	if (m_channels.empty())
+	{
+		CryLogAlways("[InputLatency] No input latency samples");
+		return;
+	}
+
+	for (const std::pair<const int, SChannel>& channelPair : m_channels)
+	{
+		if (channelPair.first == 0)
+		{
+			CryLogAlways("[InputLatency] Server:");
+		}
+		else
+		{
+			CryLogAlways("[InputLatency] Channel %d:", channelPair.first);
+		}
+
+		LogHistogram("hold", channelPair.second.serverHold);
+		LogHistogram("roundtrip", channelPair.second.roundTrip);
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <map>
+
+// 输入延迟追踪
+// 客户端在HandleInputFlagChange时为输入变化打上时间戳，随输入方面发送
+// 服务器记录收到(NetSerialize读取)与应用(下一次解析该玩家的移动)的时间，把时间戳与两者之差回传
+// 客户端以自己的时钟算出从按键到服务器应用再返回的往返时间，并在下一个时间戳中报告给服务器
+// 两个时钟之间不做比较，因此不需要时钟同步
+//
+// 服务器上按频道统计服务器内的等待时间与客户端报告的往返时间，客户端上以频道0统计自己到服务器的测量
+class CInputLatencyTracker
+{
+public:
+	// 直方图的桶上限(毫秒)，最后一个桶收纳更大的值
+	static constexpr uint32 BucketLimitsMs[] = { 5, 10, 20, 35, 50, 75, 100, 150, 200, 300, 500 };
+	static constexpr size_t BucketCount = CRY_ARRAY_COUNT(BucketLimitsMs) + 1;
+
+	struct SHistogram
+	{
+		void Add(uint32 valueMs);
+		// 按桶估计的百分位数，返回所在桶的上限
+		uint32 GetPercentileMs(float percentile) const;
+		float GetAverageMs() const { return count > 0 ? static_cast<float>(totalMs) / static_cast<float>(count) : 0.f; }
+
+		uint32 buckets[BucketCount] = {};
+		uint32 count = 0;
+		uint64 totalMs = 0;
+		uint32 maxMs = 0;
+	};
+
+	struct SChannel
+	{
+		// 服务器收到输入到应用之间的等待
+		SHistogram serverHold;
+		// 客户端从按键到收到回传的往返
+		SHistogram roundTrip;
+	};
+
+	void RecordServerHold(int channelId, uint32 holdMs) { m_channels[channelId].serverHold.Add(holdMs); }
+	void RecordRoundTrip(int channelId, uint32 roundTripMs) { m_channels[channelId].roundTrip.Add(roundTripMs); }
+
+	void RemoveChannel(int channelId) { m_channels.erase(channelId); }
+	void Clear() { m_channels.clear(); }
+
+	// 所有频道合并后的往返时间
+	SHistogram GetCombinedRoundTrip() const;
+
+	// 输出每个频道的直方图
+	void LogReport() const;
+
+protected:
+	// 按频道id有序，报告顺序稳定
+	std::map<int, SChannel> m_channels;
+};
@@ -0,0 +1,139 @@
+#include "StdAfx.h"
+#include "LevelPreloader.h"
+
+#include <CryGame/IGameFramework.h>
+#include <CrySystem/File/ICryPak.h>
+#include <ILevelSystem.h>
+
+namespace
+{
+	// 关卡目录下需要预读的文件，在map命令中会被依次打开
+	const char* const s_levelFiles[] =
+	{
+		"level.pak",
+		"terraintexture.pak"
+	};
+}
+
+CLevelPreloader::~CLevelPreloader()
+{
+	Cancel();
+}
+
+void CLevelPreloader::Preload(const char* szLevelName)
+{
+	if (m_state != EState::Idle && m_levelName.compareNoCase(szLevelName) == 0)
+		return;
+
+	Cancel();
+
+	m_levelName = szLevelName;
+	m_files.clear();
+	m_currentFile = 0;
+	m_currentOffset = 0;
+	m_totalBytes = 0;
+
+	ILevelInfo* pLevelInfo = gEnv->pGameFramework->GetILevelSystem()->GetLevelInfo(szLevelName);
+	if (pLevelInfo == nullptr)
+	{
+		CryWarning(VALIDATOR_MODULE_GAME, VALIDATOR_WARNING, "[LevelPreloader] Unknown level '%s'", szLevelName);
+		m_state = EState::Failed;
+		return;
+	}
+
+	for (const char* szFileName : s_levelFiles)
+	{
+		const string filePath = PathUtil::Make(pLevelInfo->GetPath(), szFileName);
+		const size_t fileSize = gEnv->pCryPak->FGetSize(filePath.c_str(), true);
+		if (fileSize > 0)
+		{
+			m_files.push_back(SFile{ filePath, fileSize });
+		}
+	}
+
+	m_state = EState::Streaming;
+	m_startTime = gEnv->pTimer->GetAsyncTime();
+	m_chunkBuffer.resize(ChunkSize);
+
+	StartNextRead();
+}
+
+void CLevelPreloader::Cancel()
+{
+	// 先回到空闲状态：Abort会以中止错误调用StreamOnComplete，此时不再把取消当作读取失败
+	m_state = EState::Idle;
+	m_levelName.clear();
+	m_files.clear();
+
+	if (m_pReadStream)
+	{
+		IReadStreamPtr pReadStream = m_pReadStream;
+		m_pReadStream = nullptr;
+		pReadStream->Abort();
+	}
+
+	m_chunkBuffer.clear();
+	m_chunkBuffer.shrink_to_fit();
+}
+
+bool CLevelPreloader::IsFinished(const char* szLevelName) const
+{
+	if (m_levelName.compareNoCase(szLevelName) != 0)
+		return false;
+
+	// 预加载失败不阻塞关卡切换，map命令会照常同步加载
+	return m_state == EState::Ready || m_state == EState::Failed;
+}
+
+void CLevelPreloader::StreamOnComplete(IReadStream* pStream, unsigned nError)
+{
+	m_pReadStream = nullptr;
+
+	if (m_state != EState::Streaming)
+		return;
+
+	if (nError != 0)
+	{
+		CryWarning(VALIDATOR_MODULE_GAME, VALIDATOR_WARNING, "[LevelPreloader] Failed to read '%s' (error %u)", m_files[m_currentFile].path.c_str(), nError);
+		m_state = EState::Failed;
+		m_chunkBuffer.clear();
+		return;
+	}
+
+	m_totalBytes += pStream->GetBytesRead();
+	m_currentOffset += pStream->GetBytesRead();
+
+	StartNextRead();
+}
+
+void CLevelPreloader::StartNextRead()
+{
+	// 跳过已读完的文件
+	while (m_currentFile < m_files.size() && m_currentOffset >= m_files[m_currentFile].size)
+	{
+		++m_currentFile;
+		m_currentOffset = 0;
+	}
+
+	if (m_currentFile >= m_files.size())
+	{
+		m_state = EState::Ready;
+		m_chunkBuffer.clear();
+		m_chunkBuffer.shrink_to_fit();
+
+		const float elapsedMs = (gEnv->pTimer->GetAsyncTime() - m_startTime).GetMilliSeconds();
+		CryLog("[LevelPreloader] Preloaded level '%s': %" PRISIZE_T " bytes in %.1f ms", m_levelName.c_str(), m_totalBytes, elapsedMs);
+		return;
+	}
+
+	const SFile& file = m_files[m_currentFile];
+
+	StreamReadParams params;
+	params.nOffset = static_cast<unsigned>(m_currentOffset);
+	params.nSize = static_cast<unsigned>(min(static_cast<size_t>(ChunkSize), file.size - m_currentOffset));
+	params.pBuffer = m_chunkBuffer.data();
+	// 以最低优先级读取，不与游戏中的流式加载竞争
+	params.ePriority = estpIdle;
+
+	m_pReadStream = gEnv->pSystem->GetStreamEngine()->StartRead(eStreamTaskTypePak, file.path.c_str(), this, &params);
+}
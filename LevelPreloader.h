@@ -0,0 +1,61 @@
+#pragma once
+
+#include <CrySystem/IStreamEngine.h>
+
+#include <vector>
+
+// 关卡资源后台预加载
+// 通过流引擎(stream engine)在后台分块读取关卡的pak文件，使其进入系统文件缓存
+// 之后执行的map命令只需从缓存中读取，切换关卡时不再等待磁盘
+class CLevelPreloader final : public IStreamCallback
+{
+public:
+	enum class EState : uint8
+	{
+		Idle = 0,
+		Streaming,
+		Ready,
+		Failed
+	};
+
+	virtual ~CLevelPreloader();
+
+	// 开始预加载指定关卡，若该关卡已在预加载或已完成则什么都不做
+	void Preload(const char* szLevelName);
+	// 取消当前预加载并回到空闲状态，已完成的预加载同样被丢弃
+	void Cancel();
+
+	EState GetState() const { return m_state; }
+	const string& GetLevelName() const { return m_levelName; }
+	// 关卡是否已完成预加载(或者无需预加载)，可以立即切换
+	bool IsFinished(const char* szLevelName) const;
+
+	// IStreamCallback
+	virtual void StreamOnComplete(IReadStream* pStream, unsigned nError) override;
+	// ~IStreamCallback
+
+protected:
+	void StartNextRead();
+
+protected:
+	// 每次读取的块大小，限制预加载占用的内存
+	static constexpr uint32 ChunkSize = 4 * 1024 * 1024;
+
+	struct SFile
+	{
+		string path;
+		size_t size;
+	};
+
+	EState m_state = EState::Idle;
+	string m_levelName;
+
+	std::vector<SFile> m_files;
+	size_t m_currentFile = 0;
+	size_t m_currentOffset = 0;
+	size_t m_totalBytes = 0;
+
+	std::vector<uint8> m_chunkBuffer;
+	IReadStreamPtr m_pReadStream;
+	CTimeValue m_startTime;
+};
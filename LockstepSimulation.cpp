@@ -0,0 +1,517 @@
+#include "StdAfx.h"
+#include "LockstepSimulation.h"
+#include "TerrainHeightCache.h"
+
+#include <CryMath/Cry_Camera.h>
+
+namespace
+{
+	// 与CPlayerComponent的移动速度(米/秒)与鼠标旋转速度(弧度/单位)一致
+	constexpr int32 MoveSpeedFixed = static_cast<int32>(20.5 * CLockstepSimulation::FixedOne);
+	// 与CCharacterController的重力加速度(米/秒^2)一致
+	constexpr int32 GravityFixed = static_cast<int32>(9.81 * CLockstepSimulation::FixedOne);
+	constexpr float RotationSpeed = 0.002f;
+	constexpr float AngleUnitsPerRadian = 65536.f / gf_PI2;
+
+	uint16 AngleFromRadians(float radians)
+	{
+		return static_cast<uint16>(static_cast<int32>(floor_tpl(radians * AngleUnitsPerRadian + 0.5f)) & 0xFFFF);
+	}
+
+	float RadiansFromAngle(uint16 angle)
+	{
+		return static_cast<float>(static_cast<int16>(angle)) / AngleUnitsPerRadian;
+	}
+
+	int32 FixedFromFloat(float value)
+	{
+		return static_cast<int32>(floor_tpl(value * static_cast<float>(CLockstepSimulation::FixedOne) + 0.5f));
+	}
+}
+
+void CLockstepSimulation::Configure(int tickRate)
+{
+	m_tickRate = max(tickRate, 1);
+	m_moveStep = MoveSpeedFixed / m_tickRate;
+	m_gravityStep = GravityFixed / m_tickRate;
+}
+
+void CLockstepSimulation::Clear()
+{
+	m_players.clear();
+	m_rollbackCount = 0;
+	m_resimulatedTickCount = 0;
+	m_lateInputCount = 0;
+	m_checksumMatchCount = 0;
+	m_checksumDivergenceCount = 0;
+	m_correctionCount = 0;
+}
+
+void CLockstepSimulation::RemovePlayer(EntityId entityId)
+{
+	m_players.erase(entityId);
+}
+
+void CLockstepSimulation::SetSpawn(EntityId entityId, uint16 epoch, const SState& spawnState)
+{
+	SPlayer& player = m_players[entityId];
+	player.spawnEpoch = epoch;
+	player.spawnState = spawnState;
+	player.bHasSpawn = true;
+
+	// 新纪元开始前的模拟作废，等待该纪元的第一个输入
+	if (player.epoch != epoch)
+	{
+		player.bStarted = false;
+	}
+
+	FlushPendingInputs(entityId, player);
+}
+
+bool CLockstepSimulation::GetHistory(EntityId entityId, SHistory& history) const
+{
+	auto it = m_players.find(entityId);
+	if (it == m_players.end() || !it->second.bHasSpawn)
+		return false;
+
+	const SPlayer& player = it->second;
+	history.epoch = player.spawnEpoch;
+	history.spawnState = player.spawnState;
+	history.bStarted = player.bStarted && player.epoch == player.spawnEpoch && player.lastConfirmedTick != InvalidTick;
+	history.inputs.clear();
+	if (!history.bStarted)
+		return true;
+
+	// 历史中最早的状态：更早的输入迟到时已无法回滚，因此它不会再改变
+	const uint32 simulatedTicks = player.simulatedTick - player.startTick;
+	history.baseTick = simulatedTicks < HistorySize ? player.startTick : player.simulatedTick - (HistorySize - 1);
+	history.baseState = player.states[history.baseTick % HistorySize];
+	history.baseChecksum = player.checksums[history.baseTick % HistorySize];
+
+	if (static_cast<int32>(player.lastConfirmedTick - history.baseTick) < 0)
+		return true;
+
+	// 拥有者的输入可靠有序地到达，已确认的tick是连续的；成为定局的tick以模拟时使用的输入代替
+	const uint32 inputCount = min(player.lastConfirmedTick - history.baseTick + 1, static_cast<uint32>(HistorySize));
+	history.inputs.reserve(inputCount);
+	for (uint32 i = 0; i < inputCount; ++i)
+	{
+		const uint32 tick = history.baseTick + i;
+		const uint32 index = tick % HistorySize;
+		history.inputs.push_back(player.confirmedTicks[index] == tick ? player.confirmedInputs[index] : player.usedInputs[index]);
+	}
+
+	return true;
+}
+
+void CLockstepSimulation::LoadHistory(EntityId entityId, const SHistory& history, uint32 localTick)
+{
+	SPlayer& player = m_players[entityId];
+	player.spawnEpoch = history.epoch;
+	player.spawnState = history.spawnState;
+	player.bHasSpawn = true;
+	player.bStarted = false;
+
+	if (history.bStarted)
+	{
+		StartEpoch(player, history.epoch, history.baseTick);
+		player.states[history.baseTick % HistorySize] = history.baseState;
+		player.checksums[history.baseTick % HistorySize] = history.baseChecksum;
+
+		// 最后一个输入与刚转发的输入一样视为在本地tick产生，之前的依次提前，以此换算拥有者的tick
+		const uint32 lastTick = history.baseTick + static_cast<uint32>(history.inputs.size()) - 1;
+		for (uint32 i = 0; i < history.inputs.size(); ++i)
+		{
+			const uint32 tick = history.baseTick + i;
+			ApplyInput(player, tick, history.inputs[i], localTick - (lastTick - tick));
+		}
+	}
+
+	FlushPendingInputs(entityId, player);
+}
+
+bool CLockstepSimulation::GetSpawnEpoch(EntityId entityId, uint16& epoch) const
+{
+	auto it = m_players.find(entityId);
+	if (it == m_players.end() || !it->second.bHasSpawn)
+		return false;
+
+	epoch = it->second.spawnEpoch;
+	return true;
+}
+
+void CLockstepSimulation::AddInput(EntityId entityId, uint16 epoch, uint32 epochStartTick, uint32 tick, const SInput& input, uint32 localTick)
+{
+	SPlayer& player = m_players[entityId];
+
+	// 以环绕的16位比较纪元，旧纪元的输入直接丢弃
+	const int16 epochDifference = static_cast<int16>(epoch - player.spawnEpoch);
+	if (!player.bHasSpawn || epochDifference > 0)
+	{
+		if (player.pendingInputs.size() < HistorySize)
+		{
+			player.pendingInputs.push_back(SPlayer::SPendingInput{ epoch, epochStartTick, tick, input, localTick });
+		}
+		return;
+	}
+	if (epochDifference < 0)
+		return;
+
+	if (!player.bStarted || player.epoch != epoch)
+	{
+		StartEpoch(player, epoch, epochStartTick);
+	}
+
+	ApplyInput(player, tick, input, localTick);
+}
+
+void CLockstepSimulation::Advance(uint32 localTick)
+{
+	for (std::pair<const EntityId, SPlayer>& playerPair : m_players)
+	{
+		SPlayer& player = playerPair.second;
+		if (!player.bStarted)
+			continue;
+
+		// 回滚：tick开始时的状态仍在历史中，从那里以已确认的输入重新模拟
+		if (player.rollbackTick != InvalidTick)
+		{
+			const uint32 resimulatedTicks = player.simulatedTick - player.rollbackTick;
+			const uint32 targetTick = player.simulatedTick;
+
+			player.simulatedTick = player.rollbackTick;
+			player.rollbackTick = InvalidTick;
+			Simulate(player, targetTick);
+
+			++m_rollbackCount;
+			m_resimulatedTickCount += resimulatedTicks;
+		}
+
+		const uint32 targetTick = static_cast<uint32>(static_cast<int32>(localTick) + player.tickOffset + (player.bOwnedLocally ? 0 : m_predictionTicks));
+		if (static_cast<int32>(targetTick - player.simulatedTick) > 0)
+		{
+			Simulate(player, targetTick);
+		}
+	}
+}
+
+bool CLockstepSimulation::GetTransform(EntityId entityId, QuatT& transform) const
+{
+	auto it = m_players.find(entityId);
+	if (it == m_players.end() || !it->second.bStarted)
+		return false;
+
+	const SPlayer& player = it->second;
+	transform = TransformFromState(player.states[player.simulatedTick % HistorySize]);
+	return true;
+}
+
+void CLockstepSimulation::GetPlayerIds(std::vector<EntityId>& entityIds) const
+{
+	entityIds.clear();
+	entityIds.reserve(m_players.size());
+	for (const std::pair<const EntityId, SPlayer>& playerPair : m_players)
+	{
+		entityIds.push_back(playerPair.first);
+	}
+}
+
+bool CLockstepSimulation::GetConfirmedChecksum(EntityId entityId, uint16& epoch, uint32& tick, uint32& checksum) const
+{
+	auto it = m_players.find(entityId);
+	if (it == m_players.end())
+		return false;
+
+	const SPlayer& player = it->second;
+	if (!player.bStarted || player.lastConfirmedTick == InvalidTick || player.rollbackTick != InvalidTick)
+		return false;
+
+	// tick t开始时的状态只取决于t之前的输入
+	const uint32 confirmedTick = player.lastConfirmedTick + 1;
+	tick = static_cast<int32>(player.simulatedTick - confirmedTick) < 0 ? player.simulatedTick : confirmedTick;
+	epoch = player.epoch;
+	checksum = player.checksums[tick % HistorySize];
+	return true;
+}
+
+CLockstepSimulation::EChecksumResult CLockstepSimulation::VerifyChecksum(EntityId entityId, uint16 epoch, uint32 tick, uint32 checksum)
+{
+	auto it = m_players.find(entityId);
+	if (it == m_players.end() || !it->second.bStarted)
+		return EChecksumResult::Expired;
+
+	const SPlayer& player = it->second;
+	const int16 epochDifference = static_cast<int16>(epoch - player.epoch);
+	if (epochDifference > 0 || (epochDifference == 0 && static_cast<int32>(tick - player.simulatedTick) > 0))
+		return EChecksumResult::Pending;
+	if (epochDifference < 0 || !IsInHistory(player, tick))
+		return EChecksumResult::Expired;
+
+	// 本地在该tick的状态仍含有预测
+	if (player.lastConfirmedTick == InvalidTick || player.rollbackTick != InvalidTick || static_cast<int32>(tick - (player.lastConfirmedTick + 1)) > 0)
+		return EChecksumResult::Pending;
+
+	if (player.checksums[tick % HistorySize] == checksum)
+	{
+		++m_checksumMatchCount;
+		return EChecksumResult::Match;
+	}
+
+	++m_checksumDivergenceCount;
+	return EChecksumResult::Diverged;
+}
+
+bool CLockstepSimulation::GetHistoryState(EntityId entityId, uint32 tick, SState& state, uint32& checksum) const
+{
+	auto it = m_players.find(entityId);
+	if (it == m_players.end() || !it->second.bStarted || !IsInHistory(it->second, tick))
+		return false;
+
+	state = it->second.states[tick % HistorySize];
+	checksum = it->second.checksums[tick % HistorySize];
+	return true;
+}
+
+void CLockstepSimulation::ApplyCorrection(EntityId entityId, uint16 epoch, uint32 tick, const SState& state, uint32 checksum)
+{
+	auto it = m_players.find(entityId);
+	if (it == m_players.end())
+		return;
+
+	SPlayer& player = it->second;
+	if (!player.bStarted || player.epoch != epoch || !IsInHistory(player, tick))
+		return;
+
+	const uint32 index = tick % HistorySize;
+	player.states[index] = state;
+	player.checksums[index] = checksum;
+
+	// 从校正的tick起以已有的输入重新模拟，下一次Advance执行
+	if (player.rollbackTick == InvalidTick || static_cast<int32>(player.rollbackTick - tick) > 0)
+	{
+		player.rollbackTick = tick;
+	}
+	++m_correctionCount;
+}
+
+CLockstepSimulation::SState CLockstepSimulation::Step(const SState& state, const SInput& input) const
+{
+	int32 localX = 0;
+	int32 localY = 0;
+
+	if (input.flags & MoveLeft)
+	{
+		localX -= m_moveStep;
+	}
+	if (input.flags & MoveRight)
+	{
+		localX += m_moveStep;
+	}
+	if (input.flags & MoveForward)
+	{
+		localY += m_moveStep;
+	}
+	if (input.flags & MoveBack)
+	{
+		localY -= m_moveStep;
+	}
+
+	// 以移动前的偏航角把本地速度转换到世界空间，输入只在水平面上移动
+	const int64 sinYaw = Sin(state.yaw);
+	const int64 cosYaw = Cos(state.yaw);
+
+	SState next = state;
+	next.x += static_cast<int32>((cosYaw * localX - sinYaw * localY) >> FixedShift);
+	next.y += static_cast<int32>((sinYaw * localX + cosYaw * localY) >> FixedShift);
+
+	// 重力下落(半隐式欧拉)，落到移动后所在位置的地面时停止，上坡时抬到地面高度
+	next.groundZ = GetGroundHeight(next.x, next.y);
+	next.verticalSpeed = state.verticalSpeed - m_gravityStep;
+	next.z = state.z + next.verticalSpeed / m_tickRate;
+	if (next.z <= next.groundZ)
+	{
+		next.z = next.groundZ;
+		next.verticalSpeed = 0;
+	}
+	next.yaw = static_cast<uint16>(state.yaw + input.yawDelta);
+	next.pitch = static_cast<uint16>(state.pitch + input.pitchDelta);
+
+	return next;
+}
+
+CLockstepSimulation::SState CLockstepSimulation::StateFromTransform(const QuatT& transform) const
+{
+	const Ang3 ypr = CCamera::CreateAnglesYPR(Matrix33(transform.q));
+
+	SState state;
+	state.x = FixedFromFloat(transform.t.x);
+	state.y = FixedFromFloat(transform.t.y);
+	state.z = FixedFromFloat(transform.t.z);
+	state.verticalSpeed = 0;
+	state.groundZ = GetGroundHeight(state.x, state.y);
+	state.yaw = AngleFromRadians(ypr.x);
+	state.pitch = AngleFromRadians(ypr.y);
+	return state;
+}
+
+QuatT CLockstepSimulation::TransformFromState(const SState& state)
+{
+	const float scale = 1.f / static_cast<float>(FixedOne);
+	const Vec3 position(static_cast<float>(state.x) * scale, static_cast<float>(state.y) * scale, static_cast<float>(state.z) * scale);
+	const Ang3 ypr(RadiansFromAngle(state.yaw), RadiansFromAngle(state.pitch), 0.f);
+
+	return QuatT(Quat(CCamera::CreateOrientationYPR(ypr)), position);
+}
+
+int32 CLockstepSimulation::GetGroundHeight(int32 x, int32 y) const
+{
+	return m_pTerrain != nullptr ? m_pTerrain->GetHeightFixed(x, y) : 0;
+}
+
+int16 CLockstepSimulation::QuantizeRotation(float mouseDelta, float& remainder)
+{
+	const float angle = mouseDelta * RotationSpeed * AngleUnitsPerRadian + remainder;
+	const float clampedAngle = clamp_tpl(angle, -32767.f, 32767.f);
+	const int16 quantized = static_cast<int16>(clampedAngle);
+
+	remainder = clampedAngle - static_cast<float>(quantized);
+	return quantized;
+}
+
+uint32 CLockstepSimulation::MixChecksum(uint32 checksum, const SState& state)
+{
+	const uint32 words[] =
+	{
+		static_cast<uint32>(state.x), static_cast<uint32>(state.y), static_cast<uint32>(state.z),
+		static_cast<uint32>(state.verticalSpeed), static_cast<uint32>(state.groundZ),
+		static_cast<uint32>(state.yaw) | (static_cast<uint32>(state.pitch) << 16)
+	};
+
+	for (const uint32 word : words)
+	{
+		for (uint32 shift = 0; shift < 32; shift += 8)
+		{
+			checksum ^= (word >> shift) & 0xFF;
+			checksum *= 16777619u;
+		}
+	}
+
+	return checksum;
+}
+
+int32 CLockstepSimulation::Sin(uint16 angle)
+{
+	// 四分之一周期上的奇次多项式 sin(pi/2 * t) ≈ a*t - b*t^3 + c*t^5，t∈[0, 1]，系数之和为1，最大误差约0.1%
+	const int64 a = 102944;
+	const int64 b = 42334;
+	const int64 c = 4926;
+
+	const uint32 quadrant = angle >> 14;
+	uint32 quarterAngle = angle & 0x3FFF;
+	if (quadrant & 1)
+	{
+		quarterAngle = 0x4000 - quarterAngle;
+	}
+
+	const int64 t = static_cast<int64>(quarterAngle) << 2;
+	const int64 t2 = (t * t) >> FixedShift;
+	const int64 t3 = (t2 * t) >> FixedShift;
+	const int64 t5 = (t3 * t2) >> FixedShift;
+	const int32 result = static_cast<int32>((a * t - b * t3 + c * t5) >> FixedShift);
+
+	return quadrant >= 2 ? -result : result;
+}
+
+void CLockstepSimulation::StartEpoch(SPlayer& player, uint16 epoch, uint32 startTick)
+{
+	player.epoch = epoch;
+	player.bStarted = true;
+	player.startTick = startTick;
+	player.simulatedTick = startTick;
+	player.rollbackTick = InvalidTick;
+	player.lastConfirmedTick = InvalidTick;
+	player.lastConfirmedInput = SInput();
+	player.states[startTick % HistorySize] = player.spawnState;
+	// 以纪元为种子，不同纪元的相同状态得到不同的校验和
+	player.checksums[startTick % HistorySize] = MixChecksum(2166136261u ^ epoch, player.spawnState);
+	player.confirmedTicks.fill(static_cast<uint32>(InvalidTick));
+}
+
+void CLockstepSimulation::ApplyInput(SPlayer& player, uint32 tick, const SInput& input, uint32 localTick)
+{
+	if (static_cast<int32>(tick - player.startTick) < 0)
+		return;
+
+	// 已经超出历史，无法回滚，这个tick的预测成为定局
+	if (static_cast<int32>(player.simulatedTick - tick) >= static_cast<int32>(HistorySize))
+	{
+		++m_lateInputCount;
+		return;
+	}
+
+	const uint32 index = tick % HistorySize;
+	if (player.confirmedTicks[index] == tick)
+		return;
+
+	player.confirmedTicks[index] = tick;
+	player.confirmedInputs[index] = input;
+
+	if (player.lastConfirmedTick == InvalidTick || static_cast<int32>(tick - player.lastConfirmedTick) > 0)
+	{
+		player.lastConfirmedTick = tick;
+		player.lastConfirmedInput = input;
+
+		// 拥有者在本地tick为localTick时产生tick的输入，两者之差把本地tick换算为拥有者的tick
+		player.tickOffset = static_cast<int32>(tick - localTick);
+	}
+
+	// 已经以不同的预测模拟过这个tick
+	if (static_cast<int32>(player.simulatedTick - tick) > 0 && player.usedInputs[index] != input)
+	{
+		if (player.rollbackTick == InvalidTick || static_cast<int32>(player.rollbackTick - tick) > 0)
+		{
+			player.rollbackTick = tick;
+		}
+	}
+}
+
+void CLockstepSimulation::Simulate(SPlayer& player, uint32 targetTick)
+{
+	while (player.simulatedTick != targetTick)
+	{
+		const uint32 tick = player.simulatedTick;
+		const uint32 index = tick % HistorySize;
+
+		// 缺少输入时重复最后确认的输入
+		const SInput& input = player.confirmedTicks[index] == tick ? player.confirmedInputs[index] : player.lastConfirmedInput;
+
+		player.usedInputs[index] = input;
+		const uint32 nextIndex = (tick + 1) % HistorySize;
+		player.states[nextIndex] = Step(player.states[index], input);
+		player.checksums[nextIndex] = MixChecksum(player.checksums[index], player.states[nextIndex]);
+		++player.simulatedTick;
+	}
+}
+
+void CLockstepSimulation::FlushPendingInputs(EntityId entityId, SPlayer& player)
+{
+	std::vector<SPlayer::SPendingInput> pendingInputs;
+	pendingInputs.swap(player.pendingInputs);
+	for (const SPlayer::SPendingInput& pending : pendingInputs)
+	{
+		if (pending.epoch == player.spawnEpoch)
+		{
+			AddInput(entityId, pending.epoch, pending.epochStartTick, pending.tick, pending.input, pending.localTick);
+		}
+		else if (static_cast<int16>(pending.epoch - player.spawnEpoch) > 0)
+		{
+			player.pendingInputs.push_back(pending);
+		}
+	}
+}
+
+bool CLockstepSimulation::IsInHistory(const SPlayer& player, uint32 tick)
+{
+	const int32 age = static_cast<int32>(player.simulatedTick - tick);
+	return age >= 0 && age < static_cast<int32>(HistorySize) && static_cast<int32>(tick - player.startTick) >= 0;
+}
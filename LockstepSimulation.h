@@ -0,0 +1,222 @@
+#pragma once
+
+#include <CryEntitySystem/IEntityBasicTypes.h>
+
+#include <array>
+#include <map>
+#include <vector>
+
+class CTerrainHeightCache;
+
+// 确定性的玩家移动模拟，用于只在网络上传输输入的锁步/回滚模式
+// 状态与运算全部为定点整数，所有对等端以相同的输入序列得到逐位相同的结果
+// 每个玩家的状态只取决于其自身的输入流，输入以拥有者的tick编号
+// 远程玩家的输入迟到时先以最后确认的输入预测，真实输入到达且与预测不同时回滚到该tick重新模拟
+class CLockstepSimulation
+{
+public:
+	// 16.16定点数
+	static constexpr int FixedShift = 16;
+	static constexpr int32 FixedOne = 1 << FixedShift;
+	// 保留的tick历史，输入迟到超过此数量时无法回滚
+	static constexpr uint32 HistorySize = 128;
+
+	// 一个tick的输入，角度以1/65536圈为单位
+	struct SInput
+	{
+		uint8 flags = 0;
+		int16 yawDelta = 0;
+		int16 pitchDelta = 0;
+
+		bool operator==(const SInput& other) const { return flags == other.flags && yawDelta == other.yawDelta && pitchDelta == other.pitchDelta; }
+		bool operator!=(const SInput& other) const { return !(*this == other); }
+	};
+
+	// 每个tick开始时的玩家状态，快照即整个结构的复制
+	struct SState
+	{
+		int32 x, y, z;
+		// 竖直速度(16.16，米/秒)
+		int32 verticalSpeed;
+		// 玩家所在位置的地面高度(16.16)，每个tick由Step从地形高度场查询，计入校验和
+		int32 groundZ;
+		uint16 yaw;
+		uint16 pitch;
+	};
+
+	// 中途加入的客户端开始模拟已在游戏中的玩家所需的状态
+	struct SHistory
+	{
+		uint16 epoch = 0;
+		SState spawnState;
+		// 该纪元是否已开始模拟，未开始时只有出生状态
+		bool bStarted = false;
+		// 历史中最早的tick及其状态与校验和，此前的模拟已成定局
+		uint32 baseTick = 0;
+		SState baseState;
+		uint32 baseChecksum = 0;
+		// 从baseTick起每个tick的已确认输入
+		std::vector<SInput> inputs;
+	};
+
+	// 服务器比较客户端报告的校验和的结果
+	enum class EChecksumResult
+	{
+		Match,
+		Diverged,
+		// 本地尚未确认到该tick，稍后再比较
+		Pending,
+		// 纪元已改变或tick已超出历史，无法比较
+		Expired
+	};
+
+	// 输入flag，与CPlayerComponent::EInputFlag一致
+	enum EMoveFlag : uint8
+	{
+		MoveLeft = 1 << 0,
+		MoveRight = 1 << 1,
+		MoveForward = 1 << 2,
+		MoveBack = 1 << 3
+	};
+
+	// 所有对等端必须使用相同的tick频率
+	void Configure(int tickRate);
+	// 地面高度的来源，所有对等端必须以相同的关卡与采样间距构建；为空或无效时地面高度为0
+	void SetTerrain(const CTerrainHeightCache* pTerrain) { m_pTerrain = pTerrain; }
+	int GetTickRate() const { return m_tickRate; }
+	// 远程玩家的输入至少迟到单程延迟，在最后收到的输入之后再预测ticks个tick以显示其当前位置
+	void SetPredictionTicks(int ticks) { m_predictionTicks = clamp_tpl(ticks, 0, static_cast<int>(HistorySize) / 2); }
+
+	void Clear();
+	void RemovePlayer(EntityId entityId);
+
+	// 玩家在第epoch次复活时的出生状态，该纪元的第一个输入到达时以此为初始状态
+	// 出生状态由服务器以定点数发送，不经过有损的变换压缩
+	void SetSpawn(EntityId entityId, uint16 epoch, const SState& spawnState);
+	// 本地产生输入的玩家(本地玩家、服务器上的机器人)不需要预测
+	void SetOwnedLocally(EntityId entityId, bool bOwnedLocally) { m_players[entityId].bOwnedLocally = bOwnedLocally; }
+	// 已知出生状态的最新纪元，不存在时返回false
+	bool GetSpawnEpoch(EntityId entityId, uint16& epoch) const;
+	// 添加拥有者在tick产生的输入，epochStartTick为该纪元的第一个tick，localTick为本地正在进行的tick
+	// 拥有者自己以localTick == tick添加，随后Advance(tick + 1)
+	// 属于尚未知道出生变换的纪元的输入暂存，直到SetSpawn
+	void AddInput(EntityId entityId, uint16 epoch, uint32 epochStartTick, uint32 tick, const SInput& input, uint32 localTick);
+	// 把所有玩家模拟到各自的目标tick(本地tick换算为拥有者的tick)，先执行待处理的回滚
+	void Advance(uint32 localTick);
+
+	// 服务器：玩家当前纪元的出生状态与已确认的历史，不知道出生状态时返回false
+	bool GetHistory(EntityId entityId, SHistory& history) const;
+	// 客户端：以服务器的历史开始模拟加入前已在游戏中的玩家，localTick为本地正在进行的tick
+	void LoadHistory(EntityId entityId, const SHistory& history, uint32 localTick);
+
+	// 当前模拟到的变换，玩家不在模拟中时返回false
+	bool GetTransform(EntityId entityId, QuatT& transform) const;
+
+	// 模拟中的所有玩家，按实体id排序
+	void GetPlayerIds(std::vector<EntityId>& entityIds) const;
+
+	// 滚动校验和：每个tick的量化状态依次混入，值取决于纪元开始以来的所有状态
+	// 最新的只由已确认输入决定的tick及其校验和，此后的tick仍含有预测
+	bool GetConfirmedChecksum(EntityId entityId, uint16& epoch, uint32& tick, uint32& checksum) const;
+	// 与客户端报告的校验和比较，并计入统计
+	EChecksumResult VerifyChecksum(EntityId entityId, uint16 epoch, uint32 tick, uint32 checksum);
+	// 服务器在tick的权威状态与校验和，用于校正发生分歧的客户端
+	bool GetHistoryState(EntityId entityId, uint32 tick, SState& state, uint32& checksum) const;
+	// 以权威状态覆盖tick开始时的状态并从该tick重新模拟
+	void ApplyCorrection(EntityId entityId, uint16 epoch, uint32 tick, const SState& state, uint32 checksum);
+
+	uint32 GetRollbackCount() const { return m_rollbackCount; }
+	uint32 GetResimulatedTickCount() const { return m_resimulatedTickCount; }
+	uint32 GetLateInputCount() const { return m_lateInputCount; }
+	size_t GetPlayerCount() const { return m_players.size(); }
+	uint32 GetChecksumMatchCount() const { return m_checksumMatchCount; }
+	uint32 GetChecksumDivergenceCount() const { return m_checksumDivergenceCount; }
+	uint32 GetCorrectionCount() const { return m_correctionCount; }
+
+	// 确定性的单步模拟
+	SState Step(const SState& state, const SInput& input) const;
+
+	// 出生状态，地面高度从地形高度场查询
+	SState StateFromTransform(const QuatT& transform) const;
+	static QuatT TransformFromState(const SState& state);
+	// 把鼠标位移量化为角度输入，remainder保存未满一个单位的部分(只在拥有者本地使用，不影响确定性)
+	static int16 QuantizeRotation(float mouseDelta, float& remainder);
+	// 定点正弦，结果为16.16
+	static int32 Sin(uint16 angle);
+	static int32 Cos(uint16 angle) { return Sin(static_cast<uint16>(angle + 0x4000)); }
+	// 把一个tick的状态混入滚动校验和(FNV-1a)
+	static uint32 MixChecksum(uint32 checksum, const SState& state);
+
+protected:
+	static constexpr uint32 InvalidTick = ~0u;
+
+	struct SPlayer
+	{
+		// 已知出生变换的纪元
+		uint16 spawnEpoch = 0;
+		bool bHasSpawn = false;
+		SState spawnState;
+
+		// 正在模拟的纪元，bStarted为false时尚未收到该纪元的输入
+		uint16 epoch = 0;
+		bool bStarted = false;
+		uint32 startTick = 0;
+		// states[t % HistorySize]为tick t开始时的状态，有效范围为[simulatedTick - HistorySize + 1, simulatedTick]
+		uint32 simulatedTick = 0;
+		// 需要从此tick重新模拟，InvalidTick表示没有
+		uint32 rollbackTick = InvalidTick;
+		// 拥有者tick减去本地tick
+		int32 tickOffset = 0;
+		bool bOwnedLocally = false;
+
+		uint32 lastConfirmedTick = InvalidTick;
+		SInput lastConfirmedInput;
+
+		std::array<SState, HistorySize> states;
+		// checksums[t % HistorySize]为纪元开始到tick t的滚动校验和
+		std::array<uint32, HistorySize> checksums;
+		std::array<SInput, HistorySize> usedInputs;
+		std::array<SInput, HistorySize> confirmedInputs;
+		std::array<uint32, HistorySize> confirmedTicks;
+
+		// 出生变换未知时暂存的输入
+		struct SPendingInput
+		{
+			uint16 epoch;
+			uint32 epochStartTick;
+			uint32 tick;
+			SInput input;
+			uint32 localTick;
+		};
+		std::vector<SPendingInput> pendingInputs;
+	};
+
+	void StartEpoch(SPlayer& player, uint16 epoch, uint32 startTick);
+	// 出生状态已知后补上此前暂存的输入
+	void FlushPendingInputs(EntityId entityId, SPlayer& player);
+	void ApplyInput(SPlayer& player, uint32 tick, const SInput& input, uint32 localTick);
+	void Simulate(SPlayer& player, uint32 targetTick);
+	// tick开始时的状态仍在历史中
+	static bool IsInHistory(const SPlayer& player, uint32 tick);
+	// 定点位置的地面高度(16.16)
+	int32 GetGroundHeight(int32 x, int32 y) const;
+
+protected:
+	int m_tickRate = 30;
+	// 每tick以全速移动的距离(16.16)
+	int32 m_moveStep = 0;
+	// 每tick重力减少的竖直速度(16.16)
+	int32 m_gravityStep = 0;
+	int m_predictionTicks = 0;
+	const CTerrainHeightCache* m_pTerrain = nullptr;
+
+	// 按实体id有序，遍历顺序在所有对等端一致
+	std::map<EntityId, SPlayer> m_players;
+
+	uint32 m_rollbackCount = 0;
+	uint32 m_resimulatedTickCount = 0;
+	uint32 m_lateInputCount = 0;
+	uint32 m_checksumMatchCount = 0;
+	uint32 m_checksumDivergenceCount = 0;
+	uint32 m_correctionCount = 0;
+};
@@ -0,0 +1,29 @@
+#include "StdAfx.h"
+#include "NetPrecision.h"
+#include "GameCVars.h"
+
+namespace
+{
+	CTransformCodec::SFormat CreateCoarseFormat()
+	{
+		// 16位坐标的步长为0.125米，偏航与俯仰各8位
+		CTransformCodec::SFormat format;
+		format.positionBits = 16;
+		format.rotationEncoding = CTransformCodec::ERotationEncoding::YawPitch;
+		format.rotationBits = 8;
+		return format;
+	}
+}
+
+CNetPrecision::EProfile CNetPrecision::SelectProfile(float distance, const SGameCVars& cvars)
+{
+	return distance > cvars.g_precisionLodDistance ? EProfile::Coarse : EProfile::Full;
+}
+
+const CTransformCodec& CNetPrecision::GetCodec(EProfile profile)
+{
+	static const CTransformCodec fullCodec;
+	static const CTransformCodec coarseCodec(CreateCoarseFormat());
+
+	return profile == EProfile::Full ? fullCodec : coarseCodec;
+}
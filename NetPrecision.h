@@ -0,0 +1,27 @@
+#pragma once
+
+#include "TransformCodec.h"
+
+struct SGameCVars;
+
+// 按距离选择的网络序列化精度(precision LOD)
+// 近处使用20位定点坐标与最小三分量旋转，远处使用16位定点坐标与8位偏航/俯仰
+// 选择的档位作为NetSerialize的profile参数传递，两端以同一档位的编解码器读写
+class CNetPrecision
+{
+public:
+	enum class EProfile : uint8
+	{
+		Full = 0,
+		Coarse
+	};
+
+	// 根据到接收者的距离选择档位
+	static EProfile SelectProfile(float distance, const SGameCVars& cvars);
+
+	// 档位对应的变换编解码器
+	static const CTransformCodec& GetCodec(EProfile profile);
+
+	// 变换在此档位下编码后的字节数，供复制调度器计费
+	static uint32 GetEstimatedTransformBytes(EProfile profile) { return static_cast<uint32>(GetCodec(profile).GetEncodedSize(1)); }
+};
@@ -3,7 +3,6 @@
 #include "GamePlugin.h"
 
 #include <CryNetwork/INetwork.h>
-#include <unordered_map>
 // network & spawn player
 
 CNetworkedClientListener::CNetworkedClientListener()
@@ -24,6 +23,14 @@ virtual CNetworkedClientListener::~CNetworkedClientListener()
 virtual bool CNetworkedClientListener::OnClientConnectionReceived(int channelId, bool bIsReset) override
 {
 
+    // 达到玩家上限，拒绝连接
+    const size_t maxPlayers = static_cast<size_t>(max(CGamePlugin::GetInstance()->GetCVars().g_maxPlayers, 0));
+    if (m_clientEntityIdLookupMap.GetSize() >= maxPlayers)
+    {
+        CryLogAlways("[Admission] Rejected channel %d: server full (%" PRISIZE_T " players)", channelId, maxPlayers);
+        return false;
+    }
+
     // 收到客户端连接，创建玩家实体
     SEntitySpawnParams spawnParams;
 
@@ -36,7 +43,7 @@ virtual bool CNetworkedClientListener::OnClientConnectionReceived(int channelId,
     spawnParams.nFlags |= ENTITY_FLAG_NEVER_NETWORK_STATIC;
 		
     // 确认是否为本地玩家
-    const bool isLocalPlayer = m_clientEntityIdLookupMap.empty() && !gEnv->IsDedicated();
+    const bool isLocalPlayer = m_clientEntityIdLookupMap.IsEmpty() && !gEnv->IsDedicated();
 	
     // 如果为本地玩家则使用预定义id并使用flag ENTITY_FLAG_LOCAL_PLAYER
     if (isLocalPlayer)
@@ -52,7 +59,7 @@ virtual bool CNetworkedClientListener::OnClientConnectionReceived(int channelId,
         pPlayerEntity->GetNetEntity()->SetChannelId(channelId);
         pPlayerEntity->GetNetEntity()->BindToNetwork();
         // 将其放入用于存储的Map
-        m_clientEntityIdLookupMap.emplace(std::make_pair(channelId, pPlayerEntity->GetId()));
+        m_clientEntityIdLookupMap.Insert(channelId, pPlayerEntity->GetId());
         return true;
     }
     // 生成失败，拒绝连接
@@ -71,12 +78,12 @@ virtual bool CNetworkedClientListener::OnClientReadyForGameplay(int channelId, b
 virtual void CNetworkedClientListener::OnClientDisconnected(int channelId, EDisconnectionCause cause, const char* description, bool bKeepClient) override
 {
     // 检查是否已经为此客户端创建实体
-    decltype(m_clientEntityIdLookupMap)::const_iterator clientIterator = m_clientEntityIdLookupMap.find(channelId);
-    if (clientIterator != m_clientEntityIdLookupMap.end())
+    const EntityId clientEntityId = m_clientEntityIdLookupMap.Find(channelId);
+    if (clientEntityId != INVALID_ENTITYID)
     {
-        // 已创建实体，从场景删除
-        const EntityId clientEntityId = clientIterator->second;
+        // 已创建实体，从场景删除，并发布不含此客户端的新版本
         gEnv->pEntitySystem->RemoveEntity(clientEntityId);
+        m_clientEntityIdLookupMap.Erase(channelId);
     }
 }
 	
@@ -1,7 +1,8 @@
 #pragma once
 
 #include <CryNetwork/INetwork.h>
-#include <unordered_map>
+
+#include "PlayerRegistry.h"
 // network & spawn player
 class CNetworkedClientListener final : public INetworkedClientListener
 {
@@ -9,8 +10,8 @@ public:
     CNetworkedClientListener();
     virtual ~CNetworkedClientListener();
 protected:
-    // <频道id, 玩家实体id>
-    std::unordered_map<int, EntityId> m_clientEntityIdLookupMap;
+    // <频道id, 玩家实体id>，可在任意线程读取快照
+    CPlayerRegistry m_clientEntityIdLookupMap;
 	
     // 新客户端开始连接时发送到服务器
     // 返回false拒绝连接
@@ -3,9 +3,12 @@
 #include "GamePlugin.h"
 
 #include <CryRenderer/IRenderAuxGeom.h>
+#include <CryInput/IInput.h>
+#include <CryNetwork/Rmi.h>
 #include <CrySchematyc/Env/Elements/EnvComponent.h>
 #include <CryCore/StaticInstanceList.h>
-#include <CryNetwork/Rmi.h>
+
+constexpr CPlayerComponent::SInputActionDesc CPlayerComponent::InputActions[];
 
 namespace
 {
@@ -24,9 +27,25 @@ void CPlayerComponent::Initialize()
 {
 	// 标记需要在网络上复制的实体
 	m_pEntity->GetNetEntity()->BindToNetwork();
-	
-	// 注册RemoteReviveOnClient函数为RMI(Remote Method Invocation)(可以被服务器执行于各客户端)
-	SRmi<RMI_WRAP(&CPlayerComponent::RemoteReviveOnClient)>::Register(this, eRAT_NoAttach, false, eNRT_ReliableOrdered);
+
+	// 注册RemoteZoneTransferOnClient函数为RMI(Remote Method Invocation)(可以被服务器执行于拥有此玩家的客户端)
+	SRmi<RMI_WRAP(&CPlayerComponent::RemoteZoneTransferOnClient)>::Register(this, eRAT_NoAttach, false, eNRT_ReliableOrdered);
+	// 断线重连的会话令牌只在服务器与拥有者之间传递
+	SRmi<RMI_WRAP(&CPlayerComponent::RemoteSessionTokenOnClient)>::Register(this, eRAT_NoAttach, false, eNRT_ReliableOrdered);
+
+	// 锁步模式只传输出生状态与输入，丢失任何一个输入都会让对等端无法重现模拟，因此可靠有序
+	SRmi<RMI_WRAP(&CPlayerComponent::RemoteLockstepSpawnOnClient)>::Register(this, eRAT_NoAttach, false, eNRT_ReliableOrdered);
+	SRmi<RMI_WRAP(&CPlayerComponent::RemoteLockstepHistoryOnClient)>::Register(this, eRAT_NoAttach, false, eNRT_ReliableOrdered);
+	SRmi<RMI_WRAP(&CPlayerComponent::RemoteLockstepInputOnServer)>::Register(this, eRAT_NoAttach, true, eNRT_ReliableOrdered);
+	SRmi<RMI_WRAP(&CPlayerComponent::RemoteLockstepInputOnClient)>::Register(this, eRAT_NoAttach, false, eNRT_ReliableOrdered);
+	// 校验和由下一次报告取代，不需要可靠传输
+	SRmi<RMI_WRAP(&CPlayerComponent::RemoteLockstepChecksumsOnServer)>::Register(this, eRAT_NoAttach, true, eNRT_UnreliableUnordered);
+	SRmi<RMI_WRAP(&CPlayerComponent::RemoteLockstepCorrectionOnClient)>::Register(this, eRAT_NoAttach, false, eNRT_ReliableOrdered);
+	// 时钟同步的样本必须反映当前的网络延迟，重传的旧样本没有意义
+	SRmi<RMI_WRAP(&CPlayerComponent::RemoteClockSyncRequestOnServer)>::Register(this, eRAT_NoAttach, true, eNRT_UnreliableUnordered);
+	SRmi<RMI_WRAP(&CPlayerComponent::RemoteClockSyncResponseOnClient)>::Register(this, eRAT_NoAttach, false, eNRT_UnreliableUnordered);
+	// 丢失的回传只少一个延迟样本
+	SRmi<RMI_WRAP(&CPlayerComponent::RemoteInputLatencyEchoOnClient)>::Register(this, eRAT_NoAttach, false, eNRT_UnreliableUnordered);
 }
 
 // 初始化本地玩家
@@ -36,26 +55,27 @@ void CPlayerComponent::InitializeLocalPlayer()
 	m_pCameraComponent = m_pEntity->GetOrCreateComponent<Cry::DefaultComponents::CCameraComponent>();
 	// 取得输入组件，wraps access to action mapping so we can easily get callbacks when inputs are triggered
 	m_pInputComponent = m_pEntity->GetOrCreateComponent<Cry::DefaultComponents::CInputComponent>();
-	
-	// 注册ActionMap组、Action以及触发时调用的回调函数(ActionMap组名，Action名，回调函数)
-	m_pInputComponent->RegisterAction("player", "moveleft", [this](int activationMode, float value) { HandleInputFlagChange(EInputFlag::MoveLeft, (EActionActivationMode)activationMode);  }); 
-	// 绑定按键
-	m_pInputComponent->BindAction("player", "moveleft", eAID_KeyboardMouse, EKeyId::eKI_A);
 
-	m_pInputComponent->RegisterAction("player", "moveright", [this](int activationMode, float value) { HandleInputFlagChange(EInputFlag::MoveRight, (EActionActivationMode)activationMode);  }); 
-	m_pInputComponent->BindAction("player", "moveright", eAID_KeyboardMouse, EKeyId::eKI_D);
+	// 时钟同步经本地玩家的RMI进行
+	CGamePlugin::GetInstance()->SetLocalPlayer(GetEntityId());
 
-	m_pInputComponent->RegisterAction("player", "moveforward", [this](int activationMode, float value) { HandleInputFlagChange(EInputFlag::MoveForward, (EActionActivationMode)activationMode);  }); 
-	m_pInputComponent->BindAction("player", "moveforward", eAID_KeyboardMouse, EKeyId::eKI_W);
-
-	m_pInputComponent->RegisterAction("player", "moveback", [this](int activationMode, float value) { HandleInputFlagChange(EInputFlag::MoveBack, (EActionActivationMode)activationMode);  }); 
-	m_pInputComponent->BindAction("player", "moveback", eAID_KeyboardMouse, EKeyId::eKI_S);
-
-	m_pInputComponent->RegisterAction("player", "mouse_rotateyaw", [this](int activationMode, float value) { m_mouseDeltaRotation.x -= value; });
-	m_pInputComponent->BindAction("player", "mouse_rotateyaw", eAID_KeyboardMouse, EKeyId::eKI_MouseX);
+	
+	// 默认按键，再以g_inputBindings中的设定覆盖
+	EKeyId keys[static_cast<size_t>(EInputAction::Count)];
+	for (const SInputActionDesc& desc : InputActions)
+	{
+		keys[static_cast<size_t>(desc.action)] = desc.defaultKey;
+	}
+	LoadInputBindings(CGamePlugin::GetInstance()->GetCVars().g_inputBindings, keys);
 
-	m_pInputComponent->RegisterAction("player", "mouse_rotatepitch", [this](int activationMode, float value) { m_mouseDeltaRotation.y -= value; });
-	m_pInputComponent->BindAction("player", "mouse_rotatepitch", eAID_KeyboardMouse, EKeyId::eKI_MouseY);
+	// 注册ActionMap组、Action以及触发时调用的回调函数(ActionMap组名，Action名，回调函数)，回调只携带动作下标
+	for (const SInputActionDesc& desc : InputActions)
+	{
+		const EInputAction action = desc.action;
+		m_pInputComponent->RegisterAction(InputActionGroup, desc.szName, [this, action](int activationMode, float value) { HandleInputAction(action, activationMode, value); });
+		// 绑定按键
+		m_pInputComponent->BindAction(InputActionGroup, desc.szName, eAID_KeyboardMouse, keys[static_cast<size_t>(action)]);
+	}
 }
 
 // 引擎用其获取事件遮罩
@@ -82,11 +102,33 @@ void CPlayerComponent::ProcessEvent(const SEntityEvent& event)
 	// 每帧更新
 	case Cry::Entity::EEvent::Update:
 	{
-		// 确认玩家是否生成
-		if(!m_isAlive)
+		// 确认玩家是否生成，幽灵由拥有它的区域模拟
+		if(!m_isAlive || m_isDormant || m_isGhost)
+			return;
+
+		// 锁步模式下输入与移动由CGamePlugin按固定的tick驱动
+		if (CGamePlugin::GetInstance()->IsLockstepEnabled())
 			return;
 		
-		const float frameTime = event.fParam[0];
+		// 模拟LOD：远处的玩家跳过部分帧，轮到模拟时以累积的时间积分
+		m_unsimulatedTime += event.fParam[0];
+		if (!CSimulationLod::IsDue(m_simulationInterval, GetEntityId(), gEnv->nMainFrameID))
+			return;
+
+		const float frameTime = m_unsimulatedTime;
+		m_unsimulatedTime = 0.f;
+		m_pendingStepTime += frameTime;
+
+		// 机器人在服务器上生成输入，变化时与真实客户端一样同步输入方面
+		if (m_pBotInput != nullptr)
+		{
+			const uint8 movementMask = static_cast<uint8>(EInputFlag::MoveLeft) | static_cast<uint8>(EInputFlag::MoveRight) | static_cast<uint8>(EInputFlag::MoveForward) | static_cast<uint8>(EInputFlag::MoveBack);
+			if (m_pBotInput->Update(frameTime, movementMask, m_inputFlags.UnderlyingValue(), m_mouseDeltaRotation))
+			{
+				++m_inputSequence;
+				RequestAspectReplication(InputAspect);
+			}
+		}
 
 		const float moveSpeed = 20.5f;
 		Vec3 velocity = ZERO;
@@ -109,9 +151,9 @@ void CPlayerComponent::ProcessEvent(const SEntityEvent& event)
 			velocity.y -= moveSpeed * frameTime;
 		}
 
-		// 更新玩家位移
+		// 更新玩家位移，由CGamePlugin与其他玩家一起批量解析碰撞后应用
 		Matrix34 transformation = m_pEntity->GetWorldTM();
-		transformation.AddTranslation(transformation.TransformVector(velocity));
+		m_desiredDisplacement += transformation.TransformVector(velocity);
 
 		// 根据最后的输入更新实体旋转
 		Ang3 ypr = CCamera::CreateAnglesYPR(Matrix33(transformation));
@@ -125,10 +167,16 @@ void CPlayerComponent::ProcessEvent(const SEntityEvent& event)
 
 		transformation.SetRotation33(CCamera::CreateOrientationYPR(ypr));
 
+		// 服务器上朝向变化需要复制
+		if (gEnv->bServer && !m_mouseDeltaRotation.IsZero())
+		{
+			RequestAspectReplication(MovementAspect);
+		}
+
 		// 重置鼠标位移增量
 		m_mouseDeltaRotation = ZERO;
 
-		// 应用位移与旋转
+		// 应用旋转
 		m_pEntity->SetWorldTM(transformation);
 	}
 	break;
@@ -147,9 +195,26 @@ bool CPlayerComponent::NetSerialize(TSerialize ser, EEntityAspects aspect, uint8
 
 		ser.Value("m_inputFlags", m_inputFlags.UnderlyingValue(), 'ui8');
 
+		// 延迟追踪：最新一次输入变化的时间戳，以及上一次回传测得的往返时间
+		const uint16 prevInputStampId = m_inputStamp.stampId;
+		const uint16 prevEchoedStampId = m_inputStamp.echoedStampId;
+		ser.Value("stampId", m_inputStamp.stampId, 'ui16');
+		ser.Value("stampTime", m_inputStamp.clientTimeMs, 'ui32');
+		ser.Value("echoedStampId", m_inputStamp.echoedStampId, 'ui16');
+		ser.Value("roundTrip", m_inputStamp.roundTripMs, 'ui16');
+
 		if (ser.IsReading())
 		{
 			const CEnumFlags<EInputFlag> changedKeys = prevInputFlags ^ m_inputFlags;
+			if (!changedKeys.IsEmpty())
+			{
+				++m_inputSequence;
+			}
+
+			if (gEnv->bServer)
+			{
+				OnInputStampReceivedOnServer(prevInputStampId, prevEchoedStampId);
+			}
 
 			const CEnumFlags<EInputFlag> pressedKeys = changedKeys & prevInputFlags;
 			if (!pressedKeys.IsEmpty())
@@ -166,6 +231,102 @@ bool CPlayerComponent::NetSerialize(TSerialize ser, EEntityAspects aspect, uint8
 
 		ser.EndGroup();
 	}
+	else if (aspect == MovementAspect)
+	{
+		ser.BeginGroup("PlayerMovement");
+
+		// 服务器为整个实体选择的精度，远离所有客户端时降低
+		const CNetPrecision::EProfile precision = static_cast<CNetPrecision::EProfile>(profile);
+		const CTransformCodec& codec = CNetPrecision::GetCodec(precision);
+
+		// 超出编解码器范围的位置(如地形外或深处)改以引擎的'wrld'策略发送，不被截断到范围边界
+		bool bInCodecRange = true;
+		if (ser.IsWriting())
+		{
+			bInCodecRange = codec.IsInRange(m_pEntity->GetWorldPos());
+		}
+		ser.Value("inRange", bInCodecRange, 'bool');
+
+		if (!bInCodecRange)
+		{
+			QuatT transform(m_pEntity->GetWorldPos(), m_pEntity->GetWorldRotation());
+			ser.Value("pos", transform.t, 'wrld');
+			ser.Value("rot", transform.q, 'ori0');
+
+			if (ser.IsReading() && m_isAlive)
+			{
+				ApplyReplicatedTransform(transform);
+			}
+
+			ser.EndGroup();
+			return true;
+		}
+
+		// 变换以编解码器打包，通常直接复制本帧批量编码的槽位，所有频道共享同一份字节
+		CSnapshotCache::SEncoded encoded;
+		encoded.size = static_cast<uint8>(codec.GetEncodedSize(1));
+		if (ser.IsWriting())
+		{
+			const bool bUseSnapshot = CGamePlugin::GetInstance()->GetCVars().g_snapshotCache != 0;
+			if (!bUseSnapshot || !CGamePlugin::GetInstance()->GetSnapshotCache().Get(m_snapshotSlot, GetEntityId(), profile, encoded))
+			{
+				const QuatT transform(m_pEntity->GetWorldPos(), m_pEntity->GetWorldRotation());
+				codec.Encode(&transform, 1, encoded.data);
+			}
+		}
+
+		// 以32位字序列化编码后的字节
+		for (uint8 offset = 0; offset < encoded.size; offset += 4)
+		{
+			uint32 word = 0;
+			memcpy(&word, encoded.data + offset, min<size_t>(4, encoded.size - offset));
+			ser.Value("word", word, 'ui32');
+			memcpy(encoded.data + offset, &word, min<size_t>(4, encoded.size - offset));
+		}
+
+		QuatT transform;
+		if (ser.IsReading() && m_isAlive && codec.Decode(encoded.data, encoded.size, &transform, 1))
+		{
+			ApplyReplicatedTransform(transform);
+		}
+
+		ser.EndGroup();
+	}
+	else if (aspect == StatusAspect)
+	{
+		ser.BeginGroup("PlayerStatus");
+
+		bool isAlive = m_isAlive;
+		bool isDormant = m_isDormant;
+		uint16 reviveCount = m_reviveCount;
+		// 发送写入状态时的当前变换而不是出生位置：移动方面可能先于状态方面到达，
+		// 此时在出生位置复活会把已经移动的玩家拉回过时的位置
+		QuatT transform = m_isAlive ? QuatT(m_pEntity->GetWorldPos(), m_pEntity->GetWorldRotation()) : m_spawnTransform;
+		ser.Value("alive", isAlive, 'bool');
+		ser.Value("dormant", isDormant, 'bool');
+		ser.Value("reviveCount", reviveCount, 'ui16');
+		ser.Value("pos", transform.t, 'wrld');
+		ser.Value("rot", transform.q, 'ori0');
+
+		if (ser.IsReading())
+		{
+			// 丢失的中间状态无关紧要，只要复活计数变化就在服务器写入状态时的位置复活
+			if (isAlive && reviveCount != m_reviveCount)
+			{
+				m_reviveCount = reviveCount;
+				m_spawnTransform = transform;
+				Revive(Matrix34(transform));
+			}
+			else if (!isAlive)
+			{
+				m_isAlive = false;
+			}
+
+			SetDormant(isDormant);
+		}
+
+		ser.EndGroup();
+	}
 	
 	return true;
 }
@@ -178,45 +339,89 @@ void CPlayerComponent::OnReadyForGameplayOnServer()
 	Vec3 playerScale = Vec3(1.f);
 	Quat playerRotation = IDENTITY;
 
-	// 把玩家放在地图中心
+	// 把玩家放在出生中心(地图或本区域的中心)附近，按螺旋错开避免叠在同一点
 	const float heightOffset = 20.f;
-	const float terrainCenter = gEnv->p3DEngine->GetTerrainSize() / 2.f;
-	const float height = gEnv->p3DEngine->GetTerrainZ(terrainCenter, terrainCenter);
-	const Vec3 playerPosition = Vec3(terrainCenter, terrainCenter, height + heightOffset);
+	const Vec2 spawnCenter = CGamePlugin::GetInstance()->GetSpawnCenter();
+	const Vec2 spawnOffset = CGamePlugin::GetInstance()->GetNextSpawnOffset();
+	const float spawnX = spawnCenter.x + spawnOffset.x;
+	const float spawnY = spawnCenter.y + spawnOffset.y;
+	const CTerrainHeightCache& terrainHeightCache = CGamePlugin::GetInstance()->GetTerrainHeightCache();
+	const float height = terrainHeightCache.IsValid() ? terrainHeightCache.GetHeight(spawnX, spawnY) : gEnv->p3DEngine->GetTerrainZ(spawnX, spawnY);
+	const Vec3 playerPosition = Vec3(spawnX, spawnY, height + heightOffset);
 
 	const Matrix34 newTransform = Matrix34::Create(playerScale, playerRotation, playerPosition);
 	
-	Revive(newTransform);
-	
-	// 在所有远程客户端调用RemoteReviveOnClient函数，保证Revive在全网被调用
-	SRmi<RMI_WRAP(&CPlayerComponent::RemoteReviveOnClient)>::InvokeOnOtherClients(this, RemoteReviveParams{ playerPosition, playerRotation });
-	
-	// 遍历其他玩家，发送它们各自实例的RemoteReviveOnClient到准备好游戏的新玩家
-	const int channelId = m_pEntity->GetNetEntity()->GetChannelId();
-	CGamePlugin::GetInstance()->IterateOverPlayers([this, channelId](CPlayerComponent& player)
-	{
-		// 不发送到自身(handled in the RemoteReviveOnClient event above sent to all clients)
-		if (player.GetEntityId() == GetEntityId())
-			return;
+	ReviveOnServer(newTransform);
+}
 
-		// 仅发送Revive事件到服务器上已经生成的玩家
-		if (!player.m_isAlive)
-			return;
+// 服务器上断线重连完成
+void CPlayerComponent::OnReconnectedOnServer()
+{
+	CRY_ASSERT(gEnv->bServer, "This function should only be called on the server!");
 
-		// 在新玩家机器上复活此玩家，位于其现在所处的位置
-		const QuatT currentOrientation = QuatT(player.GetEntity()->GetWorldTM());
-		SRmi<RMI_WRAP(&CPlayerComponent::RemoteReviveOnClient)>::InvokeOnClient(&player, RemoteReviveParams{ currentOrientation.t, currentOrientation.q }, channelId);
-	});
+	// 保留断线前的位置与朝向
+	ReviveOnServer(m_pEntity->GetWorldTM());
 }
 
-bool CPlayerComponent::RemoteReviveOnClient(RemoteReviveParams&& params, INetChannel* pNetChannel)
+void CPlayerComponent::SendSessionTokenOnServer(uint64 sessionToken)
 {
-	// 在此客户端调用Revive函数
-	Revive(Matrix34::Create(Vec3(1.f), params.rotation, params.position));
+	const int channelId = m_pEntity->GetNetEntity()->GetChannelId();
+	if (channelId == 0)
+		return;
 
+	SRmi<RMI_WRAP(&CPlayerComponent::RemoteSessionTokenOnClient)>::InvokeOnClient(this, RemoteSessionTokenParams{ sessionToken }, channelId);
+}
+
+bool CPlayerComponent::RemoteSessionTokenOnClient(RemoteSessionTokenParams&& params, INetChannel* pNetChannel)
+{
+	CGamePlugin::GetInstance()->SetSessionToken(params.sessionToken);
 	return true;
 }
 
+void CPlayerComponent::ReviveOnServer(const Matrix34& transform)
+{
+	Revive(transform);
+
+	// 复活计数与出生位置随状态方面复制，新加入的客户端绑定实体时同样收到最新状态
+	++m_reviveCount;
+	m_spawnTransform = QuatT(transform);
+	RequestAspectReplication(StatusAspect);
+
+	// 锁步模式下所有对等端从同一个定点出生状态开始模拟此玩家的新纪元
+	CGamePlugin* pGamePlugin = CGamePlugin::GetInstance();
+	if (pGamePlugin->IsLockstepEnabled())
+	{
+		// 地面高度之后由每个对等端在每个tick从各自(相同)的地形高度场以定点数查询
+		const RemoteLockstepSpawnParams spawnParams{ m_reviveCount, pGamePlugin->GetLockstepSimulation().StateFromTransform(m_spawnTransform) };
+		pGamePlugin->GetLockstepSimulation().SetSpawn(GetEntityId(), spawnParams.epoch, spawnParams.state);
+
+		pGamePlugin->IterateOverPlayers([this, &spawnParams](CPlayerComponent& player)
+		{
+			const int channelId = player.GetEntity()->GetNetEntity()->GetChannelId();
+			if (channelId != 0)
+			{
+				SRmi<RMI_WRAP(&CPlayerComponent::RemoteLockstepSpawnOnClient)>::InvokeOnClient(this, RemoteLockstepSpawnParams(spawnParams), channelId);
+			}
+		});
+	}
+}
+
+void CPlayerComponent::ApplyReplicatedTransform(const QuatT& transform)
+{
+	if (IsLocalClient())
+	{
+		// 本地玩家以自己的预测为准，只在偏差过大时校正位置
+		if (m_pEntity->GetWorldPos().GetSquaredDistance(transform.t) > MaxLocalPositionError * MaxLocalPositionError)
+		{
+			m_pEntity->SetPos(transform.t);
+		}
+	}
+	else
+	{
+		m_pEntity->SetWorldTM(Matrix34::Create(Vec3(1.f), transform.q, transform.t));
+	}
+}
+
 // Revive函数
 void CPlayerComponent::Revive(const Matrix34& transform)
 {
@@ -229,14 +434,415 @@ void CPlayerComponent::Revive(const Matrix34& transform)
 		m_pEntity->SetWorldTM(transform);
 	}
 	
+	// 重新开始下落与移动
+	m_desiredDisplacement = ZERO;
+	m_verticalVelocity = 0.f;
+	m_isGrounded = false;
+	m_pendingStepTime = 0.f;
+	m_unsimulatedTime = 0.f;
+
 	// 既然玩家已经生成，重置输入
 	m_inputFlags.Clear();
-	NetMarkAspectsDirty(InputAspect);
+	RequestAspectReplication(InputAspect);
 	
 	m_mouseDeltaRotation = ZERO;
 }
 
+void CPlayerComponent::RequestAspectReplication(EEntityAspects aspect)
+{
+	if (gEnv->bServer)
+	{
+		CGamePlugin::GetInstance()->GetReplicationScheduler().RequestReplication(GetEntityId(), aspect, GetAspectReplicationDesc(aspect));
+	}
+	else
+	{
+		NetMarkAspectsDirty(aspect);
+	}
+}
+
+CReplicationScheduler::SAspectDesc CPlayerComponent::GetAspectReplicationDesc(EEntityAspects aspect) const
+{
+	const SGameCVars& cvars = CGamePlugin::GetInstance()->GetCVars();
+
+	switch (aspect)
+	{
+	case MovementAspect:
+	{
+		const float minInterval = cvars.g_movementSendRate > 0.f ? 1.f / cvars.g_movementSendRate : 0.f;
+		return CReplicationScheduler::SAspectDesc{ 1.f, CNetPrecision::GetEstimatedTransformBytes(m_movementPrecision), minInterval };
+	}
+	case StatusAspect:
+		// 状态变化很少，但错过会让客户端长期不一致
+		return CReplicationScheduler::SAspectDesc{ 4.f, 20, 0.f };
+	default:
+		// 输入flag与延迟时间戳
+		return CReplicationScheduler::SAspectDesc{ 1.f, 14, 0.f };
+	}
+}
+
+void CPlayerComponent::SetMovementPrecision(CNetPrecision::EProfile precision)
+{
+	if (m_movementPrecision == precision)
+		return;
+
+	m_movementPrecision = precision;
+	m_pEntity->GetNetEntity()->SetAspectProfile(MovementAspect, static_cast<uint8>(precision));
+}
+
+void CPlayerComponent::SetDormant(bool bDormant)
+{
+	if (m_isDormant == bDormant)
+		return;
+
+	m_isDormant = bDormant;
+	m_pEntity->Hide(bDormant);
+
+	// 客户端上同样隐藏休眠的玩家
+	if (gEnv->bServer)
+	{
+		RequestAspectReplication(StatusAspect);
+	}
+
+	// 休眠期间不保留断线前按住的按键
+	m_inputFlags.Clear();
+	m_mouseDeltaRotation = ZERO;
+}
+
+void CPlayerComponent::WriteHandoff(CZoneLink::SPlayerHandoff& handoff) const
+{
+	const QuatT transform = QuatT(m_pEntity->GetWorldTM());
+
+	handoff.sourceEntityId = GetEntityId();
+	handoff.inputSequence = m_inputSequence;
+	handoff.botRandomState = m_pBotInput != nullptr ? m_pBotInput->GetRandomState() : 0;
+	handoff.position = transform.t;
+	handoff.rotation = transform.q;
+	handoff.verticalVelocity = m_verticalVelocity;
+	handoff.reviveCount = m_reviveCount;
+	handoff.inputFlags = m_inputFlags.UnderlyingValue();
+	handoff.bGrounded = m_isGrounded;
+	handoff.bBot = m_pBotInput != nullptr;
+	cry_strcpy(handoff.name, m_pEntity->GetName());
+}
+
+void CPlayerComponent::ReadHandoffOnServer(const CZoneLink::SPlayerHandoff& handoff)
+{
+	CRY_ASSERT(gEnv->bServer, "This function should only be called on the server!");
+
+	if (handoff.bBot)
+	{
+		EnableBotInput(handoff.botRandomState);
+	}
+
+	// 在移交时的位置复活，然后恢复下落与按住的输入，移动在目标区域无缝继续
+	m_reviveCount = handoff.reviveCount;
+	ReviveOnServer(Matrix34::Create(Vec3(1.f), handoff.rotation, handoff.position));
+
+	m_verticalVelocity = handoff.verticalVelocity;
+	m_isGrounded = handoff.bGrounded;
+	m_inputFlags.UnderlyingValue() = handoff.inputFlags;
+	m_inputSequence = handoff.inputSequence;
+	RequestAspectReplication(InputAspect);
+}
+
+void CPlayerComponent::TransferToZoneOnServer(uint16 gamePort, uint64 handoffToken)
+{
+	const int channelId = m_pEntity->GetNetEntity()->GetChannelId();
+	if (channelId == 0)
+		return;
+
+	SRmi<RMI_WRAP(&CPlayerComponent::RemoteZoneTransferOnClient)>::InvokeOnClient(this, RemoteZoneTransferParams{ gamePort, handoffToken }, channelId);
+}
+
+bool CPlayerComponent::RemoteZoneTransferOnClient(RemoteZoneTransferParams&& params, INetChannel* pNetChannel)
+{
+	// 区域进程都在同一台机器上，沿用当前的服务器地址，只更换端口
+	const ICVar* pServerAddress = gEnv->pConsole->GetCVar("cl_serveraddr");
+	const char* szServerAddress = pServerAddress != nullptr ? pServerAddress->GetString() : "localhost";
+
+	CryLogAlways("[Zones] Transferring to %s:%u", szServerAddress, params.gamePort);
+
+	// 连接目标区域时以昵称后缀出示移交令牌，目标区域直接把频道绑定到移交来的玩家
+	CGamePlugin::GetInstance()->SetHandoffToken(params.handoffToken);
+
+	// 延迟执行，不在网络序列化期间断开当前连接
+	gEnv->pConsole->ExecuteString(string().Format("connect %s %u", szServerAddress, params.gamePort), false, true);
+
+	return true;
+}
+
+void CPlayerComponent::ApplyGhostStateOnServer(const QuatT& transform)
+{
+	CRY_ASSERT(gEnv->bServer, "This function should only be called on the server!");
+
+	m_isGhost = true;
+
+	if (!m_isAlive)
+	{
+		ReviveOnServer(Matrix34(transform));
+		return;
+	}
+
+	m_pEntity->SetWorldTM(Matrix34(transform));
+	OnMovedOnServer();
+}
+
+void CPlayerComponent::UpdateLockstepInput(uint32 tick)
+{
+	CLockstepSimulation& lockstep = CGamePlugin::GetInstance()->GetLockstepSimulation();
+
+	// 等待服务器发来当前纪元的出生状态
+	uint16 epoch;
+	if (!lockstep.GetSpawnEpoch(GetEntityId(), epoch))
+		return;
+
+	if (!m_hasLockstepEpoch || m_lockstepEpoch != epoch)
+	{
+		m_lockstepEpoch = epoch;
+		m_lockstepEpochStartTick = tick;
+		m_hasLockstepEpoch = true;
+		lockstep.SetOwnedLocally(GetEntityId(), true);
+	}
+
+	if (m_pBotInput != nullptr)
+	{
+		const uint8 movementMask = static_cast<uint8>(EInputFlag::MoveLeft) | static_cast<uint8>(EInputFlag::MoveRight) | static_cast<uint8>(EInputFlag::MoveForward) | static_cast<uint8>(EInputFlag::MoveBack);
+		m_pBotInput->Update(1.f / static_cast<float>(lockstep.GetTickRate()), movementMask, m_inputFlags.UnderlyingValue(), m_mouseDeltaRotation);
+	}
+
+	RemoteLockstepInputParams params;
+	params.epoch = m_lockstepEpoch;
+	params.epochStartTick = m_lockstepEpochStartTick;
+	params.tick = tick;
+	params.input.flags = m_inputFlags.UnderlyingValue();
+	params.input.yawDelta = CLockstepSimulation::QuantizeRotation(m_mouseDeltaRotation.x, m_lockstepRotationRemainder.x);
+	params.input.pitchDelta = CLockstepSimulation::QuantizeRotation(m_mouseDeltaRotation.y, m_lockstepRotationRemainder.y);
+	m_mouseDeltaRotation = ZERO;
+	++m_inputSequence;
+
+	lockstep.AddInput(GetEntityId(), params.epoch, params.epochStartTick, params.tick, params.input, tick);
+
+	if (gEnv->bServer)
+	{
+		RelayLockstepInputOnServer(params);
+	}
+	else
+	{
+		SRmi<RMI_WRAP(&CPlayerComponent::RemoteLockstepInputOnServer)>::InvokeOnServer(this, std::move(params));
+	}
+}
+
+bool CPlayerComponent::RemoteLockstepSpawnOnClient(RemoteLockstepSpawnParams&& params, INetChannel* pNetChannel)
+{
+	// 主机上的本地客户端已在ReviveOnServer中设置
+	if (!gEnv->bServer)
+	{
+		CGamePlugin::GetInstance()->GetLockstepSimulation().SetSpawn(GetEntityId(), params.epoch, params.state);
+	}
+
+	return true;
+}
+
+void CPlayerComponent::SendLockstepHistoryOnServer(int channelId)
+{
+	RemoteLockstepHistoryParams params;
+	if (!CGamePlugin::GetInstance()->GetLockstepSimulation().GetHistory(GetEntityId(), params.history))
+		return;
+
+	SRmi<RMI_WRAP(&CPlayerComponent::RemoteLockstepHistoryOnClient)>::InvokeOnClient(this, std::move(params), channelId);
+}
+
+bool CPlayerComponent::RemoteLockstepHistoryOnClient(RemoteLockstepHistoryParams&& params, INetChannel* pNetChannel)
+{
+	if (!gEnv->bServer)
+	{
+		CGamePlugin* pGamePlugin = CGamePlugin::GetInstance();
+		pGamePlugin->GetLockstepSimulation().LoadHistory(GetEntityId(), params.history, pGamePlugin->GetLockstepTick());
+	}
+
+	return true;
+}
+
+bool CPlayerComponent::RemoteLockstepInputOnServer(RemoteLockstepInputParams&& params, INetChannel* pNetChannel)
+{
+	// 只接受拥有此玩家的频道发送的输入
+	if (gEnv->pGameFramework->GetNetChannel(m_pEntity->GetNetEntity()->GetChannelId()) != pNetChannel)
+		return true;
+
+	CGamePlugin* pGamePlugin = CGamePlugin::GetInstance();
+	pGamePlugin->GetLockstepSimulation().AddInput(GetEntityId(), params.epoch, params.epochStartTick, params.tick, params.input, pGamePlugin->GetLockstepTick());
+	++m_inputSequence;
+
+	RelayLockstepInputOnServer(params);
+	return true;
+}
+
+bool CPlayerComponent::RemoteLockstepInputOnClient(RemoteLockstepInputParams&& params, INetChannel* pNetChannel)
+{
+	// 主机上的模拟已在服务器端收到此输入
+	if (!gEnv->bServer)
+	{
+		CGamePlugin* pGamePlugin = CGamePlugin::GetInstance();
+		pGamePlugin->GetLockstepSimulation().AddInput(GetEntityId(), params.epoch, params.epochStartTick, params.tick, params.input, pGamePlugin->GetLockstepTick());
+	}
+
+	return true;
+}
+
+void CPlayerComponent::RelayLockstepInputOnServer(const RemoteLockstepInputParams& params)
+{
+	const int ownerChannelId = m_pEntity->GetNetEntity()->GetChannelId();
+
+	CGamePlugin::GetInstance()->IterateOverPlayers([this, ownerChannelId, &params](CPlayerComponent& player)
+	{
+		const int channelId = player.GetEntity()->GetNetEntity()->GetChannelId();
+		if (channelId == 0 || channelId == ownerChannelId)
+			return;
+
+		SRmi<RMI_WRAP(&CPlayerComponent::RemoteLockstepInputOnClient)>::InvokeOnClient(this, RemoteLockstepInputParams(params), channelId);
+	});
+}
+
+void CPlayerComponent::ReportLockstepChecksums(const std::vector<EntityId>& entityIds)
+{
+	const CLockstepSimulation& lockstep = CGamePlugin::GetInstance()->GetLockstepSimulation();
+
+	RemoteLockstepChecksumsParams params;
+	for (const EntityId entityId : entityIds)
+	{
+		RemoteLockstepChecksumsParams::SChecksum checksum;
+		checksum.entityId = entityId;
+		if (!lockstep.GetConfirmedChecksum(entityId, checksum.epoch, checksum.tick, checksum.checksum))
+			continue;
+
+		params.checksums.push_back(checksum);
+		if (params.checksums.size() == RemoteLockstepChecksumsParams::MaxChecksums)
+		{
+			SRmi<RMI_WRAP(&CPlayerComponent::RemoteLockstepChecksumsOnServer)>::InvokeOnServer(this, std::move(params));
+			params.checksums.clear();
+		}
+	}
+
+	if (!params.checksums.empty())
+	{
+		SRmi<RMI_WRAP(&CPlayerComponent::RemoteLockstepChecksumsOnServer)>::InvokeOnServer(this, std::move(params));
+	}
+}
+
+void CPlayerComponent::SendLockstepCorrectionOnServer(int channelId, uint16 epoch, uint32 tick)
+{
+	RemoteLockstepCorrectionParams params;
+	params.epoch = epoch;
+	params.tick = tick;
+
+	if (!CGamePlugin::GetInstance()->GetLockstepSimulation().GetHistoryState(GetEntityId(), tick, params.state, params.checksum))
+		return;
+
+	SRmi<RMI_WRAP(&CPlayerComponent::RemoteLockstepCorrectionOnClient)>::InvokeOnClient(this, std::move(params), channelId);
+}
+
+bool CPlayerComponent::RemoteLockstepChecksumsOnServer(RemoteLockstepChecksumsParams&& params, INetChannel* pNetChannel)
+{
+	// 只接受拥有此玩家的频道代为报告
+	const int channelId = m_pEntity->GetNetEntity()->GetChannelId();
+	if (channelId == 0 || gEnv->pGameFramework->GetNetChannel(channelId) != pNetChannel)
+		return true;
+
+	CGamePlugin* pGamePlugin = CGamePlugin::GetInstance();
+	for (const RemoteLockstepChecksumsParams::SChecksum& checksum : params.checksums)
+	{
+		pGamePlugin->QueueLockstepChecksum(CGamePlugin::SLockstepChecksumReport{ channelId, checksum.entityId, checksum.epoch, checksum.tick, checksum.checksum });
+	}
+
+	return true;
+}
+
+bool CPlayerComponent::RemoteLockstepCorrectionOnClient(RemoteLockstepCorrectionParams&& params, INetChannel* pNetChannel)
+{
+	if (!gEnv->bServer)
+	{
+		CGamePlugin::GetInstance()->GetLockstepSimulation().ApplyCorrection(GetEntityId(), params.epoch, params.tick, params.state, params.checksum);
+	}
+
+	return true;
+}
+
+void CPlayerComponent::EnableBotInput(uint32 seed)
+{
+	CRY_ASSERT(gEnv->bServer, "Bots are simulated on the server only!");
+
+	m_pBotInput = stl::make_unique<CBotInputGenerator>(seed);
+}
+
 // 与m_pInputComponent->RegisterAction配和使用
+void CPlayerComponent::HandleInputAction(const EInputAction action, const int activationMode, const float value)
+{
+	static_assert(CRY_ARRAY_COUNT(InputActions) == static_cast<size_t>(EInputAction::Count), "Every input action needs an entry in InputActions");
+	static_assert(IsInputActionTableOrdered(), "InputActions must be ordered by EInputAction");
+
+	const SInputActionDesc& desc = InputActions[static_cast<size_t>(action)];
+	switch (desc.op)
+	{
+	case EInputActionOp::Flag:
+		HandleInputFlagChange(desc.flag, static_cast<EActionActivationMode>(activationMode), desc.flagType);
+		break;
+	case EInputActionOp::RotateYaw:
+		m_mouseDeltaRotation.x -= value;
+		break;
+	case EInputActionOp::RotatePitch:
+		m_mouseDeltaRotation.y -= value;
+		break;
+	}
+}
+
+void CPlayerComponent::LoadInputBindings(const char* szBindings, EKeyId (&keys)[static_cast<size_t>(EInputAction::Count)])
+{
+	if (szBindings == nullptr || szBindings[0] == '\0' || gEnv->pInput == nullptr)
+		return;
+
+	const string bindings = szBindings;
+	int position = 0;
+	for (string binding = bindings.Tokenize(",", position); !binding.empty(); binding = bindings.Tokenize(",", position))
+	{
+		const size_t separator = binding.find('=');
+		if (separator == string::npos)
+		{
+			CryWarning(VALIDATOR_MODULE_GAME, VALIDATOR_WARNING, "[Input] Ignoring binding '%s', expected action=key", binding.c_str());
+			continue;
+		}
+
+		string actionName = binding.Left(separator);
+		string keyName = binding.Mid(separator + 1);
+		actionName.Trim();
+		keyName.Trim();
+
+		const SInputActionDesc* pDesc = nullptr;
+		for (const SInputActionDesc& desc : InputActions)
+		{
+			if (stricmp(desc.szName, actionName.c_str()) == 0)
+			{
+				pDesc = &desc;
+				break;
+			}
+		}
+
+		if (pDesc == nullptr)
+		{
+			CryWarning(VALIDATOR_MODULE_GAME, VALIDATOR_WARNING, "[Input] Ignoring binding for unknown action '%s'", actionName.c_str());
+			continue;
+		}
+
+		const SInputSymbol* pSymbol = gEnv->pInput->GetSymbolByName(keyName.c_str());
+		if (pSymbol == nullptr)
+		{
+			CryWarning(VALIDATOR_MODULE_GAME, VALIDATOR_WARNING, "[Input] Ignoring binding for action '%s', unknown key '%s'", actionName.c_str(), keyName.c_str());
+			continue;
+		}
+
+		keys[static_cast<size_t>(pDesc->action)] = pSymbol->keyId;
+	}
+}
+
 void CPlayerComponent::HandleInputFlagChange(const CEnumFlags<EInputFlag> flags, const CEnumFlags<EActionActivationMode> activationMode, const EInputFlagType type)
 {
 	switch (type)
@@ -264,8 +870,117 @@ void CPlayerComponent::HandleInputFlagChange(const CEnumFlags<EInputFlag> flags,
 	break;
 	}
 	
-	if(IsLocalClient())
+	// 锁步模式下输入在每个锁步tick经RMI发送
+	if(IsLocalClient() && !CGamePlugin::GetInstance()->IsLockstepEnabled())
 	{
+		// 以本地时钟为这次变化打上时间戳，服务器应用后原样回传
+		if (!gEnv->bServer)
+		{
+			++m_inputStamp.stampId;
+			m_inputStamp.clientTimeMs = static_cast<uint32>(gEnv->pTimer->GetAsyncTime().GetMilliSecondsAsInt64());
+		}
+
 		NetMarkAspectsDirty(InputAspect);
 	}
+}
+
+void CPlayerComponent::OnInputStampReceivedOnServer(uint16 prevStampId, uint16 prevEchoedStampId)
+{
+	CInputLatencyTracker& tracker = CGamePlugin::GetInstance()->GetInputLatencyTracker();
+	const int channelId = m_pEntity->GetNetEntity()->GetChannelId();
+
+	// 客户端报告的往返时间只记录一次
+	if (m_inputStamp.echoedStampId != prevEchoedStampId)
+	{
+		tracker.RecordRoundTrip(channelId, m_inputStamp.roundTripMs);
+	}
+
+	// 新的输入变化，等待下一次移动解析时应用
+	if (m_inputStamp.stampId != prevStampId && m_inputStamp.clientTimeMs != 0)
+	{
+		m_inputStampReceiptTime = gEnv->pTimer->GetAsyncTime();
+		m_hasPendingInputStamp = true;
+	}
+}
+
+void CPlayerComponent::SendClockSyncRequest(const CTimeValue& now, float roundTripTime)
+{
+	RemoteClockSyncRequestParams params;
+	params.clientSendTime = now.GetMicroSecondsAsInt64();
+	params.roundTripMicroseconds = static_cast<uint32>(max(roundTripTime, 0.f) * 1000000.f);
+
+	SRmi<RMI_WRAP(&CPlayerComponent::RemoteClockSyncRequestOnServer)>::InvokeOnServer(this, std::move(params));
+}
+
+bool CPlayerComponent::RemoteClockSyncRequestOnServer(RemoteClockSyncRequestParams&& params, INetChannel* pNetChannel)
+{
+	const CTimeValue receiveTime = gEnv->pTimer->GetAsyncTime();
+
+	// 只回复拥有此玩家的频道
+	const int channelId = m_pEntity->GetNetEntity()->GetChannelId();
+	if (channelId == 0 || gEnv->pGameFramework->GetNetChannel(channelId) != pNetChannel)
+		return true;
+
+	CGamePlugin::GetInstance()->GetClockSync().OnClientReport(channelId, static_cast<float>(params.roundTripMicroseconds) / 1000000.f);
+
+	RemoteClockSyncResponseParams response;
+	response.clientSendTime = params.clientSendTime;
+	response.serverReceiveTime = receiveTime.GetMicroSecondsAsInt64();
+	response.processingMicroseconds = static_cast<uint32>(max((gEnv->pTimer->GetAsyncTime() - receiveTime).GetMicroSecondsAsInt64(), static_cast<int64>(0)));
+
+	SRmi<RMI_WRAP(&CPlayerComponent::RemoteClockSyncResponseOnClient)>::InvokeOnClient(this, std::move(response), channelId);
+	return true;
+}
+
+bool CPlayerComponent::RemoteClockSyncResponseOnClient(RemoteClockSyncResponseParams&& params, INetChannel* pNetChannel)
+{
+	const CTimeValue receiveTime = gEnv->pTimer->GetAsyncTime();
+
+	CTimeValue clientSendTime;
+	clientSendTime.SetMicroSeconds(params.clientSendTime);
+	CTimeValue serverReceiveTime;
+	serverReceiveTime.SetMicroSeconds(params.serverReceiveTime);
+	CTimeValue serverSendTime;
+	serverSendTime.SetMicroSeconds(params.serverReceiveTime + params.processingMicroseconds);
+
+	CGamePlugin::GetInstance()->GetClockSync().OnResponse(clientSendTime, serverReceiveTime, serverSendTime, receiveTime);
+	return true;
+}
+
+void CPlayerComponent::OnMovementResolvedOnServer()
+{
+	if (!m_hasPendingInputStamp)
+		return;
+
+	m_hasPendingInputStamp = false;
+
+	const int channelId = m_pEntity->GetNetEntity()->GetChannelId();
+	if (channelId == 0)
+		return;
+
+	const int64 holdMs = (gEnv->pTimer->GetAsyncTime() - m_inputStampReceiptTime).GetMilliSecondsAsInt64();
+
+	RemoteInputLatencyEchoParams params;
+	params.stampId = m_inputStamp.stampId;
+	params.clientTimeMs = m_inputStamp.clientTimeMs;
+	params.serverHoldMs = static_cast<uint16>(clamp_tpl<int64>(holdMs, 0, 0xFFFF));
+
+	CGamePlugin::GetInstance()->GetInputLatencyTracker().RecordServerHold(channelId, params.serverHoldMs);
+	SRmi<RMI_WRAP(&CPlayerComponent::RemoteInputLatencyEchoOnClient)>::InvokeOnClient(this, std::move(params), channelId);
+}
+
+bool CPlayerComponent::RemoteInputLatencyEchoOnClient(RemoteInputLatencyEchoParams&& params, INetChannel* pNetChannel)
+{
+	// 更新的输入变化已经发出时，旧的回传仍然是一次有效的测量
+	const uint32 nowMs = static_cast<uint32>(gEnv->pTimer->GetAsyncTime().GetMilliSecondsAsInt64());
+	const uint16 roundTripMs = static_cast<uint16>(min(nowMs - params.clientTimeMs, 0xFFFFu));
+
+	CInputLatencyTracker& tracker = CGamePlugin::GetInstance()->GetInputLatencyTracker();
+	tracker.RecordServerHold(0, params.serverHoldMs);
+	tracker.RecordRoundTrip(0, roundTripMs);
+
+	// 随下一次输入变化报告给服务器
+	m_inputStamp.echoedStampId = params.stampId;
+	m_inputStamp.roundTripMs = roundTripMs;
+	return true;
 }
\ No newline at end of file
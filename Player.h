@@ -9,6 +9,13 @@
 #include <DefaultComponents/Cameras/CameraComponent.h>
 #include <DefaultComponents/Input/InputComponent.h>
 
+#include "BotInputGenerator.h"
+#include "LockstepSimulation.h"
+#include "NetPrecision.h"
+#include "ReplicationScheduler.h"
+#include "SnapshotCache.h"
+#include "ZoneLink.h"
+
 ////////////////////////////////////////////////////////
 // 代表游戏中的一个玩家
 ////////////////////////////////////////////////////////
@@ -30,8 +37,62 @@ class CPlayerComponent final : public IEntityComponent
 		MoveBack = 1 << 3
 	};
 
-	// 序列化的方面(Aspect)
+	// 本地玩家的输入动作，值为动作表中的下标
+	enum class EInputAction : uint8
+	{
+		MoveLeft = 0,
+		MoveRight,
+		MoveForward,
+		MoveBack,
+		RotateYaw,
+		RotatePitch,
+
+		Count
+	};
+
+	// 动作触发时执行的操作
+	enum class EInputActionOp : uint8
+	{
+		// 按flagType修改flag
+		Flag = 0,
+		// 累加鼠标转动
+		RotateYaw,
+		RotatePitch
+	};
+
+	struct SInputActionDesc
+	{
+		EInputAction action;
+		const char* szName;
+		EKeyId defaultKey;
+		EInputActionOp op;
+		EInputFlag flag;
+		EInputFlagType flagType;
+	};
+
+	static constexpr const char* InputActionGroup = "player";
+	// 动作表：InitializeLocalPlayer按此表一次注册并绑定所有动作，回调只携带动作下标，由HandleInputAction分发
+	// 添加动作只需在EInputAction与此表中各加一项
+	static constexpr SInputActionDesc InputActions[] =
+	{
+		{ EInputAction::MoveLeft,    "moveleft",          eKI_A,      EInputActionOp::Flag,        EInputFlag::MoveLeft,         EInputFlagType::Hold },
+		{ EInputAction::MoveRight,   "moveright",         eKI_D,      EInputActionOp::Flag,        EInputFlag::MoveRight,        EInputFlagType::Hold },
+		{ EInputAction::MoveForward, "moveforward",       eKI_W,      EInputActionOp::Flag,        EInputFlag::MoveForward,      EInputFlagType::Hold },
+		{ EInputAction::MoveBack,    "moveback",          eKI_S,      EInputActionOp::Flag,        EInputFlag::MoveBack,         EInputFlagType::Hold },
+		{ EInputAction::RotateYaw,   "mouse_rotateyaw",   eKI_MouseX, EInputActionOp::RotateYaw,   static_cast<EInputFlag>(0), EInputFlagType::Hold },
+		{ EInputAction::RotatePitch, "mouse_rotatepitch", eKI_MouseY, EInputActionOp::RotatePitch, static_cast<EInputFlag>(0), EInputFlagType::Hold }
+	};
+
+	// 序列化的方面(Aspect)，各自独立标记为脏并以各自的速率发送
+	// 客户端输入，变化时发送
 	static constexpr EEntityAspects InputAspect = eEA_GameClientD;
+	// 服务器权威的位置与朝向，高频发送，丢失的更新由下一次更新取代，profile参数为CNetPrecision::EProfile
+	static constexpr EEntityAspects MovementAspect = eEA_GameServerA;
+	// 低频的玩家状态(存活、休眠、复活计数与出生位置)，只在变化时发送，重要性最高
+	// 客户端只需收敛到最新的状态，不依赖可靠有序的消息队列
+	static constexpr EEntityAspects StatusAspect = eEA_GameServerB;
+	// 本地玩家与服务器位置相差超过此距离(米)时才接受服务器的校正
+	static constexpr float MaxLocalPositionError = 1.f;
 	
 public:
 	CPlayerComponent() = default;
@@ -45,7 +106,7 @@ public:
 	
 	// 网络序列化
 	virtual bool NetSerialize(TSerialize ser, EEntityAspects aspect, uint8 profile, int flags) override;
-	virtual NetworkAspectType GetNetSerializeAspectMask() const override { return InputAspect; }
+	virtual NetworkAspectType GetNetSerializeAspectMask() const override { return InputAspect | MovementAspect | StatusAspect; }
 	// ~IEntityComponent
 
 	// 反射类型，为此组件设定独有id
@@ -55,44 +116,389 @@ public:
 	}
 
 	void OnReadyForGameplayOnServer();
+	// 断线重连后在服务器上调用，在实体当前位置恢复玩家
+	void OnReconnectedOnServer();
+	// 服务器：把会话令牌发给拥有此玩家的客户端
+	void SendSessionTokenOnServer(uint64 sessionToken);
 	bool IsLocalClient() const { return (m_pEntity->GetFlags() & ENTITY_FLAG_LOCAL_PLAYER) != 0; }
+	bool IsAlive() const { return m_isAlive; }
+	bool IsDormant() const { return m_isDormant; }
+
+	// 休眠：断线后等待重连期间隐藏实体并停止模拟，保留位置等状态
+	void SetDormant(bool bDormant);
+
+	// 角色控制器：本帧期望的位移由CGamePlugin批量解析碰撞后再应用
+	Vec3 ConsumeDesiredDisplacement() { const Vec3 displacement = m_desiredDisplacement; m_desiredDisplacement = ZERO; return displacement; }
+	float GetVerticalVelocity() const { return m_verticalVelocity; }
+	bool IsGrounded() const { return m_isGrounded; }
+	void SetMovementState(float verticalVelocity, bool isGrounded) { m_verticalVelocity = verticalVelocity; m_isGrounded = isGrounded; }
+	// 自上次解析以来积分的时长，为0时本帧没有模拟
+	float ConsumeStepTime() { const float stepTime = m_pendingStepTime; m_pendingStepTime = 0.f; return stepTime; }
+
+	// 模拟LOD：每interval帧积分一次，由CGamePlugin根据到观察者的距离设定
+	void SetSimulationInterval(uint8 interval) { m_simulationInterval = interval; }
+	uint8 GetSimulationInterval() const { return m_simulationInterval; }
+
+	// 转为服务器端机器人，由脚本化输入代替网络频道驱动
+	void EnableBotInput(uint32 seed);
+	bool IsBot() const { return m_pBotInput != nullptr; }
+
+	// 服务器上移动解析后调用，请求复制新的位置与朝向
+	void OnMovedOnServer() { RequestAspectReplication(MovementAspect); }
+	// 客户端：经本地玩家向服务器发送时钟同步请求
+	void SendClockSyncRequest(const CTimeValue& now, float roundTripTime);
+	// 服务器上每次解析此玩家的移动后调用，收到的输入变化在此视为已应用并回传延迟时间戳
+	void OnMovementResolvedOnServer();
+	// 服务器上根据到最近客户端的距离选择移动方面的序列化精度
+	void SetMovementPrecision(CNetPrecision::EProfile precision);
+	// 服务器上本帧批量编码的快照中此玩家的槽位
+	void SetSnapshotSlot(uint32 slot) { m_snapshotSlot = slot; }
+
+	// 区域分片：写出移交给相邻区域进程的状态，以及在目标区域恢复该状态
+	void WriteHandoff(CZoneLink::SPlayerHandoff& handoff) const;
+	void ReadHandoffOnServer(const CZoneLink::SPlayerHandoff& handoff);
+	// 通知拥有此玩家的客户端重新连接到同一台机器上gamePort端口的区域进程，并在那里出示handoffToken
+	void TransferToZoneOnServer(uint16 gamePort, uint64 handoffToken);
+	// 管理命令：把玩家移到transform并像复活一样同步到所有客户端
+	void TeleportOnServer(const Matrix34& transform) { ReviveOnServer(transform); }
+	// 幽灵：相邻区域拥有的玩家的只读副本，只应用收到的变换，不模拟
+	void ApplyGhostStateOnServer(const QuatT& transform);
+	bool IsGhost() const { return m_isGhost; }
+
+	// 锁步模式：本地玩家与服务器上的机器人每个锁步tick产生一个输入并发送，移动由CLockstepSimulation模拟
+	bool IsLockstepOwner() const { return IsLocalClient() || (gEnv->bServer && IsBot()); }
+	void UpdateLockstepInput(uint32 tick);
+	// 客户端：通过本地玩家向服务器报告各玩家已确认的滚动校验和
+	void ReportLockstepChecksums(const std::vector<EntityId>& entityIds);
+	// 服务器：向channelId发送此玩家在epoch纪元tick的权威定点状态
+	void SendLockstepCorrectionOnServer(int channelId, uint16 epoch, uint32 tick);
+	// 服务器：向刚准备好游戏的channelId发送此玩家当前纪元的出生状态与已确认的历史
+	void SendLockstepHistoryOnServer(int channelId);
 	
 protected:
 	void Revive(const Matrix34& transform);
+	// 应用复制来的变换，本地玩家只在与预测偏差过大时校正
+	void ApplyReplicatedTransform(const QuatT& transform);
+	// 在服务器上Revive，并通过状态方面同步到所有客户端
+	void ReviveOnServer(const Matrix34& transform);
+	// 请求复制方面：服务器上经过复制调度器，客户端上直接标记为脏
+	void RequestAspectReplication(EEntityAspects aspect);
+	// 方面的重要性、预计大小与发送间隔
+	CReplicationScheduler::SAspectDesc GetAspectReplicationDesc(EEntityAspects aspect) const;
 	void HandleInputFlagChange(CEnumFlags<EInputFlag> flags, CEnumFlags<EActionActivationMode> activationMode, EInputFlagType type = EInputFlagType::Hold);
+	// 按动作表分发输入动作
+	void HandleInputAction(EInputAction action, int activationMode, float value);
+	// 以szBindings("动作=按键"，逗号分隔)覆盖keys中对应动作的按键，无法识别的项给出警告并忽略
+	static void LoadInputBindings(const char* szBindings, EKeyId (&keys)[static_cast<size_t>(EInputAction::Count)]);
+	// 动作表的第i项必须对应EInputAction的第i个值
+	static constexpr bool IsInputActionTableOrdered(size_t index = 0)
+	{
+		return index >= CRY_ARRAY_COUNT(InputActions) || (static_cast<size_t>(InputActions[index].action) == index && IsInputActionTableOrdered(index + 1));
+	}
+	// 服务器读取输入方面后记录新的延迟时间戳与客户端报告的往返时间
+	void OnInputStampReceivedOnServer(uint16 prevStampId, uint16 prevEchoedStampId);
 
 	// 当实体成为本地玩家时调用，用以创建客户端特化设定比如相机
 	void InitializeLocalPlayer();
-	
+
 	// 以下为远程(Remote)方法定义
 protected:
-	// 传递给RemoteReviveOnClient函数的参数
-	struct RemoteReviveParams
+	// 传递给RemoteZoneTransferOnClient函数的参数
+	struct RemoteZoneTransferParams
+	{
+		void SerializeWith(TSerialize ser)
+		{
+			ser.Value("gamePort", gamePort, 'ui16');
+			uint32 tokenHigh = static_cast<uint32>(handoffToken >> 32);
+			uint32 tokenLow = static_cast<uint32>(handoffToken);
+			ser.Value("tokenHigh", tokenHigh, 'ui32');
+			ser.Value("tokenLow", tokenLow, 'ui32');
+			handoffToken = (static_cast<uint64>(tokenHigh) << 32) | tokenLow;
+		}
+
+		uint16 gamePort = 0;
+		uint64 handoffToken = 0;
+	};
+
+	// 断线重连的会话令牌，拆分为两个32位值发送
+	struct RemoteSessionTokenParams
+	{
+		void SerializeWith(TSerialize ser)
+		{
+			uint32 tokenHigh = static_cast<uint32>(sessionToken >> 32);
+			uint32 tokenLow = static_cast<uint32>(sessionToken);
+			ser.Value("tokenHigh", tokenHigh, 'ui32');
+			ser.Value("tokenLow", tokenLow, 'ui32');
+			sessionToken = (static_cast<uint64>(tokenHigh) << 32) | tokenLow;
+		}
+
+		uint64 sessionToken = 0;
+	};
+
+	// 时钟同步请求，时间以微秒表示并拆分为两个32位值发送
+	struct RemoteClockSyncRequestParams
+	{
+		void SerializeWith(TSerialize ser)
+		{
+			uint32 sendTimeHigh = static_cast<uint32>(static_cast<uint64>(clientSendTime) >> 32);
+			uint32 sendTimeLow = static_cast<uint32>(clientSendTime);
+			ser.Value("sendTimeHigh", sendTimeHigh, 'ui32');
+			ser.Value("sendTimeLow", sendTimeLow, 'ui32');
+			clientSendTime = static_cast<int64>((static_cast<uint64>(sendTimeHigh) << 32) | sendTimeLow);
+
+			ser.Value("roundTrip", roundTripMicroseconds, 'ui32');
+		}
+
+		int64 clientSendTime = 0;
+		// 客户端当前估计的往返时间，报告给服务器
+		uint32 roundTripMicroseconds = 0;
+	};
+
+	// 时钟同步回复，带回请求的发送时间以及服务器收到与回复的时间
+	struct RemoteClockSyncResponseParams
+	{
+		void SerializeWith(TSerialize ser)
+		{
+			uint32 sendTimeHigh = static_cast<uint32>(static_cast<uint64>(clientSendTime) >> 32);
+			uint32 sendTimeLow = static_cast<uint32>(clientSendTime);
+			ser.Value("sendTimeHigh", sendTimeHigh, 'ui32');
+			ser.Value("sendTimeLow", sendTimeLow, 'ui32');
+			clientSendTime = static_cast<int64>((static_cast<uint64>(sendTimeHigh) << 32) | sendTimeLow);
+
+			uint32 receiveTimeHigh = static_cast<uint32>(static_cast<uint64>(serverReceiveTime) >> 32);
+			uint32 receiveTimeLow = static_cast<uint32>(serverReceiveTime);
+			ser.Value("receiveTimeHigh", receiveTimeHigh, 'ui32');
+			ser.Value("receiveTimeLow", receiveTimeLow, 'ui32');
+			serverReceiveTime = static_cast<int64>((static_cast<uint64>(receiveTimeHigh) << 32) | receiveTimeLow);
+
+			// 服务器处理时间很短，以相对收到时间的微秒数发送
+			ser.Value("processing", processingMicroseconds, 'ui32');
+		}
+
+		int64 clientSendTime = 0;
+		int64 serverReceiveTime = 0;
+		uint32 processingMicroseconds = 0;
+	};
+
+	bool RemoteClockSyncRequestOnServer(RemoteClockSyncRequestParams&& params, INetChannel* pNetChannel);
+	bool RemoteClockSyncResponseOnClient(RemoteClockSyncResponseParams&& params, INetChannel* pNetChannel);
+
+	// 服务器应用输入变化后回传的延迟时间戳
+	struct RemoteInputLatencyEchoParams
+	{
+		void SerializeWith(TSerialize ser)
+		{
+			ser.Value("stampId", stampId, 'ui16');
+			ser.Value("clientTime", clientTimeMs, 'ui32');
+			ser.Value("serverHold", serverHoldMs, 'ui16');
+		}
+
+		uint16 stampId = 0;
+		// 客户端打时间戳时的本地时钟(毫秒)
+		uint32 clientTimeMs = 0;
+		// 服务器收到输入到应用之间的等待(毫秒)
+		uint16 serverHoldMs = 0;
+	};
+
+	bool RemoteInputLatencyEchoOnClient(RemoteInputLatencyEchoParams&& params, INetChannel* pNetChannel);
+
+	// 服务器只把会话令牌发给拥有此玩家的客户端，客户端断线重连时随连接请求出示它取回之前的玩家
+	bool RemoteSessionTokenOnClient(RemoteSessionTokenParams&& params, INetChannel* pNetChannel);
+
+	// 玩家被移交到另一个区域进程，客户端断开并连接到该进程(完整的重新连接与关卡加载)
+	bool RemoteZoneTransferOnClient(RemoteZoneTransferParams&& params, INetChannel* pNetChannel);
+
+	// 锁步的定点状态逐位序列化
+	static void SerializeLockstepState(TSerialize ser, CLockstepSimulation::SState& state)
+	{
+		ser.Value("x", reinterpret_cast<uint32&>(state.x), 'ui32');
+		ser.Value("y", reinterpret_cast<uint32&>(state.y), 'ui32');
+		ser.Value("z", reinterpret_cast<uint32&>(state.z), 'ui32');
+		ser.Value("verticalSpeed", reinterpret_cast<uint32&>(state.verticalSpeed), 'ui32');
+		ser.Value("groundZ", reinterpret_cast<uint32&>(state.groundZ), 'ui32');
+		ser.Value("yaw", state.yaw, 'ui16');
+		ser.Value("pitch", state.pitch, 'ui16');
+	}
+
+	// 锁步模式下复活时的定点出生状态，不经过有损压缩，所有对等端从逐位相同的状态开始模拟
+	struct RemoteLockstepSpawnParams
+	{
+		void SerializeWith(TSerialize ser)
+		{
+			ser.Value("epoch", epoch, 'ui16');
+			SerializeLockstepState(ser, state);
+		}
+
+		uint16 epoch = 0;
+		CLockstepSimulation::SState state;
+	};
+
+	// 一个锁步tick的输入，客户端发送到服务器，服务器转发给其他客户端
+	struct RemoteLockstepInputParams
+	{
+		void SerializeWith(TSerialize ser)
+		{
+			ser.Value("epoch", epoch, 'ui16');
+			ser.Value("epochStartTick", epochStartTick, 'ui32');
+			ser.Value("tick", tick, 'ui32');
+			ser.Value("flags", input.flags, 'ui8');
+			ser.Value("yawDelta", reinterpret_cast<uint16&>(input.yawDelta), 'ui16');
+			ser.Value("pitchDelta", reinterpret_cast<uint16&>(input.pitchDelta), 'ui16');
+		}
+
+		uint16 epoch = 0;
+		uint32 epochStartTick = 0;
+		uint32 tick = 0;
+		CLockstepSimulation::SInput input;
+	};
+
+	// 客户端各玩家已确认的校验和，实体id经网络转换
+	struct RemoteLockstepChecksumsParams
+	{
+		struct SChecksum
+		{
+			EntityId entityId = INVALID_ENTITYID;
+			uint16 epoch = 0;
+			uint32 tick = 0;
+			uint32 checksum = 0;
+		};
+
+		// 一个消息最多携带的校验和
+		static constexpr size_t MaxChecksums = 255;
+
+		void SerializeWith(TSerialize ser)
+		{
+			uint8 count = static_cast<uint8>(checksums.size());
+			ser.Value("count", count, 'ui8');
+			if (ser.IsReading())
+			{
+				checksums.resize(count);
+			}
+
+			for (SChecksum& checksum : checksums)
+			{
+				ser.Value("entityId", checksum.entityId, 'eid');
+				ser.Value("epoch", checksum.epoch, 'ui16');
+				ser.Value("tick", checksum.tick, 'ui32');
+				ser.Value("checksum", checksum.checksum, 'ui32');
+			}
+		}
+
+		std::vector<SChecksum> checksums;
+	};
+
+	// 校验和分歧时服务器发送的权威状态，客户端以此覆盖该tick的状态并重新模拟
+	struct RemoteLockstepCorrectionParams
 	{
-		// 在服务器上调用一次，以此序列化数据到其他客户端
-		// 然后在另一边调用一次以反序列化
-		// Called once on the server to serialize data to the other clients
-		// Then called once on the other side to deserialize
 		void SerializeWith(TSerialize ser)
 		{
-			// 以'wrld'压缩策略序列化坐标
-			ser.Value("pos", position, 'wrld');
-			// 以'ori0'压缩策略序列化旋转
-			ser.Value("rot", rotation, 'ori0');
+			ser.Value("epoch", epoch, 'ui16');
+			ser.Value("tick", tick, 'ui32');
+			SerializeLockstepState(ser, state);
+			ser.Value("checksum", checksum, 'ui32');
 		}
-		
-		Vec3 position;
-		Quat rotation;
+
+		uint16 epoch = 0;
+		uint32 tick = 0;
+		CLockstepSimulation::SState state;
+		uint32 checksum = 0;
 	};
-	// 远程方法，用于当一个玩家在服务器上生成时，在所有远程客户端上调用
-	bool RemoteReviveOnClient(RemoteReviveParams&& params, INetChannel* pNetChannel);
+
+	// 中途加入的客户端收到的已在游戏中的玩家的出生状态与已确认历史
+	struct RemoteLockstepHistoryParams
+	{
+		void SerializeWith(TSerialize ser)
+		{
+			ser.Value("epoch", history.epoch, 'ui16');
+			SerializeLockstepState(ser, history.spawnState);
+			ser.Value("started", history.bStarted, 'bool');
+			if (!history.bStarted)
+				return;
+
+			ser.Value("baseTick", history.baseTick, 'ui32');
+			SerializeLockstepState(ser, history.baseState);
+			ser.Value("baseChecksum", history.baseChecksum, 'ui32');
+
+			uint8 count = static_cast<uint8>(history.inputs.size());
+			ser.Value("count", count, 'ui8');
+			if (ser.IsReading())
+			{
+				history.inputs.resize(count);
+			}
+
+			for (CLockstepSimulation::SInput& input : history.inputs)
+			{
+				ser.Value("flags", input.flags, 'ui8');
+				ser.Value("yawDelta", reinterpret_cast<uint16&>(input.yawDelta), 'ui16');
+				ser.Value("pitchDelta", reinterpret_cast<uint16&>(input.pitchDelta), 'ui16');
+			}
+		}
+
+		CLockstepSimulation::SHistory history;
+	};
+
+	bool RemoteLockstepSpawnOnClient(RemoteLockstepSpawnParams&& params, INetChannel* pNetChannel);
+	bool RemoteLockstepHistoryOnClient(RemoteLockstepHistoryParams&& params, INetChannel* pNetChannel);
+	bool RemoteLockstepInputOnServer(RemoteLockstepInputParams&& params, INetChannel* pNetChannel);
+	bool RemoteLockstepInputOnClient(RemoteLockstepInputParams&& params, INetChannel* pNetChannel);
+	bool RemoteLockstepChecksumsOnServer(RemoteLockstepChecksumsParams&& params, INetChannel* pNetChannel);
+	bool RemoteLockstepCorrectionOnClient(RemoteLockstepCorrectionParams&& params, INetChannel* pNetChannel);
+	// 在服务器上把输入转发给除拥有者以外的所有客户端
+	void RelayLockstepInputOnServer(const RemoteLockstepInputParams& params);
 	
 protected:
 	bool m_isAlive = false;
+	bool m_isDormant = false;
+	bool m_isGhost = false;
+
+	// 每次复活递增，客户端看到新的计数时在状态方面携带的当前位置复活
+	// 服务器上m_spawnTransform为最近一次复活的位置，锁步模式以它生成出生状态
+	uint16 m_reviveCount = 0;
+	QuatT m_spawnTransform = QuatT(IDENTITY);
 
 	Cry::DefaultComponents::CCameraComponent* m_pCameraComponent = nullptr;
 	Cry::DefaultComponents::CInputComponent* m_pInputComponent = nullptr;
 
 	CEnumFlags<EInputFlag> m_inputFlags;
+	// 服务器上已应用的输入变化次数，区域移交时随玩家一起迁移
+	uint32 m_inputSequence = 0;
 	Vec2 m_mouseDeltaRotation;
+
+	// 随输入方面发送的延迟时间戳
+	struct SInputStamp
+	{
+		uint16 stampId = 0;
+		uint32 clientTimeMs = 0;
+		// 客户端最近收到回传的时间戳及其往返时间
+		uint16 echoedStampId = 0;
+		uint16 roundTripMs = 0;
+	};
+	SInputStamp m_inputStamp;
+	// 服务器收到最新时间戳的时间，应用后回传
+	CTimeValue m_inputStampReceiptTime;
+	bool m_hasPendingInputStamp = false;
+
+	// 等待角色控制器解析的世界空间位移
+	Vec3 m_desiredDisplacement = ZERO;
+	float m_verticalVelocity = 0.f;
+	bool m_isGrounded = false;
+	// 已积分、等待角色控制器解析的时长
+	float m_pendingStepTime = 0.f;
+
+	uint8 m_simulationInterval = 1;
+	// 降频模拟时尚未积分的累积时间
+	float m_unsimulatedTime = 0.f;
+
+	CNetPrecision::EProfile m_movementPrecision = CNetPrecision::EProfile::Full;
+	uint32 m_snapshotSlot = CSnapshotCache::InvalidSlot;
+
+	// 锁步模式下拥有者当前输入流的纪元(复活计数)与起始tick
+	uint16 m_lockstepEpoch = 0;
+	uint32 m_lockstepEpochStartTick = 0;
+	bool m_hasLockstepEpoch = false;
+	// 鼠标位移量化后未满一个角度单位的部分
+	Vec2 m_lockstepRotationRemainder = ZERO;
+
+	// 仅机器人玩家拥有
+	std::unique_ptr<CBotInputGenerator> m_pBotInput;
 };
@@ -0,0 +1,238 @@
+#include "StdAfx.h"
+#include "PlayerBroadphase.h"
+
+void CPlayerBroadphase::SetDimensions(float radius, float height)
+{
+	if (radius == m_radius && height == m_height)
+		return;
+
+	m_radius = radius;
+	m_height = height;
+	m_invCellSize = 1.f / (2.f * radius);
+
+	// 单元尺寸改变，所有玩家需要重新分桶
+	m_cells.clear();
+	for (uint32 bodyIndex = 0; bodyIndex < m_bodies.size(); ++bodyIndex)
+	{
+		m_bodies[bodyIndex].cellKey = GetCellKey(m_bodies[bodyIndex].position);
+		AddToCell(bodyIndex);
+	}
+}
+
+void CPlayerBroadphase::UpdateBody(EntityId entityId, const Vec3& position, uint32 userIndex)
+{
+	const TCellKey cellKey = GetCellKey(position);
+
+	auto it = m_bodyLookup.find(entityId);
+	if (it == m_bodyLookup.end())
+	{
+		const uint32 bodyIndex = static_cast<uint32>(m_bodies.size());
+		m_bodies.push_back(SBody{ entityId, position, cellKey, 0, userIndex, m_updateStamp });
+		m_bodyLookup.emplace(entityId, bodyIndex);
+		AddToCell(bodyIndex);
+		return;
+	}
+
+	const uint32 bodyIndex = it->second;
+	SBody& body = m_bodies[bodyIndex];
+	body.position = position;
+	body.userIndex = userIndex;
+	body.updateStamp = m_updateStamp;
+
+	// 只有跨越单元时才需要移动桶位
+	if (body.cellKey != cellKey)
+	{
+		RemoveFromCell(bodyIndex);
+		body.cellKey = cellKey;
+		AddToCell(bodyIndex);
+	}
+}
+
+void CPlayerBroadphase::RemoveBody(EntityId entityId)
+{
+	auto it = m_bodyLookup.find(entityId);
+	if (it != m_bodyLookup.end())
+	{
+		RemoveBodyAt(it->second);
+	}
+}
+
+void CPlayerBroadphase::RemoveStaleBodies()
+{
+	for (uint32 bodyIndex = 0; bodyIndex < m_bodies.size();)
+	{
+		if (m_bodies[bodyIndex].updateStamp != m_updateStamp)
+		{
+			// 最后一个物体被交换到当前位置，不递增索引
+			RemoveBodyAt(bodyIndex);
+		}
+		else
+		{
+			++bodyIndex;
+		}
+	}
+
+	++m_updateStamp;
+}
+
+void CPlayerBroadphase::Clear()
+{
+	m_bodies.clear();
+	m_bodyLookup.clear();
+	m_cells.clear();
+}
+
+size_t CPlayerBroadphase::ComputeSeparation(float pushFactor, std::vector<Vec3>& corrections) const
+{
+	const float diameter = 2.f * m_radius;
+	const float diameterSquared = diameter * diameter;
+	size_t pairCount = 0;
+
+	for (uint32 bodyIndex = 0; bodyIndex < m_bodies.size(); ++bodyIndex)
+	{
+		const SBody& body = m_bodies[bodyIndex];
+		const int32 cellX = static_cast<int32>(body.cellKey >> 32);
+		const int32 cellY = static_cast<int32>(body.cellKey & 0xFFFFFFFF);
+
+		for (int32 offsetY = -1; offsetY <= 1; ++offsetY)
+		{
+			for (int32 offsetX = -1; offsetX <= 1; ++offsetX)
+			{
+				auto cellIt = m_cells.find(MakeCellKey(cellX + offsetX, cellY + offsetY));
+				if (cellIt == m_cells.end())
+					continue;
+
+				for (const uint32 otherIndex : cellIt->second)
+				{
+					// 每对只处理一次
+					if (otherIndex <= bodyIndex)
+						continue;
+
+					const SBody& other = m_bodies[otherIndex];
+					if (fabs_tpl(body.position.z - other.position.z) >= m_height)
+						continue;
+
+					Vec2 delta(body.position.x - other.position.x, body.position.y - other.position.y);
+					const float distanceSquared = delta.GetLength2();
+					if (distanceSquared >= diameterSquared)
+						continue;
+
+					++pairCount;
+
+					// 完全重合时按实体id选一个固定方向，两端的结果一致
+					float distance = sqrt_tpl(distanceSquared);
+					const float overlap = diameter - distance;
+					if (distance < 0.0001f)
+					{
+						const float angle = static_cast<float>(((body.entityId ^ (other.entityId << 16)) * 2654435761u) >> 8) * (gf_PI2 / 16777216.f);
+						delta = Vec2(cos_tpl(angle), sin_tpl(angle));
+						distance = 1.f;
+					}
+
+					const float push = overlap * 0.5f * pushFactor / distance;
+					const Vec3 correction(delta.x * push, delta.y * push, 0.f);
+
+					corrections[body.userIndex] += correction;
+					corrections[other.userIndex] -= correction;
+				}
+			}
+		}
+	}
+
+	return pairCount;
+}
+
+float CPlayerBroadphase::Benchmark(int bodyCount, float density, int iterations)
+{
+	CPlayerBroadphase broadphase;
+
+	// 在边长使每平方米density个物体的正方形区域内随机分布
+	const float areaSize = sqrt_tpl(static_cast<float>(bodyCount) / density);
+	uint32 randomState = 0x12345678u;
+	const auto nextRandom = [&randomState]()
+	{
+		randomState ^= randomState << 13;
+		randomState ^= randomState >> 17;
+		randomState ^= randomState << 5;
+		return static_cast<float>(randomState >> 8) * (1.f / 16777216.f);
+	};
+
+	std::vector<Vec3> positions(bodyCount);
+	for (Vec3& position : positions)
+	{
+		position = Vec3(nextRandom() * areaSize, nextRandom() * areaSize, 0.f);
+	}
+
+	std::vector<Vec3> corrections(bodyCount);
+	const CTimeValue startTime = gEnv->pTimer->GetAsyncTime();
+
+	for (int iteration = 0; iteration < iterations; ++iteration)
+	{
+		for (int i = 0; i < bodyCount; ++i)
+		{
+			broadphase.UpdateBody(static_cast<EntityId>(i + 1), positions[i], i);
+		}
+		broadphase.RemoveStaleBodies();
+
+		std::fill(corrections.begin(), corrections.end(), Vec3(ZERO));
+		broadphase.ComputeSeparation(0.5f, corrections);
+
+		// 应用分离并加入随机游走，模拟人群每帧的移动
+		for (int i = 0; i < bodyCount; ++i)
+		{
+			positions[i] += corrections[i] + Vec3((nextRandom() - 0.5f) * 0.2f, (nextRandom() - 0.5f) * 0.2f, 0.f);
+		}
+	}
+
+	return (gEnv->pTimer->GetAsyncTime() - startTime).GetMilliSeconds() / static_cast<float>(max(iterations, 1));
+}
+
+CPlayerBroadphase::TCellKey CPlayerBroadphase::GetCellKey(const Vec3& position) const
+{
+	const int32 cellX = static_cast<int32>(floor_tpl(position.x * m_invCellSize));
+	const int32 cellY = static_cast<int32>(floor_tpl(position.y * m_invCellSize));
+	return MakeCellKey(cellX, cellY);
+}
+
+void CPlayerBroadphase::AddToCell(uint32 bodyIndex)
+{
+	std::vector<uint32>& cell = m_cells[m_bodies[bodyIndex].cellKey];
+	m_bodies[bodyIndex].indexInCell = static_cast<uint32>(cell.size());
+	cell.push_back(bodyIndex);
+}
+
+void CPlayerBroadphase::RemoveFromCell(uint32 bodyIndex)
+{
+	const SBody& body = m_bodies[bodyIndex];
+	auto cellIt = m_cells.find(body.cellKey);
+	std::vector<uint32>& cell = cellIt->second;
+
+	// 与单元中最后一个交换后移除
+	const uint32 movedBodyIndex = cell.back();
+	cell[body.indexInCell] = movedBodyIndex;
+	m_bodies[movedBodyIndex].indexInCell = body.indexInCell;
+	cell.pop_back();
+
+	if (cell.empty())
+	{
+		m_cells.erase(cellIt);
+	}
+}
+
+void CPlayerBroadphase::RemoveBodyAt(uint32 bodyIndex)
+{
+	RemoveFromCell(bodyIndex);
+	m_bodyLookup.erase(m_bodies[bodyIndex].entityId);
+
+	// 把最后一个物体移到空出的位置，并修正其在单元与查找表中的引用
+	const uint32 lastIndex = static_cast<uint32>(m_bodies.size() - 1);
+	if (bodyIndex != lastIndex)
+	{
+		m_bodies[bodyIndex] = m_bodies[lastIndex];
+		const SBody& movedBody = m_bodies[bodyIndex];
+		m_cells[movedBody.cellKey][movedBody.indexInCell] = bodyIndex;
+		m_bodyLookup[movedBody.entityId] = bodyIndex;
+	}
+
+	m_bodies.pop_back();
+}
@@ -0,0 +1,167 @@
+#include "StdAfx.h"
+#include "PlayerRegistry.h"
+
+CPlayerRegistry::CReadScope::CReadScope(const CPlayerRegistry& registry)
+	: m_registry(registry)
+{
+	// 在当前纪元登记为读者；登记期间纪元发生了变化则重试，保证计数对应的纪元与读取时一致
+	for (;;)
+	{
+		m_epoch = registry.m_epoch.load();
+		registry.m_activeReaders[m_epoch & 1].fetch_add(1);
+
+		if (registry.m_epoch.load() == m_epoch)
+			break;
+
+		registry.m_activeReaders[m_epoch & 1].fetch_sub(1);
+	}
+
+	m_pMap = registry.m_pCurrent.load();
+}
+
+CPlayerRegistry::CReadScope::~CReadScope()
+{
+	m_registry.m_activeReaders[m_epoch & 1].fetch_sub(1);
+}
+
+CPlayerRegistry::CPlayerRegistry()
+	: m_pCurrent(new TMap())
+	, m_epoch(0)
+{
+	m_activeReaders[0] = 0;
+	m_activeReaders[1] = 0;
+}
+
+CPlayerRegistry::~CPlayerRegistry()
+{
+	CRY_ASSERT(m_activeReaders[0] == 0 && m_activeReaders[1] == 0, "Player registry destroyed while being read");
+
+	for (const SRetiredVersion& retiredVersion : m_retiredVersions)
+	{
+		delete retiredVersion.pMap;
+	}
+
+	delete m_pCurrent.load();
+}
+
+EntityId CPlayerRegistry::Find(int channelId) const
+{
+	CReadScope scope(*this);
+
+	auto it = scope->find(channelId);
+	return it != scope->end() ? it->second : INVALID_ENTITYID;
+}
+
+size_t CPlayerRegistry::GetSize() const
+{
+	CReadScope scope(*this);
+	return scope->size();
+}
+
+void CPlayerRegistry::Insert(int channelId, EntityId entityId)
+{
+	CryAutoLock<CryCriticalSectionNonRecursive> lock(m_writeLock);
+
+	TMap* pNewMap = new TMap(*m_pCurrent.load());
+	(*pNewMap)[channelId] = entityId;
+
+	Publish(pNewMap);
+}
+
+bool CPlayerRegistry::Erase(int channelId)
+{
+	CryAutoLock<CryCriticalSectionNonRecursive> lock(m_writeLock);
+
+	const TMap* pCurrentMap = m_pCurrent.load();
+	if (pCurrentMap->find(channelId) == pCurrentMap->end())
+		return false;
+
+	TMap* pNewMap = new TMap(*pCurrentMap);
+	pNewMap->erase(channelId);
+
+	Publish(pNewMap);
+	return true;
+}
+
+void CPlayerRegistry::InsertRange(const std::vector<std::pair<int, EntityId>>& entries)
+{
+	if (entries.empty())
+		return;
+
+	CryAutoLock<CryCriticalSectionNonRecursive> lock(m_writeLock);
+
+	TMap* pNewMap = new TMap(*m_pCurrent.load());
+	for (const std::pair<int, EntityId>& entry : entries)
+	{
+		(*pNewMap)[entry.first] = entry.second;
+	}
+
+	Publish(pNewMap);
+}
+
+void CPlayerRegistry::EraseRange(const std::vector<int>& channelIds)
+{
+	if (channelIds.empty())
+		return;
+
+	CryAutoLock<CryCriticalSectionNonRecursive> lock(m_writeLock);
+
+	TMap* pNewMap = new TMap(*m_pCurrent.load());
+	for (const int channelId : channelIds)
+	{
+		pNewMap->erase(channelId);
+	}
+
+	Publish(pNewMap);
+}
+
+void CPlayerRegistry::Clear()
+{
+	CryAutoLock<CryCriticalSectionNonRecursive> lock(m_writeLock);
+
+	if (m_pCurrent.load()->empty())
+		return;
+
+	Publish(new TMap());
+}
+
+void CPlayerRegistry::CollectGarbage()
+{
+	CryAutoLock<CryCriticalSectionNonRecursive> lock(m_writeLock);
+
+	if (!m_retiredVersions.empty())
+	{
+		TryAdvanceEpoch();
+	}
+}
+
+void CPlayerRegistry::Publish(TMap* pNewMap)
+{
+	const TMap* pOldMap = m_pCurrent.exchange(pNewMap);
+	m_retiredVersions.push_back(SRetiredVersion{ pOldMap, m_epoch.load() });
+
+	TryAdvanceEpoch();
+}
+
+void CPlayerRegistry::TryAdvanceEpoch()
+{
+	const uint32 currentEpoch = m_epoch.load();
+
+	// 上一个纪元的读者仍未全部离开，暂时无法推进
+	if (m_activeReaders[(currentEpoch + 1) & 1].load() != 0)
+		return;
+
+	// 上一个纪元及更早退役的版本已经没有读者能够看到
+	auto it = std::remove_if(m_retiredVersions.begin(), m_retiredVersions.end(), [currentEpoch](const SRetiredVersion& retiredVersion)
+	{
+		if (retiredVersion.epoch + 1 <= currentEpoch)
+		{
+			delete retiredVersion.pMap;
+			return true;
+		}
+		return false;
+	});
+	m_retiredVersions.erase(it, m_retiredVersions.end());
+
+	m_epoch.store(currentEpoch + 1);
+}
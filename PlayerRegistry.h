@@ -0,0 +1,81 @@
+#pragma once
+
+#include <CryEntitySystem/IEntityBasicTypes.h>
+#include <CryThreading/CryThread.h>
+
+#include <algorithm>
+#include <atomic>
+#include <unordered_map>
+#include <vector>
+
+// 频道id到玩家实体id的注册表，读多写少
+// 写入方(连接/断开/关卡卸载回调)复制当前版本并修改，然后原子地发布新版本
+// 读取方可在任意线程通过CReadScope无锁取得一致的快照，快照在CReadScope存在期间保持有效
+// 旧版本以两个纪元(epoch)的读者计数回收：某纪元的读者全部离开后，此前退役的版本即可释放
+class CPlayerRegistry
+{
+public:
+	using TMap = std::unordered_map<int, EntityId>;
+
+	// 读取作用域，持有期间快照不会被释放
+	// 不应跨帧持有，否则旧版本无法回收
+	class CReadScope
+	{
+	public:
+		explicit CReadScope(const CPlayerRegistry& registry);
+		~CReadScope();
+
+		CReadScope(const CReadScope&) = delete;
+		CReadScope& operator=(const CReadScope&) = delete;
+
+		const TMap& operator*() const { return *m_pMap; }
+		const TMap* operator->() const { return m_pMap; }
+
+	private:
+		const CPlayerRegistry& m_registry;
+		const TMap* m_pMap;
+		uint32 m_epoch;
+	};
+
+	CPlayerRegistry();
+	~CPlayerRegistry();
+
+	CPlayerRegistry(const CPlayerRegistry&) = delete;
+	CPlayerRegistry& operator=(const CPlayerRegistry&) = delete;
+
+	// 读取，任意线程
+	EntityId Find(int channelId) const;
+	size_t GetSize() const;
+	bool IsEmpty() const { return GetSize() == 0; }
+
+	// 写入，发布新版本
+	void Insert(int channelId, EntityId entityId);
+	bool Erase(int channelId);
+	void Clear();
+	// 批量写入，只复制与发布一次
+	void InsertRange(const std::vector<std::pair<int, EntityId>>& entries);
+	void EraseRange(const std::vector<int>& channelIds);
+
+	// 尝试释放已经没有读者的旧版本，写入后会自动调用，主线程每帧也应调用一次
+	void CollectGarbage();
+
+protected:
+	void Publish(TMap* pNewMap);
+	void TryAdvanceEpoch();
+
+protected:
+	struct SRetiredVersion
+	{
+		const TMap* pMap;
+		uint32 epoch;
+	};
+
+	std::atomic<const TMap*> m_pCurrent;
+	mutable std::atomic<uint32> m_epoch;
+	// 以纪元的奇偶性区分的活动读者计数
+	mutable std::atomic<uint32> m_activeReaders[2];
+
+	// 以下成员仅由写入方在m_writeLock下访问
+	CryCriticalSectionNonRecursive m_writeLock;
+	std::vector<SRetiredVersion> m_retiredVersions;
+};
@@ -0,0 +1,140 @@
+#include "StdAfx.h"
+#include "ReconnectCache.h"
+
+#include <CryEntitySystem/IEntitySystem.h>
+
+#include <cinttypes>
+#include <cstdlib>
+#include <random>
+
+uint64 CReconnectCache::GenerateSessionToken()
+{
+	static std::random_device s_randomDevice;
+
+	// 0保留为"无令牌"
+	uint64 sessionToken = 0;
+	while (sessionToken == 0)
+	{
+		sessionToken = (static_cast<uint64>(s_randomDevice()) << 32) | static_cast<uint64>(s_randomDevice());
+	}
+
+	return sessionToken;
+}
+
+string CReconnectCache::AppendNicknameToken(const char* szNickname, uint64 sessionToken)
+{
+	string nickname;
+	ParseNicknameToken(szNickname, nickname);
+
+	if (sessionToken != 0)
+	{
+		nickname.append(string().Format("%s%016" PRIx64, NicknameTokenSeparator, sessionToken));
+	}
+
+	return nickname;
+}
+
+uint64 CReconnectCache::ParseNicknameToken(const char* szNickname, string& baseNickname)
+{
+	baseNickname = szNickname != nullptr ? szNickname : "";
+
+	// 后缀总是位于昵称末尾，长度固定
+	const size_t suffixLength = strlen(NicknameTokenSeparator) + NicknameTokenDigits;
+	if (baseNickname.length() < suffixLength)
+	{
+		return 0;
+	}
+
+	const size_t separatorPos = baseNickname.length() - suffixLength;
+	if (strncmp(baseNickname.c_str() + separatorPos, NicknameTokenSeparator, strlen(NicknameTokenSeparator)) != 0)
+	{
+		return 0;
+	}
+
+	const char* szDigits = baseNickname.c_str() + separatorPos + strlen(NicknameTokenSeparator);
+	char* szDigitsEnd = nullptr;
+	const uint64 sessionToken = static_cast<uint64>(strtoull(szDigits, &szDigitsEnd, 16));
+	if (szDigitsEnd != szDigits + NicknameTokenDigits)
+	{
+		return 0;
+	}
+
+	baseNickname.erase(separatorPos);
+	return sessionToken;
+}
+
+uint64 CReconnectCache::IssueSessionToken(int channelId)
+{
+	const uint64 sessionToken = GenerateSessionToken();
+	m_channelTokens[channelId] = sessionToken;
+	return sessionToken;
+}
+
+uint64 CReconnectCache::GetSessionToken(int channelId) const
+{
+	auto it = m_channelTokens.find(channelId);
+	return it != m_channelTokens.end() ? it->second : 0;
+}
+
+uint64 CReconnectCache::OnChannelDisconnected(int channelId)
+{
+	auto it = m_channelTokens.find(channelId);
+	if (it == m_channelTokens.end())
+	{
+		return 0;
+	}
+
+	const uint64 sessionToken = it->second;
+	m_channelTokens.erase(it);
+	return sessionToken;
+}
+
+void CReconnectCache::StoreDormant(uint64 sessionToken, EntityId entityId, float gracePeriod)
+{
+	auto it = m_dormantPlayers.find(sessionToken);
+	if (it != m_dormantPlayers.end())
+	{
+		m_timers.Cancel(it->second.timerId);
+	}
+
+	const CTimingWheel::TimerId timerId = m_timers.Schedule(gracePeriod, [this, sessionToken]() { OnDormantExpired(sessionToken); });
+	m_dormantPlayers[sessionToken] = SDormantPlayer{ entityId, timerId };
+}
+
+EntityId CReconnectCache::TakeDormant(uint64 sessionToken)
+{
+	auto it = m_dormantPlayers.find(sessionToken);
+	if (it == m_dormantPlayers.end())
+	{
+		return INVALID_ENTITYID;
+	}
+
+	const EntityId entityId = it->second.entityId;
+	m_timers.Cancel(it->second.timerId);
+	m_dormantPlayers.erase(it);
+	return entityId;
+}
+
+void CReconnectCache::OnDormantExpired(uint64 sessionToken)
+{
+	auto it = m_dormantPlayers.find(sessionToken);
+	if (it == m_dormantPlayers.end())
+	{
+		return;
+	}
+
+	const EntityId entityId = it->second.entityId;
+	m_dormantPlayers.erase(it);
+	gEnv->pEntitySystem->RemoveEntity(entityId);
+}
+
+void CReconnectCache::Clear()
+{
+	for (const std::pair<const uint64, SDormantPlayer>& dormantPair : m_dormantPlayers)
+	{
+		m_timers.Cancel(dormantPair.second.timerId);
+	}
+
+	m_dormantPlayers.clear();
+	m_channelTokens.clear();
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <CryEntitySystem/IEntityBasicTypes.h>
+
+#include <CryString/CryString.h>
+
+#include "TimingWheel.h"
+
+#include <unordered_map>
+
+// 断线重连缓存
+// 客户端短暂断线后，其玩家实体以休眠状态保留一段宽限期
+// 会话令牌(session token)是服务器随机生成的64位值，只发给拥有该玩家的客户端
+// 客户端把令牌作为昵称后缀随连接请求出示，服务器在生成任何实体之前剥离后缀，令牌匹配时把新频道直接绑定到休眠实体
+// 宽限期由插件的时间轮计时，到期时移除休眠实体
+class CReconnectCache
+{
+public:
+	explicit CReconnectCache(CTimingWheel& timers) : m_timers(timers) {}
+
+	// 随机的非0令牌，无法从昵称等公开信息推算
+	static uint64 GenerateSessionToken();
+
+	// 客户端：把令牌附加到昵称(替换已有的令牌后缀)，sessionToken为0时只移除后缀
+	static string AppendNicknameToken(const char* szNickname, uint64 sessionToken);
+	// 服务器：从连接昵称中解析令牌，baseNickname为去掉后缀的昵称，没有有效后缀时返回0
+	static uint64 ParseNicknameToken(const char* szNickname, string& baseNickname);
+
+	// 为准备好游戏的频道生成新的会话令牌并记录，调用方只把它发给该频道
+	uint64 IssueSessionToken(int channelId);
+	// 频道当前的会话令牌，没有时返回0
+	uint64 GetSessionToken(int channelId) const;
+	// 客户端断开连接时调用，移除频道记录并返回其会话令牌(没有时返回0)
+	uint64 OnChannelDisconnected(int channelId);
+
+	// 以会话令牌存入休眠实体，gracePeriod秒后过期
+	void StoreDormant(uint64 sessionToken, EntityId entityId, float gracePeriod);
+	// 取出并移除会话令牌对应的休眠实体，不存在时返回INVALID_ENTITYID
+	EntityId TakeDormant(uint64 sessionToken);
+
+	// 清空所有记录，用于关卡卸载(实体随关卡一起销毁)
+	void Clear();
+
+	bool HasDormant() const { return !m_dormantPlayers.empty(); }
+
+protected:
+	// 昵称中令牌后缀的分隔符，其后为16位十六进制令牌
+	static constexpr const char* NicknameTokenSeparator = "#rc:";
+	static constexpr size_t NicknameTokenDigits = 16;
+
+	// 休眠中的玩家实体
+	struct SDormantPlayer
+	{
+		EntityId entityId;
+		CTimingWheel::TimerId timerId;
+	};
+
+	void OnDormantExpired(uint64 sessionToken);
+
+	CTimingWheel& m_timers;
+
+	// <会话令牌, 休眠玩家>
+	std::unordered_map<uint64, SDormantPlayer> m_dormantPlayers;
+	// <频道id, 会话令牌>
+	std::unordered_map<int, uint64> m_channelTokens;
+};
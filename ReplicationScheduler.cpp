@@ -0,0 +1,181 @@
+#include "StdAfx.h"
+#include "ReplicationScheduler.h"
+#include "GameCVars.h"
+
+#include <algorithm>
+
+void CReplicationScheduler::AddClient(int channelId, EntityId viewerEntityId)
+{
+	for (SClient& client : m_clients)
+	{
+		if (client.channelId == channelId)
+		{
+			client.viewerEntityId = viewerEntityId;
+			return;
+		}
+	}
+
+	m_clients.push_back(SClient{ channelId, viewerEntityId, ZERO, 0.f });
+}
+
+void CReplicationScheduler::RemoveClient(int channelId)
+{
+	auto it = std::find_if(m_clients.begin(), m_clients.end(), [channelId](const SClient& client) { return client.channelId == channelId; });
+	if (it != m_clients.end())
+	{
+		*it = m_clients.back();
+		m_clients.pop_back();
+	}
+}
+
+void CReplicationScheduler::Clear()
+{
+	m_clients.clear();
+	m_aspects.clear();
+	m_aspectLookup.clear();
+	m_pendingCount = 0;
+}
+
+void CReplicationScheduler::RequestReplication(EntityId entityId, NetworkAspectType aspect, const SAspectDesc& desc)
+{
+	auto result = m_aspectLookup.emplace(MakeKey(entityId, aspect), m_aspects.size());
+	if (result.second)
+	{
+		// 从未刷新过的方面不受最短间隔限制
+		m_aspects.push_back(SAspectState{ entityId, aspect, desc, 0.f, m_time - desc.minInterval, true });
+		++m_pendingCount;
+		return;
+	}
+
+	SAspectState& state = m_aspects[result.first->second];
+	state.desc = desc;
+	if (!state.bPending)
+	{
+		state.bPending = true;
+		++m_pendingCount;
+	}
+}
+
+void CReplicationScheduler::Update(float frameTime, const SGameCVars& cvars, const std::function<void(EntityId entityId, NetworkAspectType aspect)>& func)
+{
+	m_time += frameTime;
+	m_lastFlushCount = 0;
+	m_lastFlushBytes = 0;
+
+	// 补充各客户端的预算，最多积攒一秒
+	const float budgetPerSecond = static_cast<float>(max(cvars.g_replicationBudget, 0));
+	float availableBudget = FLT_MAX;
+	for (SClient& client : m_clients)
+	{
+		client.budget = min(client.budget + budgetPerSecond * frameTime, budgetPerSecond);
+
+		const IEntity* pViewerEntity = gEnv->pEntitySystem->GetEntity(client.viewerEntityId);
+		client.viewerPosition = pViewerEntity != nullptr ? pViewerEntity->GetWorldPos() : Vec3(ZERO);
+
+		// 刷新的方面计入所有客户端，可用预算取决于余额最少的客户端
+		availableBudget = min(availableBudget, client.budget);
+	}
+
+	if (m_pendingCount == 0)
+		return;
+
+	// 没有远程客户端或调度被禁用时不限制预算与优先级
+	const bool bUnlimited = cvars.g_replicationScheduler == 0 || m_clients.empty();
+
+	// 累积优先级并收集已到发送时间的方面，实体已被删除的方面直接移除
+	m_candidates.clear();
+	for (size_t i = 0; i < m_aspects.size();)
+	{
+		SAspectState& state = m_aspects[i];
+		const IEntity* pEntity = gEnv->pEntitySystem->GetEntity(state.entityId);
+		if (pEntity == nullptr)
+		{
+			if (state.bPending)
+			{
+				--m_pendingCount;
+			}
+
+			m_aspectLookup.erase(MakeKey(state.entityId, state.aspect));
+			if (i != m_aspects.size() - 1)
+			{
+				state = m_aspects.back();
+				m_aspectLookup[MakeKey(state.entityId, state.aspect)] = i;
+			}
+			m_aspects.pop_back();
+			continue;
+		}
+
+		if (state.bPending)
+		{
+			if (!bUnlimited)
+			{
+				state.priority += state.desc.importance * ComputeDistanceWeight(pEntity->GetWorldPos(), cvars) * frameTime;
+			}
+
+			if (bUnlimited || m_time - state.lastFlushTime >= state.desc.minInterval)
+			{
+				m_candidates.push_back(i);
+			}
+		}
+
+		++i;
+	}
+
+	// 按优先级从高到低填充预算，放不下的方面跳过，让更小的方面继续使用剩余预算
+	if (!bUnlimited)
+	{
+		std::sort(m_candidates.begin(), m_candidates.end(), [this](size_t a, size_t b) { return m_aspects[a].priority > m_aspects[b].priority; });
+	}
+
+	float spentBudget = 0.f;
+	for (const size_t index : m_candidates)
+	{
+		SAspectState& state = m_aspects[index];
+
+		if (!bUnlimited)
+		{
+			// 超过一秒预算的方面按一秒预算计费，否则永远无法发送
+			const float cost = min(static_cast<float>(state.desc.estimatedBytes), budgetPerSecond);
+			if (cost > availableBudget)
+				continue;
+
+			availableBudget -= cost;
+			spentBudget += cost;
+		}
+
+		func(state.entityId, state.aspect);
+
+		state.bPending = false;
+		state.priority = 0.f;
+		state.lastFlushTime = m_time;
+		--m_pendingCount;
+
+		++m_lastFlushCount;
+		m_lastFlushBytes += state.desc.estimatedBytes;
+	}
+
+	for (SClient& client : m_clients)
+	{
+		client.budget -= spentBudget;
+	}
+}
+
+float CReplicationScheduler::GetNearestClientDistance(const Vec3& position) const
+{
+	if (m_clients.empty())
+		return 0.f;
+
+	float minDistanceSquared = FLT_MAX;
+	for (const SClient& client : m_clients)
+	{
+		minDistanceSquared = min(minDistanceSquared, position.GetSquaredDistance(client.viewerPosition));
+	}
+
+	return sqrt_tpl(minDistanceSquared);
+}
+
+float CReplicationScheduler::ComputeDistanceWeight(const Vec3& position, const SGameCVars& cvars) const
+{
+	const float distanceScale = max(cvars.g_replicationDistanceScale, 0.01f);
+	return 1.f / (1.f + GetNearestClientDistance(position) / distanceScale);
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <CryNetwork/INetwork.h>
+
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+struct SGameCVars;
+
+// 带宽预算的复制调度器
+// 实体不直接调用NetMarkAspectsDirty，而是请求复制；每个待复制的(实体, 方面)持有一个优先级累加器，
+// 每帧按到各客户端玩家的距离与方面的重要性增长，未发送的优先级保留到下一帧
+// 每帧为每个客户端补充字节预算，按优先级从高到低刷新所有客户端都负担得起的方面
+// 引擎的脏标记对所有频道同时生效，因此每个刷新的方面会计入所有客户端的预算
+class CReplicationScheduler
+{
+public:
+	// 方面的复制参数
+	struct SAspectDesc
+	{
+		// 重要性，优先级累加的速率
+		float importance;
+		// 预计的序列化大小(字节)
+		uint32 estimatedBytes;
+		// 两次刷新之间的最短间隔(秒)，0为每帧都可以发送
+		float minInterval;
+	};
+
+	// 一个客户端的预算账户，viewerEntityId为其玩家实体，用于计算距离
+	void AddClient(int channelId, EntityId viewerEntityId);
+	void RemoveClient(int channelId);
+	void Clear();
+
+	// 请求复制实体的方面，已在等待中的请求只会更新其参数，不重复计费
+	void RequestReplication(EntityId entityId, NetworkAspectType aspect, const SAspectDesc& desc);
+
+	// 每帧调用，累积优先级并在预算内调用func刷新(通常为标记方面为脏)
+	// 距上次刷新不足minInterval的方面继续等待
+	void Update(float frameTime, const SGameCVars& cvars, const std::function<void(EntityId entityId, NetworkAspectType aspect)>& func);
+
+	// 到最近的远程客户端玩家的距离，没有客户端时返回0
+	float GetNearestClientDistance(const Vec3& position) const;
+
+	size_t GetClientCount() const { return m_clients.size(); }
+	size_t GetPendingCount() const { return m_pendingCount; }
+	// 上一帧刷新的方面数量与字节数
+	size_t GetLastFlushCount() const { return m_lastFlushCount; }
+	uint32 GetLastFlushBytes() const { return m_lastFlushBytes; }
+
+protected:
+	static uint64 MakeKey(EntityId entityId, NetworkAspectType aspect) { return (static_cast<uint64>(entityId) << 32) | static_cast<uint32>(aspect); }
+
+	// 到最近客户端玩家的距离权重，近处为1，随距离衰减
+	float ComputeDistanceWeight(const Vec3& position, const SGameCVars& cvars) const;
+
+protected:
+	struct SClient
+	{
+		int channelId;
+		EntityId viewerEntityId;
+		Vec3 viewerPosition;
+		// 可用字节数，未用完的部分保留到下一帧(最多一秒的预算)
+		float budget;
+	};
+
+	// 每个复制过的(实体, 方面)，刷新后保留以记录刷新时间，实体删除后移除
+	struct SAspectState
+	{
+		EntityId entityId;
+		NetworkAspectType aspect;
+		SAspectDesc desc;
+		// 累积的优先级，刷新后清零
+		float priority;
+		double lastFlushTime;
+		bool bPending;
+	};
+
+	std::vector<SClient> m_clients;
+	std::vector<SAspectState> m_aspects;
+	// (实体, 方面) -> m_aspects中的索引
+	std::unordered_map<uint64, size_t> m_aspectLookup;
+	size_t m_pendingCount = 0;
+
+	// 调度器的时钟(秒)，以double累加：float在长时间运行后精度不足以累加帧时间，时钟会变快直至停止
+	double m_time = 0.0;
+
+	// Update每帧复用的缓冲
+	std::vector<size_t> m_candidates;
+
+	size_t m_lastFlushCount = 0;
+	uint32 m_lastFlushBytes = 0;
+};
@@ -0,0 +1,62 @@
+#include "StdAfx.h"
+#include "SimulationLod.h"
+#include "GameCVars.h"
+
+#include <algorithm>
+
+void CSimulationLod::BuildObserverGrid(const SGameCVars& cvars)
+{
+	// 单元边长不小于最远的距离带，该距离内的观察者一定位于所在单元或相邻单元
+	const float cellSize = max(max(cvars.g_simulationLodDistance1, cvars.g_simulationLodDistance2), max(cvars.g_simulationLodDistance3, 1.f));
+	m_invCellSize = 1.f / cellSize;
+
+	m_cellObservers.clear();
+	for (const Vec3& observer : m_observers)
+	{
+		const int cellX = static_cast<int>(floor_tpl(observer.x * m_invCellSize));
+		const int cellY = static_cast<int>(floor_tpl(observer.y * m_invCellSize));
+		m_cellObservers.push_back(SCellObserver{ GetCellKey(cellX, cellY), observer });
+	}
+
+	std::sort(m_cellObservers.begin(), m_cellObservers.end(), [](const SCellObserver& a, const SCellObserver& b) { return a.cellKey < b.cellKey; });
+}
+
+uint8 CSimulationLod::ComputeInterval(const Vec3& position, const SGameCVars& cvars) const
+{
+	if (cvars.g_simulationLod == 0 || m_observers.empty())
+		return 1;
+
+	const int cellX = static_cast<int>(floor_tpl(position.x * m_invCellSize));
+	const int cellY = static_cast<int>(floor_tpl(position.y * m_invCellSize));
+
+	// 相邻单元中都没有观察者时距离超过所有距离带
+	float minDistanceSquared = FLT_MAX;
+	for (int offsetY = -1; offsetY <= 1; ++offsetY)
+	{
+		for (int offsetX = -1; offsetX <= 1; ++offsetX)
+		{
+			const uint64 cellKey = GetCellKey(cellX + offsetX, cellY + offsetY);
+			auto it = std::lower_bound(m_cellObservers.begin(), m_cellObservers.end(), cellKey, [](const SCellObserver& cellObserver, uint64 key) { return cellObserver.cellKey < key; });
+
+			for (; it != m_cellObservers.end() && it->cellKey == cellKey; ++it)
+			{
+				const float dx = position.x - it->position.x;
+				const float dy = position.y - it->position.y;
+				minDistanceSquared = min(minDistanceSquared, dx * dx + dy * dy);
+			}
+		}
+	}
+
+	// 距离带依次对应2、4、8帧的间隔
+	const float bandDistances[] = { cvars.g_simulationLodDistance1, cvars.g_simulationLodDistance2, cvars.g_simulationLodDistance3 };
+	uint8 interval = 1;
+	for (const float bandDistance : bandDistances)
+	{
+		if (minDistanceSquared < bandDistance * bandDistance)
+			break;
+
+		interval <<= 1;
+	}
+
+	return interval;
+}
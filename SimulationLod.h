@@ -0,0 +1,48 @@
+#pragma once
+
+#include <vector>
+
+struct SGameCVars;
+
+// 模拟细节层次(LOD)
+// 根据到最近观察者的距离，为每个玩家选择积分间隔：近处每帧模拟，远处每2、4、8帧模拟一次并以累积的时间积分
+// 客户端上观察者为本地相机，服务器上观察者为所有真实玩家(不含机器人)
+class CSimulationLod
+{
+public:
+	// 支持的最大积分间隔(帧)
+	static constexpr uint8 MaxInterval = 8;
+
+	void ClearObservers() { m_observers.clear(); m_cellObservers.clear(); }
+	void AddObserver(const Vec3& position) { m_observers.push_back(position); }
+	size_t GetObserverCount() const { return m_observers.size(); }
+	// 添加完观察者后调用，以最远的距离带为边长把观察者放入网格
+	void BuildObserverGrid(const SGameCVars& cvars);
+
+	// 根据到最近观察者的水平距离选择积分间隔(1、2、4或8)
+	// 只检查所在单元与相邻的8个单元，超出最远距离带的观察者不影响结果，每次查询与观察者总数无关
+	// 没有观察者或LOD被禁用时总是返回1
+	uint8 ComputeInterval(const Vec3& position, const SGameCVars& cvars) const;
+
+	// 间隔为interval的实体在frameId帧是否需要模拟
+	// 以实体id错开相位，使同一距离带的玩家分散在不同帧上模拟
+	static bool IsDue(uint8 interval, EntityId entityId, int frameId)
+	{
+		return ((static_cast<uint32>(frameId) + entityId) & (interval - 1)) == 0;
+	}
+
+protected:
+	uint64 GetCellKey(int cellX, int cellY) const { return (static_cast<uint64>(static_cast<uint32>(cellX)) << 32) | static_cast<uint32>(cellY); }
+
+protected:
+	struct SCellObserver
+	{
+		uint64 cellKey;
+		Vec3 position;
+	};
+
+	std::vector<Vec3> m_observers;
+	// 按单元排序的观察者，同一单元的观察者连续存放
+	std::vector<SCellObserver> m_cellObservers;
+	float m_invCellSize = 1.f;
+};
@@ -0,0 +1,53 @@
+#include "StdAfx.h"
+#include "SnapshotCache.h"
+
+void CSnapshotCache::Build(const std::vector<SEntry>& entries)
+{
+	const CTimeValue startTime = gEnv->pTimer->GetAsyncTime();
+
+	m_frameId = gEnv->nMainFrameID;
+
+	m_entityIds.resize(entries.size());
+	m_transforms.resize(entries.size());
+	for (size_t i = 0; i < entries.size(); ++i)
+	{
+		m_entityIds[i] = entries[i].entityId;
+		m_transforms[i] = entries[i].transform;
+	}
+
+	for (size_t profile = 0; profile < ProfileCount; ++profile)
+	{
+		const CTransformCodec& codec = CNetPrecision::GetCodec(static_cast<CNetPrecision::EProfile>(profile));
+		m_strides[profile] = codec.GetEncodedSize(1);
+		m_encoded[profile].resize(m_transforms.size() * m_strides[profile]);
+
+		codec.EncodeEach(m_transforms.data(), m_transforms.size(), m_encoded[profile].data());
+	}
+
+	m_lastBuildMilliseconds = (gEnv->pTimer->GetAsyncTime() - startTime).GetMilliSeconds();
+}
+
+bool CSnapshotCache::Get(uint32 slot, EntityId entityId, uint8 profile, SEncoded& encoded) const
+{
+	if (m_frameId != gEnv->nMainFrameID || slot >= m_entityIds.size() || m_entityIds[slot] != entityId || profile >= ProfileCount)
+		return false;
+
+	const size_t stride = m_strides[profile];
+	if (stride > MaxEncodedBytes)
+		return false;
+
+	memcpy(encoded.data, m_encoded[profile].data() + slot * stride, stride);
+	encoded.size = static_cast<uint8>(stride);
+	return true;
+}
+
+void CSnapshotCache::Clear()
+{
+	m_frameId = -1;
+	m_entityIds.clear();
+	m_transforms.clear();
+	for (std::vector<uint8>& encoded : m_encoded)
+	{
+		encoded.clear();
+	}
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <vector>
+
+#include "NetPrecision.h"
+
+// 每帧批量编码的移动快照
+// 主更新在复制调度之后，以每个精度档位的编解码器把所有玩家的变换批量编码一次(SIMD量化)，
+// 每个玩家占用一个定长、按字节对齐的槽位，所有频道的网络序列化只复制该槽位的字节
+// 网络同步在主线程上、主更新之后读取，读取时快照不会被重建，不需要加锁
+class CSnapshotCache
+{
+public:
+	// 单个变换编码后的最大字节数
+	static constexpr size_t MaxEncodedBytes = 32;
+	static constexpr uint32 InvalidSlot = ~0u;
+
+	struct SEncoded
+	{
+		uint8 data[MaxEncodedBytes];
+		uint8 size = 0;
+	};
+
+	struct SEntry
+	{
+		EntityId entityId;
+		QuatT transform;
+	};
+
+	// 编码本帧的所有玩家，entries中的下标即玩家的槽位
+	void Build(const std::vector<SEntry>& entries);
+	// 复制本帧槽位在profile档位下的编码，槽位不属于entityId或快照不是本帧的(如本帧编码之后生成的玩家)时返回false
+	bool Get(uint32 slot, EntityId entityId, uint8 profile, SEncoded& encoded) const;
+	void Clear();
+
+	// 上一次编码的玩家数与耗时
+	size_t GetSlotCount() const { return m_entityIds.size(); }
+	float GetLastBuildMilliseconds() const { return m_lastBuildMilliseconds; }
+
+protected:
+	static constexpr size_t ProfileCount = static_cast<size_t>(CNetPrecision::EProfile::Coarse) + 1;
+
+	int m_frameId = -1;
+	std::vector<EntityId> m_entityIds;
+	std::vector<QuatT> m_transforms;
+	// 每个档位的编码，槽位i位于[i * stride, (i + 1) * stride)
+	std::vector<uint8> m_encoded[ProfileCount];
+	size_t m_strides[ProfileCount] = {};
+
+	float m_lastBuildMilliseconds = 0.f;
+};
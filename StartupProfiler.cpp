@@ -0,0 +1,71 @@
+#include "StdAfx.h"
+#include "StartupProfiler.h"
+
+namespace
+{
+	const char* const s_phaseNames[] =
+	{
+		"plugin load",
+		"schematyc registration",
+		"game post init",
+		"level preload",
+		"level load",
+		"first tick"
+	};
+
+	static_assert(CRY_ARRAY_COUNT(s_phaseNames) == static_cast<size_t>(CStartupProfiler::EPhase::Count), "Missing startup phase name");
+}
+
+void CStartupProfiler::BeginPhase(EPhase phase)
+{
+	SPhase& phaseTiming = m_phases[static_cast<size_t>(phase)];
+
+	// 每个阶段只记录第一次(后续换图不计入冷启动)
+	if (phaseTiming.bBegun)
+		return;
+
+	phaseTiming.beginTime = gEnv->pTimer->GetAsyncTime();
+	phaseTiming.bBegun = true;
+
+	if (!m_bHasOrigin)
+	{
+		m_originTime = phaseTiming.beginTime;
+		m_bHasOrigin = true;
+	}
+}
+
+void CStartupProfiler::EndPhase(EPhase phase)
+{
+	SPhase& phaseTiming = m_phases[static_cast<size_t>(phase)];
+	if (!phaseTiming.bBegun || phaseTiming.bEnded)
+		return;
+
+	phaseTiming.endTime = gEnv->pTimer->GetAsyncTime();
+	phaseTiming.bEnded = true;
+}
+
+void CStartupProfiler::LogReport() const
+{
+	CryLogAlways("[Startup] Timing report (relative to plugin load):");
+
+	for (size_t i = 0; i < static_cast<size_t>(EPhase::Count); ++i)
+	{
+		const SPhase& phaseTiming = m_phases[i];
+		if (!phaseTiming.bBegun)
+		{
+			CryLogAlways("[Startup]   %-24s not reached", s_phaseNames[i]);
+			continue;
+		}
+
+		const float startMs = (phaseTiming.beginTime - m_originTime).GetMilliSeconds();
+		if (!phaseTiming.bEnded)
+		{
+			CryLogAlways("[Startup]   %-24s started at +%.1f ms, not finished", s_phaseNames[i], startMs);
+			continue;
+		}
+
+		const float durationMs = (phaseTiming.endTime - phaseTiming.beginTime).GetMilliSeconds();
+		const float endMs = (phaseTiming.endTime - m_originTime).GetMilliSeconds();
+		CryLogAlways("[Startup]   %-24s %9.1f ms  (+%.1f .. +%.1f ms)", s_phaseNames[i], durationMs, startMs, endMs);
+	}
+}
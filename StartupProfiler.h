@@ -0,0 +1,40 @@
+#pragma once
+
+// 启动阶段计时
+// 记录插件加载、Schematyc注册、关卡预加载、关卡加载与首帧的耗时，用于追踪服务器冷启动时间
+class CStartupProfiler
+{
+public:
+	enum class EPhase : uint8
+	{
+		PluginLoad = 0,
+		SchematycRegistration,
+		GamePostInit,
+		LevelPreload,
+		LevelLoad,
+		FirstTick,
+
+		Count
+	};
+
+	void BeginPhase(EPhase phase);
+	void EndPhase(EPhase phase);
+
+	bool HasEnded(EPhase phase) const { return m_phases[static_cast<size_t>(phase)].bEnded; }
+
+	// 输出各阶段的耗时与相对插件加载开始的时间点
+	void LogReport() const;
+
+protected:
+	struct SPhase
+	{
+		CTimeValue beginTime;
+		CTimeValue endTime;
+		bool bBegun = false;
+		bool bEnded = false;
+	};
+
+	SPhase m_phases[static_cast<size_t>(EPhase::Count)];
+	CTimeValue m_originTime;
+	bool m_bHasOrigin = false;
+};
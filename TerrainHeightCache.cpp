@@ -0,0 +1,210 @@
+#include "StdAfx.h"
+#include "TerrainHeightCache.h"
+
+#if CRY_PLATFORM_SSE2
+	#include <emmintrin.h>
+#endif
+
+void CTerrainHeightCache::Build(float sampleSpacing)
+{
+	I3DEngine* p3DEngine = gEnv->p3DEngine;
+	const float terrainSize = static_cast<float>(p3DEngine->GetTerrainSize());
+
+	// 采样间距不小于高度图的单位尺寸，更密的采样不会得到更多信息
+	sampleSpacing = max(sampleSpacing, p3DEngine->GetHeightMapUnitSize());
+
+	Build(terrainSize, sampleSpacing, [p3DEngine](float x, float y)
+	{
+		return p3DEngine->GetTerrainZ(x, y);
+	});
+}
+
+void CTerrainHeightCache::Build(float terrainSize, float sampleSpacing, const std::function<float(float x, float y)>& heightFunc)
+{
+	Clear();
+
+	if (terrainSize <= 0.f || sampleSpacing <= 0.f)
+		return;
+
+	m_sampleSpacing = sampleSpacing;
+	m_invSampleSpacing = 1.f / sampleSpacing;
+	m_sampleSpacingFixed = max(static_cast<int32>(floor(static_cast<double>(sampleSpacing) * (1 << FixedShift) + 0.5)), 1);
+	m_cellsPerAxis = max(static_cast<int>(terrainSize * m_invSampleSpacing), 1);
+	m_tilesPerAxis = (m_cellsPerAxis + TileCells - 1) / TileCells;
+	m_tiles.resize(m_tilesPerAxis * m_tilesPerAxis);
+
+	float heights[TileSamples * TileSamples];
+
+	for (int tileY = 0; tileY < m_tilesPerAxis; ++tileY)
+	{
+		for (int tileX = 0; tileX < m_tilesPerAxis; ++tileX)
+		{
+			float minHeight = FLT_MAX;
+			float maxHeight = -FLT_MAX;
+
+			for (int sampleY = 0; sampleY < TileSamples; ++sampleY)
+			{
+				for (int sampleX = 0; sampleX < TileSamples; ++sampleX)
+				{
+					// 超出地形的样本沿用边缘高度
+					const int cellX = min(tileX * TileCells + sampleX, m_cellsPerAxis);
+					const int cellY = min(tileY * TileCells + sampleY, m_cellsPerAxis);
+
+					const float height = heightFunc(cellX * sampleSpacing, cellY * sampleSpacing);
+					heights[sampleY * TileSamples + sampleX] = height;
+
+					minHeight = min(minHeight, height);
+					maxHeight = max(maxHeight, height);
+				}
+			}
+
+			STile& tile = m_tiles[tileY * m_tilesPerAxis + tileX];
+			tile.minHeight = minHeight;
+			tile.heightScale = (maxHeight - minHeight) / 65535.f;
+			tile.minHeightFixed = static_cast<int32>(floor(static_cast<double>(minHeight) * (1 << FixedShift) + 0.5));
+			tile.heightScaleFixed = static_cast<int64>(floor(static_cast<double>(tile.heightScale) * 4294967296.0 + 0.5));
+
+			const float quantizeScale = tile.heightScale > 0.f ? 1.f / tile.heightScale : 0.f;
+			for (int i = 0; i < TileSamples * TileSamples; ++i)
+			{
+				tile.samples[i] = static_cast<uint16>((heights[i] - minHeight) * quantizeScale + 0.5f);
+			}
+		}
+	}
+}
+
+void CTerrainHeightCache::Clear()
+{
+	m_tiles.clear();
+	m_tiles.shrink_to_fit();
+	m_tilesPerAxis = 0;
+	m_cellsPerAxis = 0;
+}
+
+size_t CTerrainHeightCache::GetMemoryUsage() const
+{
+	return m_tiles.capacity() * sizeof(STile);
+}
+
+float CTerrainHeightCache::GetHeight(float x, float y) const
+{
+	float height;
+	GetHeights(&x, &y, &height, 1);
+	return height;
+}
+
+float CTerrainHeightCache::SampleCell(int cellX, int cellY, float fracX, float fracY) const
+{
+	// 格子在块内的坐标不超过TileCells - 1，右侧与上方的样本仍在同一块内
+	const int tileX = min(cellX / TileCells, m_tilesPerAxis - 1);
+	const int tileY = min(cellY / TileCells, m_tilesPerAxis - 1);
+	const int localX = cellX - tileX * TileCells;
+	const int localY = cellY - tileY * TileCells;
+
+	const STile& tile = m_tiles[tileY * m_tilesPerAxis + tileX];
+	const uint16* pRow0 = &tile.samples[localY * TileSamples + localX];
+	const uint16* pRow1 = pRow0 + TileSamples;
+
+	const float bottom = pRow0[0] + (pRow0[1] - static_cast<float>(pRow0[0])) * fracX;
+	const float top = pRow1[0] + (pRow1[1] - static_cast<float>(pRow1[0])) * fracX;
+
+	return tile.minHeight + (bottom + (top - bottom) * fracY) * tile.heightScale;
+}
+
+void CTerrainHeightCache::GetHeights(const float* pX, const float* pY, float* pOutHeights, size_t count) const
+{
+	if (!IsValid())
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			pOutHeights[i] = 0.f;
+		}
+		return;
+	}
+
+	const float maxCell = static_cast<float>(m_cellsPerAxis) - 0.0001f;
+	size_t i = 0;
+
+#if CRY_PLATFORM_SSE2
+	// 每次四个位置：在SIMD中完成坐标变换、限制范围与拆分整数/小数部分，然后逐个取样本
+	const __m128 invSpacing = _mm_set1_ps(m_invSampleSpacing);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 maxCellVec = _mm_set1_ps(maxCell);
+
+	alignas(16) int32 cellX[4];
+	alignas(16) int32 cellY[4];
+	alignas(16) float fracX[4];
+	alignas(16) float fracY[4];
+
+	for (; i + 4 <= count; i += 4)
+	{
+		const __m128 gridX = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(pX + i), invSpacing), zero), maxCellVec);
+		const __m128 gridY = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(pY + i), invSpacing), zero), maxCellVec);
+
+		// 坐标非负，截断即向下取整
+		const __m128i cellXVec = _mm_cvttps_epi32(gridX);
+		const __m128i cellYVec = _mm_cvttps_epi32(gridY);
+
+		_mm_store_si128(reinterpret_cast<__m128i*>(cellX), cellXVec);
+		_mm_store_si128(reinterpret_cast<__m128i*>(cellY), cellYVec);
+		_mm_store_ps(fracX, _mm_sub_ps(gridX, _mm_cvtepi32_ps(cellXVec)));
+		_mm_store_ps(fracY, _mm_sub_ps(gridY, _mm_cvtepi32_ps(cellYVec)));
+
+		for (int lane = 0; lane < 4; ++lane)
+		{
+			pOutHeights[i + lane] = SampleCell(cellX[lane], cellY[lane], fracX[lane], fracY[lane]);
+		}
+	}
+#endif
+
+	for (; i < count; ++i)
+	{
+		const float gridX = clamp_tpl(pX[i] * m_invSampleSpacing, 0.f, maxCell);
+		const float gridY = clamp_tpl(pY[i] * m_invSampleSpacing, 0.f, maxCell);
+		const int cellX = static_cast<int>(gridX);
+		const int cellY = static_cast<int>(gridY);
+
+		pOutHeights[i] = SampleCell(cellX, cellY, gridX - cellX, gridY - cellY);
+	}
+}
+
+int32 CTerrainHeightCache::GetHeightFixed(int32 x, int32 y) const
+{
+	if (!IsValid())
+		return 0;
+
+	// 与GetHeights相同地限制在地形范围内，最后一个格子的右侧与上方样本仍然存在
+	const int64 spacing = m_sampleSpacingFixed;
+	const int64 maxGrid = static_cast<int64>(m_cellsPerAxis) * spacing - 1;
+	const int64 gridX = clamp_tpl(static_cast<int64>(x), int64(0), maxGrid);
+	const int64 gridY = clamp_tpl(static_cast<int64>(y), int64(0), maxGrid);
+
+	const int cellX = static_cast<int>(gridX / spacing);
+	const int cellY = static_cast<int>(gridY / spacing);
+	const int64 fracX = ((gridX - cellX * spacing) << FixedShift) / spacing;
+	const int64 fracY = ((gridY - cellY * spacing) << FixedShift) / spacing;
+
+	const int tileX = min(cellX / TileCells, m_tilesPerAxis - 1);
+	const int tileY = min(cellY / TileCells, m_tilesPerAxis - 1);
+	const int localX = cellX - tileX * TileCells;
+	const int localY = cellY - tileY * TileCells;
+
+	const STile& tile = m_tiles[tileY * m_tilesPerAxis + tileX];
+	const uint16* pRow0 = &tile.samples[localY * TileSamples + localX];
+	const uint16* pRow1 = pRow0 + TileSamples;
+
+	// 样本先转换为16.16高度，再做定点双线性插值
+	auto sampleHeight = [&tile](uint16 sample)
+	{
+		return static_cast<int64>(tile.minHeightFixed) + ((static_cast<int64>(sample) * tile.heightScaleFixed) >> 16);
+	};
+
+	const int64 h00 = sampleHeight(pRow0[0]);
+	const int64 h10 = sampleHeight(pRow0[1]);
+	const int64 h01 = sampleHeight(pRow1[0]);
+	const int64 h11 = sampleHeight(pRow1[1]);
+
+	const int64 bottom = h00 + (((h10 - h00) * fracX) >> FixedShift);
+	const int64 top = h01 + (((h11 - h01) * fracX) >> FixedShift);
+	return static_cast<int32>(bottom + (((top - bottom) * fracY) >> FixedShift));
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+
+// 地形高度场缓存
+// 关卡加载时按固定间距采样地形高度，以分块(tile)方式压缩存储：每块记录最小高度与量化比例，样本为16位整数
+// 相邻块共享边缘样本，双线性插值不需要跨块访问
+// GetHeights可在一次调用中批量(SIMD)查询所有玩家位置的高度
+// GetHeightFixed以16.16定点数与整数运算查询，相同的关卡数据与采样间距在所有对等端上得到逐位相同的结果，供确定性模拟使用
+class CTerrainHeightCache
+{
+public:
+	// 每块包含的格子数(每块样本数为(TileCells + 1)^2)
+	static constexpr int TileCells = 32;
+	static constexpr int TileSamples = TileCells + 1;
+	// 定点查询的小数位数，与CLockstepSimulation一致
+	static constexpr int FixedShift = 16;
+
+	// 以当前关卡的地形构建缓存
+	void Build(float sampleSpacing);
+	// 以任意高度函数构建缓存，terrainSize为地形边长(米)
+	void Build(float terrainSize, float sampleSpacing, const std::function<float(float x, float y)>& heightFunc);
+	void Clear();
+
+	bool IsValid() const { return !m_tiles.empty(); }
+	size_t GetMemoryUsage() const;
+
+	// 查询单个位置的高度(双线性插值)
+	float GetHeight(float x, float y) const;
+	// 批量查询count个位置的高度，可在任意线程调用
+	void GetHeights(const float* pX, const float* pY, float* pOutHeights, size_t count) const;
+	// 以16.16定点坐标查询高度(16.16)，插值只用整数运算；缓存无效时返回0
+	int32 GetHeightFixed(int32 x, int32 y) const;
+
+protected:
+	struct STile
+	{
+		float minHeight;
+		// 量化值到米的比例
+		float heightScale;
+		// 构建时转换的定点值：最小高度(16.16)，每个量化单位的高度(32位小数)
+		int32 minHeightFixed;
+		int64 heightScaleFixed;
+		uint16 samples[TileSamples * TileSamples];
+	};
+
+	// 以格子坐标(已限制在地形范围内)取样本并插值
+	float SampleCell(int cellX, int cellY, float fracX, float fracY) const;
+
+protected:
+	std::vector<STile> m_tiles;
+	int m_tilesPerAxis = 0;
+	int m_cellsPerAxis = 0;
+	float m_sampleSpacing = 1.f;
+	float m_invSampleSpacing = 1.f;
+	int32 m_sampleSpacingFixed = 1 << FixedShift;
+};
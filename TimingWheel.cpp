@@ -0,0 +1,238 @@
+#include "StdAfx.h"
+#include "TimingWheel.h"
+
+CTimingWheel::TimerId CTimingWheel::Schedule(float delay, std::function<void()> callback)
+{
+	uint32 index;
+	if (!m_freeTimers.empty())
+	{
+		index = m_freeTimers.back();
+		m_freeTimers.pop_back();
+	}
+	else
+	{
+		index = static_cast<uint32>(m_timers.size());
+		m_timers.emplace_back();
+	}
+
+	// 向上取整到tick，定时器不会早于要求的延迟触发
+	const float delayTicks = ceil_tpl(max(delay, 0.f) * static_cast<float>(TicksPerSecond));
+	const uint64 clampedDelayTicks = min(static_cast<uint64>(delayTicks), static_cast<uint64>(MaxDelayTicks));
+
+	STimer& timer = m_timers[index];
+	timer.callback = std::move(callback);
+	timer.expiryTick = m_currentTick + clampedDelayTicks;
+	timer.bPending = true;
+
+	Insert(index);
+	++m_pendingCount;
+
+	return MakeTimerId(index, timer.generation);
+}
+
+bool CTimingWheel::Cancel(TimerId timerId)
+{
+	STimer* pTimer = Find(timerId);
+	if (pTimer == nullptr)
+		return false;
+
+	const uint32 index = static_cast<uint32>(pTimer - m_timers.data());
+	Unlink(index);
+	Release(index);
+	return true;
+}
+
+bool CTimingWheel::IsPending(TimerId timerId) const
+{
+	return const_cast<CTimingWheel*>(this)->Find(timerId) != nullptr;
+}
+
+void CTimingWheel::Advance(const CTimeValue& now)
+{
+	m_lastFiredCount = 0;
+
+	if (!m_bHasOrigin)
+	{
+		m_originTime = now;
+		m_bHasOrigin = true;
+	}
+
+	const int64 elapsedTicks = (now - m_originTime).GetMicroSecondsAsInt64() * TicksPerSecond / 1000000;
+	const uint64 targetTick = static_cast<uint64>(max(elapsedTicks, static_cast<int64>(0)));
+
+	while (m_currentTick <= targetTick)
+	{
+		// 没有定时器时不需要逐个tick处理
+		if (m_pendingCount == 0)
+		{
+			m_currentTick = targetTick + 1;
+			break;
+		}
+
+		const uint32 slot = static_cast<uint32>(m_currentTick & (SlotsPerLevel - 1));
+
+		// 第0层转完一圈，从第1层开始依次把到达的槽分配到低层
+		if (slot == 0 && m_currentTick != 0)
+		{
+			for (uint32 level = 1; level < LevelCount; ++level)
+			{
+				const uint32 levelSlot = static_cast<uint32>((m_currentTick >> (LevelBits * level)) & (SlotsPerLevel - 1));
+				Cascade(level, levelSlot);
+
+				if (levelSlot != 0)
+					break;
+			}
+		}
+
+		if (m_occupiedSlots[0] & (static_cast<uint64>(1) << slot))
+		{
+			FireSlot(slot);
+		}
+
+		++m_currentTick;
+	}
+}
+
+void CTimingWheel::Clear()
+{
+	for (uint32 level = 0; level < LevelCount; ++level)
+	{
+		for (SSlot& slot : m_slots[level])
+		{
+			slot = SSlot();
+		}
+		m_occupiedSlots[level] = 0;
+	}
+
+	// 节点保留并递增代数，之前返回的id不会与之后添加的定时器混淆
+	for (uint32 index = 0; index < m_timers.size(); ++index)
+	{
+		if (m_timers[index].bPending)
+		{
+			m_timers[index].prev = InvalidIndex;
+			m_timers[index].next = InvalidIndex;
+			Release(index);
+		}
+	}
+}
+
+void CTimingWheel::Insert(uint32 index)
+{
+	STimer& timer = m_timers[index];
+
+	// 按距离到期的tick数选择层，层内按到期tick在该层的位选择槽
+	const uint64 delta = timer.expiryTick - m_currentTick;
+	uint32 level = 0;
+	while (level + 1 < LevelCount && delta >= (static_cast<uint64>(1) << (LevelBits * (level + 1))))
+	{
+		++level;
+	}
+
+	const uint32 slotIndex = static_cast<uint32>((timer.expiryTick >> (LevelBits * level)) & (SlotsPerLevel - 1));
+	SSlot& slot = m_slots[level][slotIndex];
+
+	timer.level = static_cast<uint8>(level);
+	timer.slot = static_cast<uint8>(slotIndex);
+	timer.prev = slot.tail;
+	timer.next = InvalidIndex;
+
+	if (slot.tail != InvalidIndex)
+	{
+		m_timers[slot.tail].next = index;
+	}
+	else
+	{
+		slot.head = index;
+	}
+	slot.tail = index;
+
+	m_occupiedSlots[level] |= static_cast<uint64>(1) << slotIndex;
+}
+
+void CTimingWheel::Unlink(uint32 index)
+{
+	STimer& timer = m_timers[index];
+	SSlot& slot = m_slots[timer.level][timer.slot];
+
+	if (timer.prev != InvalidIndex)
+	{
+		m_timers[timer.prev].next = timer.next;
+	}
+	else
+	{
+		slot.head = timer.next;
+	}
+
+	if (timer.next != InvalidIndex)
+	{
+		m_timers[timer.next].prev = timer.prev;
+	}
+	else
+	{
+		slot.tail = timer.prev;
+	}
+
+	if (slot.head == InvalidIndex)
+	{
+		m_occupiedSlots[timer.level] &= ~(static_cast<uint64>(1) << timer.slot);
+	}
+
+	timer.prev = InvalidIndex;
+	timer.next = InvalidIndex;
+}
+
+void CTimingWheel::Release(uint32 index)
+{
+	STimer& timer = m_timers[index];
+	timer.callback = nullptr;
+	timer.bPending = false;
+	++timer.generation;
+
+	m_freeTimers.push_back(index);
+	--m_pendingCount;
+}
+
+void CTimingWheel::Cascade(uint32 level, uint32 slot)
+{
+	// 取下整个槽再逐个插入，插入时按剩余的tick数落到更低的层
+	uint32 index = m_slots[level][slot].head;
+	m_slots[level][slot] = SSlot();
+	m_occupiedSlots[level] &= ~(static_cast<uint64>(1) << slot);
+
+	while (index != InvalidIndex)
+	{
+		const uint32 next = m_timers[index].next;
+		Insert(index);
+		index = next;
+	}
+}
+
+void CTimingWheel::FireSlot(uint32 slot)
+{
+	// 每次取链表头，回调中添加到本槽(延迟为0)或取消的定时器同样得到正确处理
+	while (m_slots[0][slot].head != InvalidIndex)
+	{
+		const uint32 index = m_slots[0][slot].head;
+		Unlink(index);
+
+		// 回调可能添加定时器使m_timers重新分配，先把回调移出节点
+		std::function<void()> callback = std::move(m_timers[index].callback);
+		Release(index);
+		++m_lastFiredCount;
+
+		callback();
+	}
+}
+
+CTimingWheel::STimer* CTimingWheel::Find(TimerId timerId)
+{
+	const uint64 indexPlusOne = timerId & 0xFFFFFFFFu;
+	if (indexPlusOne == 0 || indexPlusOne > m_timers.size())
+		return nullptr;
+
+	STimer& timer = m_timers[static_cast<size_t>(indexPlusOne - 1)];
+	if (!timer.bPending || timer.generation != static_cast<uint32>(timerId >> 32))
+		return nullptr;
+
+	return &timer;
+}
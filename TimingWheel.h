@@ -0,0 +1,84 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+
+// 分层时间轮
+// 定时回调以固定的tick(1/64秒)为单位，按到期时间落入4层、每层64个槽中的一个：第0层每槽1个tick，第1层64个tick，依此类推，最长约3天
+// 添加与取消都是O(1)(槽内为双向链表)，每个tick只处理第0层的一个槽，低层转完一圈时把上一层的一个槽重新分配到低层
+// 回调按到期tick的顺序触发，同一tick内按添加顺序；没有到期的tick只检查一个位掩码，没有定时器时直接跳过
+//
+// 回调中可以添加或取消定时器，延迟为0的定时器在当前tick内触发
+class CTimingWheel
+{
+public:
+	typedef uint64 TimerId;
+	static constexpr TimerId InvalidTimerId = 0;
+
+	static constexpr uint32 TicksPerSecond = 64;
+
+	// delay秒后调用callback，返回可用于取消的id
+	TimerId Schedule(float delay, std::function<void()> callback);
+	// 取消尚未触发的定时器，已触发或已取消时返回false
+	bool Cancel(TimerId timerId);
+	bool IsPending(TimerId timerId) const;
+
+	// 触发到now为止到期的所有定时器
+	void Advance(const CTimeValue& now);
+	// 不触发地取消所有定时器，用于关卡卸载
+	void Clear();
+
+	size_t GetPendingCount() const { return m_pendingCount; }
+	uint32 GetLastFiredCount() const { return m_lastFiredCount; }
+
+protected:
+	static constexpr uint32 LevelBits = 6;
+	static constexpr uint32 SlotsPerLevel = 1 << LevelBits;
+	static constexpr uint32 LevelCount = 4;
+	static constexpr uint64 MaxDelayTicks = (static_cast<uint64>(1) << (LevelBits * LevelCount)) - 1;
+	static constexpr uint32 InvalidIndex = ~0u;
+
+	struct STimer
+	{
+		std::function<void()> callback;
+		uint64 expiryTick = 0;
+		// 所在槽的链表
+		uint32 prev = InvalidIndex;
+		uint32 next = InvalidIndex;
+		// 节点复用时递增，使旧的id失效
+		uint32 generation = 0;
+		uint8 level = 0;
+		uint8 slot = 0;
+		bool bPending = false;
+	};
+
+	struct SSlot
+	{
+		uint32 head = InvalidIndex;
+		uint32 tail = InvalidIndex;
+	};
+
+	void Insert(uint32 index);
+	void Unlink(uint32 index);
+	void Release(uint32 index);
+	// 把level层的slot槽中的定时器重新分配到更低的层
+	void Cascade(uint32 level, uint32 slot);
+	void FireSlot(uint32 slot);
+	STimer* Find(TimerId timerId);
+
+	static TimerId MakeTimerId(uint32 index, uint32 generation) { return (static_cast<uint64>(generation) << 32) | (static_cast<uint64>(index) + 1); }
+
+	std::vector<STimer> m_timers;
+	std::vector<uint32> m_freeTimers;
+	SSlot m_slots[LevelCount][SlotsPerLevel];
+	// 每层非空槽的位掩码
+	uint64 m_occupiedSlots[LevelCount] = {};
+
+	// 下一个要处理的tick
+	uint64 m_currentTick = 0;
+	CTimeValue m_originTime;
+	bool m_bHasOrigin = false;
+
+	size_t m_pendingCount = 0;
+	uint32 m_lastFiredCount = 0;
+};
@@ -0,0 +1,336 @@
+// 观战广播中继
+// 与游戏服务器运行在同一台机器上，从服务器的g_broadcastPort读取共享的观战流，原样转发给任意数量的观众
+// 服务器只需要为中继编码与发送一次，观众数量只影响中继进程
+// 观众端可使用Tools/BroadcastViewer
+//
+// 用法: BroadcastRelay <serverPort> <viewerPort> [maxViewers]
+//
+// 流格式见CBroadcastStream：每帧为 uint32 帧长度 + 帧头(magic 'BCST'、帧序号、服务器时间、实体数量) + 实体id + 编码后的变换
+// 中继只按帧边界转发，新观众总是从一个完整的帧开始接收
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#if defined(_WIN32)
+	#include <winsock2.h>
+	#include <ws2tcpip.h>
+	#pragma comment(lib, "ws2_32.lib")
+
+typedef SOCKET RelaySocket;
+typedef WSAPOLLFD RelayPollFd;
+static const RelaySocket InvalidSocket = INVALID_SOCKET;
+
+static int PollSockets(RelayPollFd* pFds, size_t count, int timeoutMs) { return WSAPoll(pFds, static_cast<ULONG>(count), timeoutMs); }
+static void CloseSocket(RelaySocket socket) { closesocket(socket); }
+static bool WouldBlock() { return WSAGetLastError() == WSAEWOULDBLOCK; }
+static bool MakeNonBlocking(RelaySocket socket)
+{
+	u_long nonBlocking = 1;
+	return ioctlsocket(socket, FIONBIO, &nonBlocking) == 0;
+}
+#else
+	#include <arpa/inet.h>
+	#include <cerrno>
+	#include <fcntl.h>
+	#include <netinet/in.h>
+	#include <netinet/tcp.h>
+	#include <poll.h>
+	#include <signal.h>
+	#include <sys/socket.h>
+	#include <unistd.h>
+
+typedef int RelaySocket;
+typedef pollfd RelayPollFd;
+static const RelaySocket InvalidSocket = -1;
+
+static int PollSockets(RelayPollFd* pFds, size_t count, int timeoutMs) { return poll(pFds, count, timeoutMs); }
+static void CloseSocket(RelaySocket socket) { close(socket); }
+static bool WouldBlock() { return errno == EWOULDBLOCK || errno == EAGAIN; }
+static bool MakeNonBlocking(RelaySocket socket) { return fcntl(socket, F_SETFL, fcntl(socket, F_GETFL, 0) | O_NONBLOCK) == 0; }
+#endif
+
+namespace
+{
+	const uint32_t FrameMagic = 0x54534342; // 'BCST'
+	// 单帧的上限，超过时认为流已损坏
+	const uint32_t MaxFrameSize = 16 * 1024 * 1024;
+	// 每个观众最多积压的字节数，超过时断开过慢的观众
+	const size_t MaxViewerBacklog = 8 * 1024 * 1024;
+	// 与服务器断开后重连的间隔(毫秒)
+	const int ReconnectIntervalMs = 1000;
+
+	struct SViewer
+	{
+		RelaySocket socket;
+		std::vector<uint8_t> pendingBytes;
+	};
+
+	struct SRelayState
+	{
+		RelaySocket serverSocket = InvalidSocket;
+		RelaySocket listenSocket = InvalidSocket;
+		std::vector<SViewer> viewers;
+		size_t maxViewers = 1000;
+
+		// 从服务器收到、尚未组成完整帧的数据
+		std::vector<uint8_t> receiveBuffer;
+		uint64_t forwardedFrames = 0;
+	};
+
+	RelaySocket ConnectToServer(uint16_t port)
+	{
+		const RelaySocket socket = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+		if (socket == InvalidSocket)
+			return InvalidSocket;
+
+		sockaddr_in address;
+		memset(&address, 0, sizeof(address));
+		address.sin_family = AF_INET;
+		address.sin_port = htons(port);
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+		if (connect(socket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 || !MakeNonBlocking(socket))
+		{
+			CloseSocket(socket);
+			return InvalidSocket;
+		}
+
+		return socket;
+	}
+
+	RelaySocket ListenForViewers(uint16_t port)
+	{
+		const RelaySocket socket = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+		if (socket == InvalidSocket)
+			return InvalidSocket;
+
+		const int reuseAddress = 1;
+		setsockopt(socket, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuseAddress), sizeof(reuseAddress));
+
+		sockaddr_in address;
+		memset(&address, 0, sizeof(address));
+		address.sin_family = AF_INET;
+		address.sin_port = htons(port);
+		address.sin_addr.s_addr = htonl(INADDR_ANY);
+
+		if (bind(socket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0
+			|| listen(socket, 64) != 0
+			|| !MakeNonBlocking(socket))
+		{
+			CloseSocket(socket);
+			return InvalidSocket;
+		}
+
+		return socket;
+	}
+
+	void AcceptViewers(SRelayState& state)
+	{
+		for (;;)
+		{
+			const RelaySocket socket = accept(state.listenSocket, nullptr, nullptr);
+			if (socket == InvalidSocket)
+				break;
+
+			if (state.viewers.size() >= state.maxViewers || !MakeNonBlocking(socket))
+			{
+				CloseSocket(socket);
+				continue;
+			}
+
+			const int noDelay = 1;
+			setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&noDelay), sizeof(noDelay));
+
+			state.viewers.push_back(SViewer{ socket, {} });
+			printf("[BroadcastRelay] Viewer connected (%zu total)\n", state.viewers.size());
+		}
+	}
+
+	// 把接收缓冲中的完整帧追加到每个观众的发送缓冲，流损坏时返回false
+	bool ForwardCompleteFrames(SRelayState& state)
+	{
+		size_t offset = 0;
+		while (state.receiveBuffer.size() - offset >= sizeof(uint32_t) * 2)
+		{
+			uint32_t frameSize;
+			uint32_t magic;
+			memcpy(&frameSize, state.receiveBuffer.data() + offset, sizeof(frameSize));
+			memcpy(&magic, state.receiveBuffer.data() + offset + sizeof(frameSize), sizeof(magic));
+
+			if (magic != FrameMagic || frameSize > MaxFrameSize)
+				return false;
+
+			const size_t totalSize = sizeof(uint32_t) + frameSize;
+			if (state.receiveBuffer.size() - offset < totalSize)
+				break;
+
+			const uint8_t* pFrame = state.receiveBuffer.data() + offset;
+			for (SViewer& viewer : state.viewers)
+			{
+				viewer.pendingBytes.insert(viewer.pendingBytes.end(), pFrame, pFrame + totalSize);
+			}
+
+			offset += totalSize;
+			++state.forwardedFrames;
+		}
+
+		state.receiveBuffer.erase(state.receiveBuffer.begin(), state.receiveBuffer.begin() + offset);
+		return true;
+	}
+
+	// 读取服务器发来的数据，连接断开或流损坏时返回false
+	bool ReceiveFromServer(SRelayState& state)
+	{
+		uint8_t chunk[64 * 1024];
+		for (;;)
+		{
+			const int result = recv(state.serverSocket, reinterpret_cast<char*>(chunk), sizeof(chunk), 0);
+			if (result > 0)
+			{
+				state.receiveBuffer.insert(state.receiveBuffer.end(), chunk, chunk + result);
+				continue;
+			}
+
+			if (result < 0 && WouldBlock())
+				break;
+
+			return false;
+		}
+
+		return ForwardCompleteFrames(state);
+	}
+
+	// 尽量发送待发数据，观众断开或积压过多时返回false
+	bool FlushViewer(SViewer& viewer)
+	{
+		if (viewer.pendingBytes.size() > MaxViewerBacklog)
+			return false;
+
+		size_t sentBytes = 0;
+		while (sentBytes < viewer.pendingBytes.size())
+		{
+#if defined(MSG_NOSIGNAL)
+			const int flags = MSG_NOSIGNAL;
+#else
+			const int flags = 0;
+#endif
+			const int result = send(viewer.socket, reinterpret_cast<const char*>(viewer.pendingBytes.data() + sentBytes), static_cast<int>(viewer.pendingBytes.size() - sentBytes), flags);
+			if (result < 0)
+			{
+				if (WouldBlock())
+					break;
+
+				return false;
+			}
+
+			sentBytes += static_cast<size_t>(result);
+		}
+
+		viewer.pendingBytes.erase(viewer.pendingBytes.begin(), viewer.pendingBytes.begin() + sentBytes);
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 3)
+	{
+		fprintf(stderr, "Usage: %s <serverPort> <viewerPort> [maxViewers]\n", argv[0]);
+		return 1;
+	}
+
+#if defined(_WIN32)
+	WSADATA wsaData;
+	if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+		return 1;
+#else
+	// 观众断开时send不应终止进程
+	signal(SIGPIPE, SIG_IGN);
+#endif
+
+	const uint16_t serverPort = static_cast<uint16_t>(atoi(argv[1]));
+	const uint16_t viewerPort = static_cast<uint16_t>(atoi(argv[2]));
+
+	SRelayState state;
+	if (argc >= 4)
+	{
+		state.maxViewers = static_cast<size_t>(atoi(argv[3]));
+	}
+
+	state.listenSocket = ListenForViewers(viewerPort);
+	if (state.listenSocket == InvalidSocket)
+	{
+		fprintf(stderr, "[BroadcastRelay] Failed to listen on port %u\n", viewerPort);
+		return 1;
+	}
+
+	printf("[BroadcastRelay] Relaying 127.0.0.1:%u to port %u\n", serverPort, viewerPort);
+
+	std::vector<RelayPollFd> pollFds;
+	int reconnectDelayMs = 0;
+
+	for (;;)
+	{
+		if (state.serverSocket == InvalidSocket && reconnectDelayMs <= 0)
+		{
+			state.serverSocket = ConnectToServer(serverPort);
+			state.receiveBuffer.clear();
+			reconnectDelayMs = ReconnectIntervalMs;
+
+			if (state.serverSocket != InvalidSocket)
+			{
+				printf("[BroadcastRelay] Connected to server\n");
+			}
+		}
+
+		// 监听套接字、服务器(已连接时)与有待发数据的观众
+		pollFds.clear();
+		pollFds.push_back(RelayPollFd{ state.listenSocket, POLLIN, 0 });
+		if (state.serverSocket != InvalidSocket)
+		{
+			pollFds.push_back(RelayPollFd{ state.serverSocket, POLLIN, 0 });
+		}
+		for (const SViewer& viewer : state.viewers)
+		{
+			if (!viewer.pendingBytes.empty())
+			{
+				pollFds.push_back(RelayPollFd{ viewer.socket, POLLOUT, 0 });
+			}
+		}
+
+		const int timeoutMs = 100;
+		PollSockets(pollFds.data(), pollFds.size(), timeoutMs);
+
+		if (state.serverSocket == InvalidSocket)
+		{
+			reconnectDelayMs -= timeoutMs;
+		}
+
+		AcceptViewers(state);
+
+		if (state.serverSocket != InvalidSocket && !ReceiveFromServer(state))
+		{
+			printf("[BroadcastRelay] Lost server stream after %llu frames, reconnecting\n", static_cast<unsigned long long>(state.forwardedFrames));
+			CloseSocket(state.serverSocket);
+			state.serverSocket = InvalidSocket;
+			reconnectDelayMs = ReconnectIntervalMs;
+		}
+
+		for (size_t i = 0; i < state.viewers.size();)
+		{
+			if (FlushViewer(state.viewers[i]))
+			{
+				++i;
+				continue;
+			}
+
+			CloseSocket(state.viewers[i].socket);
+			state.viewers[i] = std::move(state.viewers.back());
+			state.viewers.pop_back();
+			printf("[BroadcastRelay] Viewer disconnected (%zu remaining)\n", state.viewers.size());
+		}
+	}
+}
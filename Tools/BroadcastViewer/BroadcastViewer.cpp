@@ -0,0 +1,288 @@
+// 观战广播查看工具
+// 连接到中继(Tools/BroadcastRelay)的观众端口，解码延迟的观战流并逐帧打印每个实体的位置与朝向
+// 用于确认观战链路端到端可用，也是编写图形观众客户端时的参考解码器
+//
+// 用法: BroadcastViewer <relayHost> <relayPort> [--every N]
+//
+// --every N 每N帧打印一次(默认每帧)
+// 流格式见CBroadcastStream，变换为CTransformCodec的默认格式(20位定点位置 + 最小三分量旋转)
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#if defined(_WIN32)
+	#include <winsock2.h>
+	#include <ws2tcpip.h>
+	#pragma comment(lib, "ws2_32.lib")
+
+typedef SOCKET ViewerSocket;
+static const ViewerSocket InvalidSocket = INVALID_SOCKET;
+
+static void CloseSocket(ViewerSocket socket) { closesocket(socket); }
+#else
+	#include <netdb.h>
+	#include <netinet/in.h>
+	#include <sys/socket.h>
+	#include <unistd.h>
+
+typedef int ViewerSocket;
+static const ViewerSocket InvalidSocket = -1;
+
+static void CloseSocket(ViewerSocket socket) { close(socket); }
+#endif
+
+namespace
+{
+	const uint32_t FrameMagic = 0x54534342; // 'BCST'
+	// 单帧的上限，超过时认为流已损坏
+	const uint32_t MaxFrameSize = 16 * 1024 * 1024;
+
+	// 与CBroadcastStream::SFrameHeader一致
+	struct SFrameHeader
+	{
+		uint32_t magic;
+		uint32_t frameIndex;
+		float serverTime;
+		uint32_t entityCount;
+	};
+	static_assert(sizeof(SFrameHeader) == 16, "Must match CBroadcastStream::SFrameHeader");
+
+	// 与CTransformCodec::SFormat的默认值一致
+	const float PositionOrigin[3] = { 0.f, 0.f, -1024.f };
+	const float PositionRange = 8192.f;
+	const int PositionBits = 20;
+	const int RotationBits = 10;
+	const float SmallestThreeRange = 1.41421356f;
+	const float SmallestThreeHalfRange = 0.70710678f;
+	const int BitsPerTransform = 3 * PositionBits + 2 + 3 * RotationBits;
+
+	const float RadiansToDegrees = 57.2957795f;
+
+	// 与CTransformCodec相同的低位在前的位读取
+	class CBitReader
+	{
+	public:
+		CBitReader(const uint8_t* pData, size_t size) : m_pData(pData), m_pEnd(pData + size) {}
+
+		uint32_t Read(int bits)
+		{
+			while (m_accumulatedBits < bits)
+			{
+				const uint64_t nextByte = m_pData < m_pEnd ? *m_pData++ : 0;
+				m_accumulator |= nextByte << m_accumulatedBits;
+				m_accumulatedBits += 8;
+			}
+
+			const uint32_t value = static_cast<uint32_t>(m_accumulator & ((1ull << bits) - 1));
+			m_accumulator >>= bits;
+			m_accumulatedBits -= bits;
+			return value;
+		}
+
+	protected:
+		const uint8_t* m_pData;
+		const uint8_t* m_pEnd;
+		uint64_t m_accumulator = 0;
+		int m_accumulatedBits = 0;
+	};
+
+	struct STransform
+	{
+		float position[3];
+		// x, y, z, w
+		float rotation[4];
+	};
+
+	STransform DecodeTransform(CBitReader& reader)
+	{
+		const float positionStep = PositionRange / static_cast<float>((1u << PositionBits) - 1);
+		const float rotationStep = SmallestThreeRange / static_cast<float>((1u << RotationBits) - 1);
+
+		STransform transform;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			transform.position[axis] = PositionOrigin[axis] + static_cast<float>(reader.Read(PositionBits)) * positionStep;
+		}
+
+		// 最大分量的索引与其余三个分量，最大分量由单位长度重建
+		const uint32_t largestIndex = reader.Read(2);
+		float components[3];
+		float sumSquares = 0.f;
+		for (int component = 0; component < 3; ++component)
+		{
+			components[component] = static_cast<float>(reader.Read(RotationBits)) * rotationStep - SmallestThreeHalfRange;
+			sumSquares += components[component] * components[component];
+		}
+
+		int inComponent = 0;
+		for (uint32_t component = 0; component < 4; ++component)
+		{
+			transform.rotation[component] = component == largestIndex ? sqrtf(fmaxf(1.f - sumSquares, 0.f)) : components[inComponent++];
+		}
+
+		return transform;
+	}
+
+	// 玩家的朝向为绕Z轴偏航后绕X轴俯仰，由前方向量(旋转矩阵的第二列)求出两个角度
+	void GetYawPitch(const float* q, float& yaw, float& pitch)
+	{
+		const float x = q[0], y = q[1], z = q[2], w = q[3];
+		const float forwardX = 2.f * (x * y - w * z);
+		const float forwardY = 1.f - 2.f * (x * x + z * z);
+		const float forwardZ = 2.f * (y * z + w * x);
+
+		yaw = atan2f(-forwardX, forwardY);
+		pitch = asinf(fminf(fmaxf(forwardZ, -1.f), 1.f));
+	}
+
+	ViewerSocket ConnectToRelay(const char* szHost, const char* szPort)
+	{
+		addrinfo hints;
+		memset(&hints, 0, sizeof(hints));
+		hints.ai_family = AF_INET;
+		hints.ai_socktype = SOCK_STREAM;
+		hints.ai_protocol = IPPROTO_TCP;
+
+		addrinfo* pAddresses = nullptr;
+		if (getaddrinfo(szHost, szPort, &hints, &pAddresses) != 0)
+			return InvalidSocket;
+
+		ViewerSocket socket = InvalidSocket;
+		for (addrinfo* pAddress = pAddresses; pAddress != nullptr && socket == InvalidSocket; pAddress = pAddress->ai_next)
+		{
+			socket = ::socket(pAddress->ai_family, pAddress->ai_socktype, pAddress->ai_protocol);
+			if (socket != InvalidSocket && connect(socket, pAddress->ai_addr, static_cast<int>(pAddress->ai_addrlen)) != 0)
+			{
+				CloseSocket(socket);
+				socket = InvalidSocket;
+			}
+		}
+
+		freeaddrinfo(pAddresses);
+		return socket;
+	}
+
+	// 阻塞读取size字节，连接断开时返回false
+	bool ReceiveAll(ViewerSocket socket, uint8_t* pData, size_t size)
+	{
+		while (size > 0)
+		{
+			const int result = recv(socket, reinterpret_cast<char*>(pData), static_cast<int>(size), 0);
+			if (result <= 0)
+				return false;
+
+			pData += result;
+			size -= static_cast<size_t>(result);
+		}
+
+		return true;
+	}
+
+	// 解码并打印一帧，帧内容与声明的实体数量不符时返回false
+	bool PrintFrame(const std::vector<uint8_t>& frame)
+	{
+		SFrameHeader header;
+		memcpy(&header, frame.data(), sizeof(header));
+
+		const size_t idBytes = static_cast<size_t>(header.entityCount) * sizeof(uint32_t);
+		const size_t transformBytes = (static_cast<size_t>(header.entityCount) * BitsPerTransform + 7) / 8;
+		if (frame.size() < sizeof(header) + idBytes + transformBytes)
+			return false;
+
+		printf("Frame %u, server time %.3f s, %u entities\n", header.frameIndex, header.serverTime, header.entityCount);
+
+		const uint8_t* pIds = frame.data() + sizeof(header);
+		CBitReader reader(pIds + idBytes, transformBytes);
+
+		for (uint32_t i = 0; i < header.entityCount; ++i)
+		{
+			uint32_t entityId;
+			memcpy(&entityId, pIds + i * sizeof(uint32_t), sizeof(entityId));
+
+			const STransform transform = DecodeTransform(reader);
+			float yaw, pitch;
+			GetYawPitch(transform.rotation, yaw, pitch);
+
+			printf("  %10u  pos (%9.2f, %9.2f, %8.2f)  yaw %7.1f  pitch %6.1f\n", entityId,
+				transform.position[0], transform.position[1], transform.position[2], yaw * RadiansToDegrees, pitch * RadiansToDegrees);
+		}
+
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 3)
+	{
+		fprintf(stderr, "Usage: %s <relayHost> <relayPort> [--every N]\n", argv[0]);
+		return 1;
+	}
+
+	uint32_t printInterval = 1;
+	for (int i = 3; i + 1 < argc; ++i)
+	{
+		if (strcmp(argv[i], "--every") == 0)
+		{
+			printInterval = static_cast<uint32_t>(atoi(argv[++i]));
+		}
+	}
+	printInterval = printInterval > 0 ? printInterval : 1;
+
+#if defined(_WIN32)
+	WSADATA wsaData;
+	if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+		return 1;
+#endif
+
+	const ViewerSocket socket = ConnectToRelay(argv[1], argv[2]);
+	if (socket == InvalidSocket)
+	{
+		fprintf(stderr, "[BroadcastViewer] Cannot connect to %s:%s\n", argv[1], argv[2]);
+		return 1;
+	}
+
+	printf("[BroadcastViewer] Connected to %s:%s\n", argv[1], argv[2]);
+
+	// 中继只按帧边界转发，连接后的第一个字节总是帧长度
+	std::vector<uint8_t> frame;
+	uint64_t receivedFrames = 0;
+	for (;;)
+	{
+		uint32_t frameSize;
+		if (!ReceiveAll(socket, reinterpret_cast<uint8_t*>(&frameSize), sizeof(frameSize)))
+			break;
+
+		if (frameSize < sizeof(SFrameHeader) || frameSize > MaxFrameSize)
+		{
+			fprintf(stderr, "[BroadcastViewer] Invalid frame size %u, stream is corrupt\n", frameSize);
+			break;
+		}
+
+		frame.resize(frameSize);
+		if (!ReceiveAll(socket, frame.data(), frame.size()))
+			break;
+
+		uint32_t magic;
+		memcpy(&magic, frame.data(), sizeof(magic));
+		if (magic != FrameMagic)
+		{
+			fprintf(stderr, "[BroadcastViewer] Invalid frame magic, stream is corrupt\n");
+			break;
+		}
+
+		if (receivedFrames++ % printInterval == 0 && !PrintFrame(frame))
+		{
+			fprintf(stderr, "[BroadcastViewer] Truncated frame, stream is corrupt\n");
+			break;
+		}
+	}
+
+	printf("[BroadcastViewer] Disconnected after %llu frames\n", static_cast<unsigned long long>(receivedFrames));
+	CloseSocket(socket);
+	return 0;
+}
@@ -0,0 +1,199 @@
+// 飞行记录器转换工具
+// 把服务器写出的.frec文件(见CFlightRecorder)转换为可读的时间线，或CSV以便导入表格
+//
+// 用法: FlightRecorderDump <dump.frec> [--csv]
+//
+// 时间线每行为一个tick：相对时间、帧号、帧间隔、插件更新耗时、各分段耗时、玩家数量、连接/断开、复制字节数与分配字节数
+// 帧间隔或更新耗时超过触发阈值的tick以*标记，末尾汇总各列的平均值与最大值
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+	const uint32_t FileMagic = 0x43455246; // 'FREC'
+	const uint32_t FileVersion = 1;
+	const size_t SectionCount = 8;
+	const size_t SectionNameLength = 16;
+
+	// 与CFlightRecorder::STickRecord一致
+	struct STickRecord
+	{
+		uint32_t frameId;
+		uint32_t serverTimeMs;
+		uint32_t frameMicroseconds;
+		uint32_t updateMicroseconds;
+		uint32_t replicatedBytes;
+		uint32_t allocatedBytes;
+		uint16_t sectionMicroseconds[SectionCount];
+		uint16_t playerCount;
+		uint8_t connects;
+		uint8_t disconnects;
+	};
+	static_assert(sizeof(STickRecord) == 44, "Must match CFlightRecorder::STickRecord");
+
+	struct SFileHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t recordSize;
+		uint32_t sectionCount;
+		uint32_t recordCount;
+		uint32_t triggerThresholdMs;
+		char sectionNames[SectionCount][SectionNameLength];
+	};
+
+	float Milliseconds(uint32_t microseconds)
+	{
+		return static_cast<float>(microseconds) / 1000.f;
+	}
+
+	bool ReadDump(const char* szPath, SFileHeader& header, std::vector<STickRecord>& records)
+	{
+		FILE* pFile = fopen(szPath, "rb");
+		if (pFile == nullptr)
+		{
+			fprintf(stderr, "[FlightRecorderDump] Cannot open %s\n", szPath);
+			return false;
+		}
+
+		bool bValid = fread(&header, sizeof(header), 1, pFile) == 1;
+		if (bValid && (header.magic != FileMagic || header.version != FileVersion || header.recordSize != sizeof(STickRecord) || header.sectionCount != SectionCount))
+		{
+			fprintf(stderr, "[FlightRecorderDump] %s is not a version %u flight recorder dump\n", szPath, FileVersion);
+			bValid = false;
+		}
+
+		if (bValid)
+		{
+			records.resize(header.recordCount);
+			if (!records.empty() && fread(records.data(), sizeof(STickRecord), records.size(), pFile) != records.size())
+			{
+				fprintf(stderr, "[FlightRecorderDump] %s is truncated\n", szPath);
+				bValid = false;
+			}
+		}
+
+		fclose(pFile);
+
+		// 名称不一定以零结尾
+		for (size_t i = 0; i < SectionCount; ++i)
+		{
+			header.sectionNames[i][SectionNameLength - 1] = '\0';
+		}
+
+		return bValid;
+	}
+
+	void WriteCsv(const SFileHeader& header, const std::vector<STickRecord>& records)
+	{
+		printf("time_ms,frame,frame_ms,update_ms");
+		for (size_t i = 0; i < SectionCount; ++i)
+		{
+			printf(",%s_ms", header.sectionNames[i]);
+		}
+		printf(",players,connects,disconnects,replicated_bytes,allocated_bytes\n");
+
+		for (const STickRecord& record : records)
+		{
+			printf("%u,%u,%.3f,%.3f", record.serverTimeMs - records.front().serverTimeMs, record.frameId, Milliseconds(record.frameMicroseconds), Milliseconds(record.updateMicroseconds));
+			for (size_t i = 0; i < SectionCount; ++i)
+			{
+				printf(",%.3f", Milliseconds(record.sectionMicroseconds[i]));
+			}
+			printf(",%u,%u,%u,%u,%u\n", record.playerCount, record.connects, record.disconnects, record.replicatedBytes, record.allocatedBytes);
+		}
+	}
+
+	void WriteTimeline(const SFileHeader& header, const std::vector<STickRecord>& records)
+	{
+		const uint32_t thresholdMicroseconds = header.triggerThresholdMs * 1000;
+
+		if (header.triggerThresholdMs > 0)
+		{
+			printf("%u ticks, written after a tick over %u ms (marked *)\n\n", header.recordCount, header.triggerThresholdMs);
+		}
+		else
+		{
+			printf("%u ticks, written on request\n\n", header.recordCount);
+		}
+
+		printf("  %9s %9s %8s %8s", "time(s)", "frame", "frame", "update");
+		for (size_t i = 0; i < SectionCount; ++i)
+		{
+			printf(" %11.11s", header.sectionNames[i]);
+		}
+		printf(" %7s %7s %10s %10s\n", "players", "+/-", "repl(B)", "alloc(B)");
+
+		std::vector<double> sectionTotals(SectionCount, 0.0);
+		std::vector<uint32_t> sectionMaxima(SectionCount, 0);
+		double frameTotal = 0.0;
+		double updateTotal = 0.0;
+		uint32_t frameMaximum = 0;
+		uint32_t updateMaximum = 0;
+
+		for (const STickRecord& record : records)
+		{
+			const bool bSpike = thresholdMicroseconds > 0 && (record.frameMicroseconds >= thresholdMicroseconds || record.updateMicroseconds >= thresholdMicroseconds);
+
+			char connections[16];
+			snprintf(connections, sizeof(connections), "+%u/-%u", record.connects, record.disconnects);
+
+			printf("%c %9.3f %9u %8.2f %8.2f", bSpike ? '*' : ' ', static_cast<float>(record.serverTimeMs - records.front().serverTimeMs) / 1000.f,
+				record.frameId, Milliseconds(record.frameMicroseconds), Milliseconds(record.updateMicroseconds));
+			for (size_t i = 0; i < SectionCount; ++i)
+			{
+				printf(" %11.2f", Milliseconds(record.sectionMicroseconds[i]));
+
+				sectionTotals[i] += record.sectionMicroseconds[i];
+				sectionMaxima[i] = std::max<uint32_t>(sectionMaxima[i], record.sectionMicroseconds[i]);
+			}
+			printf(" %7u %7s %10u %10u\n", record.playerCount, connections, record.replicatedBytes, record.allocatedBytes);
+
+			frameTotal += record.frameMicroseconds;
+			updateTotal += record.updateMicroseconds;
+			frameMaximum = std::max(frameMaximum, record.frameMicroseconds);
+			updateMaximum = std::max(updateMaximum, record.updateMicroseconds);
+		}
+
+		if (records.empty())
+			return;
+
+		const double count = static_cast<double>(records.size());
+		printf("\n  %-12s %8s %8s\n", "", "avg(ms)", "max(ms)");
+		printf("  %-12s %8.2f %8.2f\n", "frame", frameTotal / count / 1000.0, Milliseconds(frameMaximum));
+		printf("  %-12s %8.2f %8.2f\n", "update", updateTotal / count / 1000.0, Milliseconds(updateMaximum));
+		for (size_t i = 0; i < SectionCount; ++i)
+		{
+			printf("  %-12s %8.2f %8.2f\n", header.sectionNames[i], sectionTotals[i] / count / 1000.0, Milliseconds(sectionMaxima[i]));
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		fprintf(stderr, "Usage: %s <dump.frec> [--csv]\n", argv[0]);
+		return 1;
+	}
+
+	SFileHeader header;
+	std::vector<STickRecord> records;
+	if (!ReadDump(argv[1], header, records))
+		return 1;
+
+	if (argc >= 3 && strcmp(argv[2], "--csv") == 0)
+	{
+		WriteCsv(header, records);
+	}
+	else
+	{
+		WriteTimeline(header, records);
+	}
+
+	return 0;
+}
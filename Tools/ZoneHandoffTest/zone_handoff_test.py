@@ -0,0 +1,107 @@
+# 区域移交的脚本化测试
+# 在本机启动两个区域服务器(g_zoneCount 2)与一个客户端，客户端连接到区域0，
+# 区域0以g_zoneTeleport把客户端的玩家移到区域1的中心，触发移交
+# 检查：客户端收到移交并重新连接到区域1，区域1以移交令牌交还玩家，区域0收到确认后移除它保留的休眠副本
+#
+# 用法: python zone_handoff_test.py --server <专用服务器可执行文件> --client <启动器可执行文件> --project <.cryproject> --level <关卡>
+#
+# 进程的日志写入--work-dir，测试失败时保留以便检查
+
+import argparse
+import os
+import subprocess
+import sys
+import time
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(description="Two-server zone handoff test")
+    parser.add_argument("--server", required=True, help="Dedicated server executable")
+    parser.add_argument("--client", required=True, help="Game launcher executable")
+    parser.add_argument("--project", required=True, help="Path to the .cryproject file")
+    parser.add_argument("--level", required=True, help="Level loaded by both zone servers")
+    parser.add_argument("--game-port", type=int, default=64090, help="sv_port of zone 0, zone 1 uses the next port")
+    parser.add_argument("--zone-port", type=int, default=64200, help="g_zoneBasePort")
+    parser.add_argument("--channel", type=int, default=1, help="Channel id of the test client on zone 0")
+    parser.add_argument("--teleport-delay", type=float, default=30.0, help="Seconds after zone 0 starts before the client is moved to zone 1")
+    parser.add_argument("--timeout", type=float, default=120.0, help="Seconds to wait for the handoff to complete")
+    parser.add_argument("--work-dir", default="zone_handoff_test", help="Directory for logs and generated configs")
+    return parser.parse_args()
+
+
+def common_args(args, log_name):
+    return [
+        "-project", args.project,
+        "-logfile", os.path.abspath(os.path.join(args.work_dir, log_name)),
+        "+log_Verbosity", "3",
+        "+log_WriteToFileVerbosity", "3",
+    ]
+
+
+def start_zone(args, zone, extra_commands):
+    command = [args.server] + common_args(args, "zone%d.log" % zone) + [
+        "+sv_port", str(args.game_port + zone),
+        "+g_zoneCount", "2",
+        "+g_zoneIndex", str(zone),
+        "+g_zoneBasePort", str(args.zone_port),
+        "+map", args.level,
+    ] + extra_commands
+    return subprocess.Popen(command)
+
+
+def read_log(args, log_name):
+    path = os.path.join(args.work_dir, log_name)
+    if not os.path.exists(path):
+        return ""
+    with open(path, "r", errors="replace") as log_file:
+        return log_file.read()
+
+
+def main():
+    args = parse_args()
+    os.makedirs(args.work_dir, exist_ok=True)
+
+    # 命令行的+命令以延迟模式执行，wait_seconds推迟之后的命令，留出客户端连接与加载关卡的时间
+    processes = [
+        start_zone(args, 0, ["+wait_seconds", str(args.teleport_delay), "+g_zoneTeleport", str(args.channel), "1"]),
+        start_zone(args, 1, []),
+    ]
+    time.sleep(5.0)
+    processes.append(subprocess.Popen([args.client] + common_args(args, "client.log") + [
+        "+connect", "127.0.0.1", str(args.game_port),
+    ]))
+
+    # 每一项为(日志, 期望出现的内容)
+    expectations = [
+        ("zone0.log", "[Zones] Teleported channel %d to zone 1" % args.channel),
+        ("client.log", "[Zones] Transferring to 127.0.0.1:%d" % (args.game_port + 1)),
+        ("zone1.log", "[Reconnect] Channel"),
+        ("zone0.log", "[Zones] Handoff to zone 1 claimed, removed dormant copy"),
+    ]
+
+    deadline = time.time() + args.teleport_delay + args.timeout
+    pending = list(expectations)
+    try:
+        while pending and time.time() < deadline:
+            pending = [(log_name, text) for log_name, text in pending if text not in read_log(args, log_name)]
+            if any(process.poll() is not None for process in processes):
+                break
+            time.sleep(1.0)
+    finally:
+        for process in processes:
+            if process.poll() is None:
+                process.terminate()
+
+    for log_name, text in expectations:
+        print("%s %s: %s" % ("MISSING" if (log_name, text) in pending else "ok     ", log_name, text))
+
+    if pending:
+        print("Zone handoff test FAILED, logs are in %s" % os.path.abspath(args.work_dir))
+        return 1
+
+    print("Zone handoff test passed")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,573 @@
+#include "StdAfx.h"
+#include "TransformCodec.h"
+
+#if CRY_PLATFORM_SSE2
+	#include <emmintrin.h>
+#endif
+
+namespace
+{
+	// 最小三分量的取值范围为[-1/sqrt(2), 1/sqrt(2)]
+	constexpr float SmallestThreeRange = 1.41421356f;
+	constexpr float SmallestThreeHalfRange = 0.70710678f;
+
+	// 按位顺序写入，64位累加器满32位时输出
+	class CBitWriter
+	{
+	public:
+		explicit CBitWriter(uint8* pData) : m_pData(pData) {}
+
+		void Write(uint32 value, int bits)
+		{
+			m_accumulator |= static_cast<uint64>(value) << m_accumulatedBits;
+			m_accumulatedBits += bits;
+
+			if (m_accumulatedBits >= 32)
+			{
+				StoreBytes(4);
+				m_accumulator >>= 32;
+				m_accumulatedBits -= 32;
+			}
+		}
+
+		void Flush()
+		{
+			StoreBytes((m_accumulatedBits + 7) / 8);
+			m_accumulator = 0;
+			m_accumulatedBits = 0;
+		}
+
+	protected:
+		void StoreBytes(int byteCount)
+		{
+			for (int i = 0; i < byteCount; ++i)
+			{
+				*m_pData++ = static_cast<uint8>(m_accumulator >> (i * 8));
+			}
+		}
+
+		uint8* m_pData;
+		uint64 m_accumulator = 0;
+		int m_accumulatedBits = 0;
+	};
+
+	class CBitReader
+	{
+	public:
+		CBitReader(const uint8* pData, size_t size) : m_pData(pData), m_pEnd(pData + size) {}
+
+		uint32 Read(int bits)
+		{
+			while (m_accumulatedBits < bits)
+			{
+				const uint64 nextByte = m_pData < m_pEnd ? *m_pData++ : 0;
+				m_accumulator |= nextByte << m_accumulatedBits;
+				m_accumulatedBits += 8;
+			}
+
+			const uint32 value = static_cast<uint32>(m_accumulator & ((1ull << bits) - 1));
+			m_accumulator >>= bits;
+			m_accumulatedBits -= bits;
+			return value;
+		}
+
+	protected:
+		const uint8* m_pData;
+		const uint8* m_pEnd;
+		uint64 m_accumulator = 0;
+		int m_accumulatedBits = 0;
+	};
+
+	uint32 QuantizeUnit(float value, float maxValue)
+	{
+		return static_cast<uint32>(clamp_tpl(value * maxValue + 0.5f, 0.f, maxValue));
+	}
+
+#if CRY_PLATFORM_SSE2
+	inline __m128 Select(__m128 mask, __m128 a, __m128 b)
+	{
+		return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+	}
+#endif
+}
+
+CTransformCodec::CTransformCodec(const SFormat& format)
+	: m_format(format)
+{
+	m_format.positionBits = clamp_tpl(m_format.positionBits, 1, 24);
+	m_format.rotationBits = clamp_tpl(m_format.rotationBits, 1, 16);
+
+	m_maxPositionValue = static_cast<float>((1u << m_format.positionBits) - 1);
+	m_positionStep = m_format.positionRange / m_maxPositionValue;
+	m_invPositionStep = 1.f / m_positionStep;
+	m_maxRotationValue = static_cast<float>((1u << m_format.rotationBits) - 1);
+}
+
+uint32 CTransformCodec::GetBitsPerTransform() const
+{
+	const uint32 rotationBits = m_format.rotationEncoding == ERotationEncoding::SmallestThree ? 2 + 3 * m_format.rotationBits : 2 * m_format.rotationBits;
+	return 3 * m_format.positionBits + rotationBits;
+}
+
+bool CTransformCodec::IsInRange(const Vec3& position) const
+{
+	const Vec3 relative = position - m_format.positionOrigin;
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		if (!(relative[axis] >= 0.f && relative[axis] <= m_format.positionRange))
+			return false;
+	}
+	return true;
+}
+
+float CTransformCodec::GetMaxRotationError() const
+{
+	if (m_format.rotationEncoding == ERotationEncoding::SmallestThree)
+	{
+		// 三个分量各有半步误差e；最大分量不小于1/2，由单位长度重建时误差不超过3e
+		// 四元数的距离d对应的旋转角为4*asin(d/2)
+		const float componentError = 0.5f * SmallestThreeRange / m_maxRotationValue;
+		const float quaternionError = sqrt_tpl(3.f * componentError * componentError + 9.f * componentError * componentError);
+		return 4.f * asin_tpl(min(0.5f * quaternionError, 1.f));
+	}
+
+	// 偏航与俯仰各有半步误差
+	const float yawError = 0.5f * gf_PI2 / (m_maxRotationValue + 1.f);
+	const float pitchError = 0.5f * gf_PI / m_maxRotationValue;
+	return yawError + pitchError;
+}
+
+void CTransformCodec::Encode(const QuatT* pTransforms, size_t count, std::vector<uint8>& buffer) const
+{
+	buffer.resize(GetEncodedSize(count));
+	Encode(pTransforms, count, buffer.data());
+}
+
+void CTransformCodec::Encode(const QuatT* pTransforms, size_t count, uint8* pBuffer) const
+{
+	CBitWriter writer(pBuffer);
+
+	SQuantizedBlock block;
+	const int positionBits = m_format.positionBits;
+	const int rotationBits = m_format.rotationBits;
+	const bool bSmallestThree = m_format.rotationEncoding == ERotationEncoding::SmallestThree;
+
+	for (size_t blockBegin = 0; blockBegin < count; blockBegin += BlockSize)
+	{
+		const size_t blockCount = min(BlockSize, count - blockBegin);
+		Quantize(pTransforms + blockBegin, blockCount, block);
+
+		for (size_t i = 0; i < blockCount; ++i)
+		{
+			writer.Write(block.position[0][i], positionBits);
+			writer.Write(block.position[1][i], positionBits);
+			writer.Write(block.position[2][i], positionBits);
+
+			if (bSmallestThree)
+			{
+				writer.Write(block.rotationIndex[i], 2);
+				writer.Write(block.rotation[0][i], rotationBits);
+				writer.Write(block.rotation[1][i], rotationBits);
+				writer.Write(block.rotation[2][i], rotationBits);
+			}
+			else
+			{
+				writer.Write(block.rotation[0][i], rotationBits);
+				writer.Write(block.rotation[1][i], rotationBits);
+			}
+		}
+	}
+
+	writer.Flush();
+}
+
+void CTransformCodec::EncodeEach(const QuatT* pTransforms, size_t count, uint8* pBuffer) const
+{
+	SQuantizedBlock block;
+	const int positionBits = m_format.positionBits;
+	const int rotationBits = m_format.rotationBits;
+	const bool bSmallestThree = m_format.rotationEncoding == ERotationEncoding::SmallestThree;
+	const size_t stride = GetEncodedSize(1);
+
+	for (size_t blockBegin = 0; blockBegin < count; blockBegin += BlockSize)
+	{
+		const size_t blockCount = min(BlockSize, count - blockBegin);
+		Quantize(pTransforms + blockBegin, blockCount, block);
+
+		for (size_t i = 0; i < blockCount; ++i)
+		{
+			CBitWriter writer(pBuffer + (blockBegin + i) * stride);
+			writer.Write(block.position[0][i], positionBits);
+			writer.Write(block.position[1][i], positionBits);
+			writer.Write(block.position[2][i], positionBits);
+
+			if (bSmallestThree)
+			{
+				writer.Write(block.rotationIndex[i], 2);
+				writer.Write(block.rotation[0][i], rotationBits);
+				writer.Write(block.rotation[1][i], rotationBits);
+				writer.Write(block.rotation[2][i], rotationBits);
+			}
+			else
+			{
+				writer.Write(block.rotation[0][i], rotationBits);
+				writer.Write(block.rotation[1][i], rotationBits);
+			}
+
+			writer.Flush();
+		}
+	}
+}
+
+bool CTransformCodec::Decode(const uint8* pData, size_t size, QuatT* pOutTransforms, size_t count) const
+{
+	if (size < GetEncodedSize(count))
+		return false;
+
+	CBitReader reader(pData, size);
+
+	SQuantizedBlock block;
+	const int positionBits = m_format.positionBits;
+	const int rotationBits = m_format.rotationBits;
+	const bool bSmallestThree = m_format.rotationEncoding == ERotationEncoding::SmallestThree;
+
+	for (size_t blockBegin = 0; blockBegin < count; blockBegin += BlockSize)
+	{
+		const size_t blockCount = min(BlockSize, count - blockBegin);
+
+		for (size_t i = 0; i < blockCount; ++i)
+		{
+			block.position[0][i] = reader.Read(positionBits);
+			block.position[1][i] = reader.Read(positionBits);
+			block.position[2][i] = reader.Read(positionBits);
+
+			if (bSmallestThree)
+			{
+				block.rotationIndex[i] = reader.Read(2);
+				block.rotation[0][i] = reader.Read(rotationBits);
+				block.rotation[1][i] = reader.Read(rotationBits);
+				block.rotation[2][i] = reader.Read(rotationBits);
+			}
+			else
+			{
+				block.rotation[0][i] = reader.Read(rotationBits);
+				block.rotation[1][i] = reader.Read(rotationBits);
+			}
+		}
+
+		Dequantize(block, blockCount, pOutTransforms + blockBegin);
+	}
+
+	return true;
+}
+
+void CTransformCodec::Quantize(const QuatT* pTransforms, size_t count, SQuantizedBlock& block) const
+{
+	const bool bSmallestThree = m_format.rotationEncoding == ERotationEncoding::SmallestThree;
+	size_t i = 0;
+
+#if CRY_PLATFORM_SSE2
+	// 每次四个变换：转置为结构数组后在SIMD中完成定点量化与最小三分量的选择
+	const __m128 invStep = _mm_set1_ps(m_invPositionStep);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 maxPosition = _mm_set1_ps(m_maxPositionValue);
+	const __m128 maxRotation = _mm_set1_ps(m_maxRotationValue);
+	const __m128 rotationScale = _mm_set1_ps(m_maxRotationValue / SmallestThreeRange);
+	const __m128 rotationOffset = _mm_set1_ps(0.5f * m_maxRotationValue + 0.5f);
+	const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(0x80000000));
+	const __m128 origin[3] = { _mm_set1_ps(m_format.positionOrigin.x), _mm_set1_ps(m_format.positionOrigin.y), _mm_set1_ps(m_format.positionOrigin.z) };
+
+	for (; i + 4 <= count; i += 4)
+	{
+		const QuatT* p = pTransforms + i;
+
+		const __m128 position[3] =
+		{
+			_mm_setr_ps(p[0].t.x, p[1].t.x, p[2].t.x, p[3].t.x),
+			_mm_setr_ps(p[0].t.y, p[1].t.y, p[2].t.y, p[3].t.y),
+			_mm_setr_ps(p[0].t.z, p[1].t.z, p[2].t.z, p[3].t.z)
+		};
+
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			const __m128 scaled = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(position[axis], origin[axis]), invStep), half);
+			const __m128 clamped = _mm_min_ps(_mm_max_ps(scaled, zero), maxPosition);
+			_mm_store_si128(reinterpret_cast<__m128i*>(block.position[axis] + i), _mm_cvttps_epi32(clamped));
+		}
+
+		if (!bSmallestThree)
+		{
+			for (int lane = 0; lane < 4; ++lane)
+			{
+				QuantizeYawPitch(p[lane].q, block, i + lane);
+			}
+			continue;
+		}
+
+		__m128 x = _mm_setr_ps(p[0].q.v.x, p[1].q.v.x, p[2].q.v.x, p[3].q.v.x);
+		__m128 y = _mm_setr_ps(p[0].q.v.y, p[1].q.v.y, p[2].q.v.y, p[3].q.v.y);
+		__m128 z = _mm_setr_ps(p[0].q.v.z, p[1].q.v.z, p[2].q.v.z, p[3].q.v.z);
+		__m128 w = _mm_setr_ps(p[0].q.w, p[1].q.w, p[2].q.w, p[3].q.w);
+
+		// 找出绝对值最大的分量，相等时依次优先w、z、y
+		const __m128 absX = _mm_andnot_ps(signMask, x);
+		const __m128 absY = _mm_andnot_ps(signMask, y);
+		const __m128 absZ = _mm_andnot_ps(signMask, z);
+		const __m128 absW = _mm_andnot_ps(signMask, w);
+		const __m128 largest = _mm_max_ps(_mm_max_ps(absX, absY), _mm_max_ps(absZ, absW));
+
+		const __m128 isW = _mm_cmpeq_ps(absW, largest);
+		const __m128 isZ = _mm_andnot_ps(isW, _mm_cmpeq_ps(absZ, largest));
+		const __m128 isY = _mm_andnot_ps(_mm_or_ps(isW, isZ), _mm_cmpeq_ps(absY, largest));
+		const __m128 isX = _mm_andnot_ps(_mm_or_ps(_mm_or_ps(isW, isZ), isY), _mm_castsi128_ps(_mm_set1_epi32(-1)));
+
+		const __m128i index = _mm_or_si128(_mm_and_si128(_mm_castps_si128(isW), _mm_set1_epi32(3)),
+			_mm_or_si128(_mm_and_si128(_mm_castps_si128(isZ), _mm_set1_epi32(2)), _mm_and_si128(_mm_castps_si128(isY), _mm_set1_epi32(1))));
+		_mm_store_si128(reinterpret_cast<__m128i*>(block.rotationIndex + i), index);
+
+		// q与-q表示同一旋转，翻转符号使最大分量为正，解码时重建为正值
+		const __m128 largestSigned = Select(isW, w, Select(isZ, z, Select(isY, y, x)));
+		const __m128 flip = _mm_and_ps(largestSigned, signMask);
+		x = _mm_xor_ps(x, flip);
+		y = _mm_xor_ps(y, flip);
+		z = _mm_xor_ps(z, flip);
+		w = _mm_xor_ps(w, flip);
+
+		// 其余三个分量按原顺序排列
+		const __m128 components[3] =
+		{
+			Select(isX, y, x),
+			Select(_mm_or_ps(isX, isY), z, y),
+			Select(isW, z, w)
+		};
+
+		for (int component = 0; component < 3; ++component)
+		{
+			const __m128 scaled = _mm_add_ps(_mm_mul_ps(components[component], rotationScale), rotationOffset);
+			const __m128 clamped = _mm_min_ps(_mm_max_ps(scaled, zero), maxRotation);
+			_mm_store_si128(reinterpret_cast<__m128i*>(block.rotation[component] + i), _mm_cvttps_epi32(clamped));
+		}
+	}
+#endif
+
+	for (; i < count; ++i)
+	{
+		const Vec3 relative = pTransforms[i].t - m_format.positionOrigin;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			block.position[axis][i] = static_cast<uint32>(clamp_tpl(relative[axis] * m_invPositionStep + 0.5f, 0.f, m_maxPositionValue));
+		}
+
+		if (bSmallestThree)
+		{
+			QuantizeSmallestThree(pTransforms[i].q, block, i);
+		}
+		else
+		{
+			QuantizeYawPitch(pTransforms[i].q, block, i);
+		}
+	}
+}
+
+void CTransformCodec::Dequantize(const SQuantizedBlock& block, size_t count, QuatT* pOutTransforms) const
+{
+	const bool bSmallestThree = m_format.rotationEncoding == ERotationEncoding::SmallestThree;
+	size_t i = 0;
+
+#if CRY_PLATFORM_SSE2
+	const __m128 step = _mm_set1_ps(m_positionStep);
+	const __m128 origin[3] = { _mm_set1_ps(m_format.positionOrigin.x), _mm_set1_ps(m_format.positionOrigin.y), _mm_set1_ps(m_format.positionOrigin.z) };
+	const __m128 rotationScale = _mm_set1_ps(SmallestThreeRange / m_maxRotationValue);
+	const __m128 rotationOffset = _mm_set1_ps(SmallestThreeHalfRange);
+	const __m128 one = _mm_set1_ps(1.f);
+	const __m128 zero = _mm_setzero_ps();
+
+	alignas(16) float position[3][4];
+	alignas(16) float rotation[4][4];
+
+	for (; i + 4 <= count; i += 4)
+	{
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			const __m128 quantized = _mm_cvtepi32_ps(_mm_load_si128(reinterpret_cast<const __m128i*>(block.position[axis] + i)));
+			_mm_store_ps(position[axis], _mm_add_ps(_mm_mul_ps(quantized, step), origin[axis]));
+		}
+
+		if (bSmallestThree)
+		{
+			__m128 components[3];
+			for (int component = 0; component < 3; ++component)
+			{
+				const __m128 quantized = _mm_cvtepi32_ps(_mm_load_si128(reinterpret_cast<const __m128i*>(block.rotation[component] + i)));
+				components[component] = _mm_sub_ps(_mm_mul_ps(quantized, rotationScale), rotationOffset);
+			}
+
+			// 由单位长度重建最大分量
+			const __m128 sumSquares = _mm_add_ps(_mm_add_ps(_mm_mul_ps(components[0], components[0]), _mm_mul_ps(components[1], components[1])), _mm_mul_ps(components[2], components[2]));
+			const __m128 largest = _mm_sqrt_ps(_mm_max_ps(_mm_sub_ps(one, sumSquares), zero));
+
+			const __m128i index = _mm_load_si128(reinterpret_cast<const __m128i*>(block.rotationIndex + i));
+			const __m128 isX = _mm_castsi128_ps(_mm_cmpeq_epi32(index, _mm_setzero_si128()));
+			const __m128 isY = _mm_castsi128_ps(_mm_cmpeq_epi32(index, _mm_set1_epi32(1)));
+			const __m128 isZ = _mm_castsi128_ps(_mm_cmpeq_epi32(index, _mm_set1_epi32(2)));
+			const __m128 isW = _mm_castsi128_ps(_mm_cmpeq_epi32(index, _mm_set1_epi32(3)));
+
+			_mm_store_ps(rotation[0], Select(isX, largest, components[0]));
+			_mm_store_ps(rotation[1], Select(isX, components[0], Select(isY, largest, components[1])));
+			_mm_store_ps(rotation[2], Select(_mm_or_ps(isX, isY), components[1], Select(isZ, largest, components[2])));
+			_mm_store_ps(rotation[3], Select(isW, largest, components[2]));
+		}
+
+		for (int lane = 0; lane < 4; ++lane)
+		{
+			QuatT& transform = pOutTransforms[i + lane];
+			transform.t = Vec3(position[0][lane], position[1][lane], position[2][lane]);
+			transform.q = bSmallestThree ? Quat(rotation[3][lane], rotation[0][lane], rotation[1][lane], rotation[2][lane]) : DequantizeYawPitch(block, i + lane);
+		}
+	}
+#endif
+
+	for (; i < count; ++i)
+	{
+		QuatT& transform = pOutTransforms[i];
+		transform.t = m_format.positionOrigin + Vec3(
+			static_cast<float>(block.position[0][i]) * m_positionStep,
+			static_cast<float>(block.position[1][i]) * m_positionStep,
+			static_cast<float>(block.position[2][i]) * m_positionStep);
+		transform.q = bSmallestThree ? DequantizeSmallestThree(block, i) : DequantizeYawPitch(block, i);
+	}
+}
+
+void CTransformCodec::QuantizeSmallestThree(const Quat& rotation, SQuantizedBlock& block, size_t index) const
+{
+	const float values[4] = { rotation.v.x, rotation.v.y, rotation.v.z, rotation.w };
+
+	// 与SIMD路径相同：相等时依次优先w、z、y
+	uint32 largestIndex = 3;
+	for (uint32 component = 3; component-- > 0;)
+	{
+		if (fabs_tpl(values[component]) > fabs_tpl(values[largestIndex]))
+		{
+			largestIndex = component;
+		}
+	}
+
+	const float sign = values[largestIndex] < 0.f ? -1.f : 1.f;
+	block.rotationIndex[index] = largestIndex;
+
+	int outComponent = 0;
+	for (uint32 component = 0; component < 4; ++component)
+	{
+		if (component == largestIndex)
+			continue;
+
+		const float normalized = sign * values[component] / SmallestThreeRange + 0.5f;
+		block.rotation[outComponent++][index] = QuantizeUnit(normalized, m_maxRotationValue);
+	}
+}
+
+Quat CTransformCodec::DequantizeSmallestThree(const SQuantizedBlock& block, size_t index) const
+{
+	float components[3];
+	float sumSquares = 0.f;
+	for (int component = 0; component < 3; ++component)
+	{
+		components[component] = static_cast<float>(block.rotation[component][index]) * (SmallestThreeRange / m_maxRotationValue) - SmallestThreeHalfRange;
+		sumSquares += components[component] * components[component];
+	}
+
+	const uint32 largestIndex = block.rotationIndex[index];
+	float values[4];
+	int inComponent = 0;
+	for (uint32 component = 0; component < 4; ++component)
+	{
+		values[component] = component == largestIndex ? sqrt_tpl(max(1.f - sumSquares, 0.f)) : components[inComponent++];
+	}
+
+	return Quat(values[3], values[0], values[1], values[2]);
+}
+
+void CTransformCodec::QuantizeYawPitch(const Quat& rotation, SQuantizedBlock& block, size_t index) const
+{
+	// 玩家的朝向为绕Z轴偏航后绕X轴俯仰，由前方向量求出两个角度
+	const Vec3 forward = rotation.GetColumn1();
+	const float yaw = atan2_tpl(-forward.x, forward.y);
+	const float pitch = asin_tpl(clamp_tpl(forward.z, -1.f, 1.f));
+
+	// 偏航环绕，量化为[0, 2^bits)，俯仰限制在[-pi/2, pi/2]
+	const float yawSteps = m_maxRotationValue + 1.f;
+	block.rotation[0][index] = static_cast<uint32>(static_cast<int32>(yaw / gf_PI2 * yawSteps + yawSteps + 0.5f)) & static_cast<uint32>(m_maxRotationValue);
+	block.rotation[1][index] = QuantizeUnit(pitch / gf_PI + 0.5f, m_maxRotationValue);
+}
+
+Quat CTransformCodec::DequantizeYawPitch(const SQuantizedBlock& block, size_t index) const
+{
+	const float yaw = static_cast<float>(block.rotation[0][index]) * gf_PI2 / (m_maxRotationValue + 1.f);
+	const float pitch = (static_cast<float>(block.rotation[1][index]) / m_maxRotationValue - 0.5f) * gf_PI;
+
+	return Quat::CreateRotationZ(yaw) * Quat::CreateRotationX(pitch);
+}
+
+CTransformCodec::SBenchmarkResult CTransformCodec::Benchmark(size_t count, int iterations) const
+{
+	// 随机的位置与绕任意轴的旋转，俯仰限制在[-pi/2, pi/2]以便偏航/俯仰编码可以精确表示
+	uint32 randomState = 0x9E3779B9u;
+	const auto nextRandom = [&randomState]()
+	{
+		randomState ^= randomState << 13;
+		randomState ^= randomState >> 17;
+		randomState ^= randomState << 5;
+		return static_cast<float>(randomState >> 8) * (1.f / 16777216.f);
+	};
+
+	std::vector<QuatT> transforms(count);
+	for (QuatT& transform : transforms)
+	{
+		transform.t = m_format.positionOrigin + Vec3(nextRandom(), nextRandom(), nextRandom()) * m_format.positionRange;
+
+		const float yaw = (nextRandom() - 0.5f) * gf_PI2;
+		const float pitch = (nextRandom() - 0.5f) * gf_PI * 0.99f;
+		transform.q = Quat::CreateRotationZ(yaw) * Quat::CreateRotationX(pitch);
+		if (m_format.rotationEncoding == ERotationEncoding::SmallestThree)
+		{
+			transform.q = transform.q * Quat::CreateRotationY((nextRandom() - 0.5f) * gf_PI2);
+		}
+	}
+
+	std::vector<uint8> buffer;
+	std::vector<QuatT> decoded(count);
+	iterations = max(iterations, 1);
+
+	const CTimeValue encodeStart = gEnv->pTimer->GetAsyncTime();
+	for (int iteration = 0; iteration < iterations; ++iteration)
+	{
+		Encode(transforms.data(), count, buffer);
+	}
+
+	const CTimeValue decodeStart = gEnv->pTimer->GetAsyncTime();
+	for (int iteration = 0; iteration < iterations; ++iteration)
+	{
+		Decode(buffer.data(), buffer.size(), decoded.data(), count);
+	}
+	const CTimeValue decodeEnd = gEnv->pTimer->GetAsyncTime();
+
+	SBenchmarkResult result;
+	result.encodeMilliseconds = (decodeStart - encodeStart).GetMilliSeconds() / static_cast<float>(iterations);
+	result.decodeMilliseconds = (decodeEnd - decodeStart).GetMilliSeconds() / static_cast<float>(iterations);
+	result.encodedBytes = buffer.size();
+	result.maxPositionError = 0.f;
+	result.maxRotationError = 0.f;
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		const Vec3 positionError = decoded[i].t - transforms[i].t;
+		result.maxPositionError = max(result.maxPositionError, max(fabs_tpl(positionError.x), max(fabs_tpl(positionError.y), fabs_tpl(positionError.z))));
+
+		// 两个旋转之间的夹角
+		const float dot = fabs_tpl(decoded[i].q | transforms[i].q);
+		result.maxRotationError = max(result.maxRotationError, 2.f * acos_tpl(min(dot, 1.f)));
+	}
+
+	return result;
+}
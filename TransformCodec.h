@@ -0,0 +1,94 @@
+#pragma once
+
+#include <vector>
+
+// 玩家变换(位置与旋转)的批量编解码器
+// 位置以定点数量化，旋转以最小三分量(smallest-three)或偏航/俯仰量化，所有字段连续地按位打包在一个缓冲中
+// 量化与反量化每次以SIMD处理四个变换，按位打包逐个字段顺序写入，整个批次不需要逐字段的虚函数调用
+class CTransformCodec
+{
+public:
+	enum class ERotationEncoding : uint8
+	{
+		// 2位最大分量索引 + 3个rotationBits位的分量，可表示任意旋转
+		SmallestThree = 0,
+		// 偏航与俯仰各rotationBits位，丢弃滚动(玩家不会滚动)
+		YawPitch
+	};
+
+	struct SFormat
+	{
+		// 可表示的位置范围为[positionOrigin, positionOrigin + positionRange]
+		Vec3 positionOrigin = Vec3(0.f, 0.f, -1024.f);
+		float positionRange = 8192.f;
+		// 每个坐标轴的位数(1..24)
+		int positionBits = 20;
+		ERotationEncoding rotationEncoding = ERotationEncoding::SmallestThree;
+		// 每个旋转分量的位数(1..16)
+		int rotationBits = 10;
+	};
+
+	CTransformCodec() : CTransformCodec(SFormat()) {}
+	explicit CTransformCodec(const SFormat& format);
+
+	const SFormat& GetFormat() const { return m_format; }
+	uint32 GetBitsPerTransform() const;
+	// 编码count个变换所需的字节数
+	size_t GetEncodedSize(size_t count) const { return (GetBitsPerTransform() * count + 7) / 8; }
+
+	// 把count个变换编码到buffer(覆盖原内容)
+	void Encode(const QuatT* pTransforms, size_t count, std::vector<uint8>& buffer) const;
+	// 编码到调用者提供的缓冲，大小至少为GetEncodedSize(count)
+	void Encode(const QuatT* pTransforms, size_t count, uint8* pBuffer) const;
+	// 批量量化，但每个变换单独按字节对齐打包在GetEncodedSize(1)字节的槽位中，可逐个以Decode(..., 1)解码
+	// 缓冲大小至少为count * GetEncodedSize(1)
+	void EncodeEach(const QuatT* pTransforms, size_t count, uint8* pBuffer) const;
+	// 从size字节的数据解码count个变换，数据不足时返回false
+	bool Decode(const uint8* pData, size_t size, QuatT* pOutTransforms, size_t count) const;
+
+	// 位置是否在可表示的范围内，范围外的坐标编码时被截断到边界
+	bool IsInRange(const Vec3& position) const;
+
+	// 往返误差上限：位置每轴的最大误差(米)，旋转的最大角度误差(弧度)
+	float GetMaxPositionError() const { return 0.5f * m_positionStep; }
+	float GetMaxRotationError() const;
+
+	struct SBenchmarkResult
+	{
+		float encodeMilliseconds;
+		float decodeMilliseconds;
+		size_t encodedBytes;
+		float maxPositionError;
+		float maxRotationError;
+	};
+	// 以count个随机变换测量平均编解码耗时与实测的往返误差
+	SBenchmarkResult Benchmark(size_t count, int iterations) const;
+
+protected:
+	// 每次量化的变换数量，量化结果暂存在栈上
+	static constexpr size_t BlockSize = 64;
+
+	// 量化后的字段，结构数组(SoA)布局便于SIMD
+	struct SQuantizedBlock
+	{
+		alignas(16) uint32 position[3][BlockSize];
+		alignas(16) uint32 rotation[3][BlockSize];
+		alignas(16) uint32 rotationIndex[BlockSize];
+	};
+
+	void Quantize(const QuatT* pTransforms, size_t count, SQuantizedBlock& block) const;
+	void Dequantize(const SQuantizedBlock& block, size_t count, QuatT* pOutTransforms) const;
+
+	void QuantizeSmallestThree(const Quat& rotation, SQuantizedBlock& block, size_t index) const;
+	Quat DequantizeSmallestThree(const SQuantizedBlock& block, size_t index) const;
+	void QuantizeYawPitch(const Quat& rotation, SQuantizedBlock& block, size_t index) const;
+	Quat DequantizeYawPitch(const SQuantizedBlock& block, size_t index) const;
+
+protected:
+	SFormat m_format;
+
+	float m_positionStep;
+	float m_invPositionStep;
+	float m_maxPositionValue;
+	float m_maxRotationValue;
+};
@@ -0,0 +1,341 @@
+#include "StdAfx.h"
+#include "ZoneLink.h"
+
+#include <algorithm>
+
+bool CZoneLink::Start(int localZone, int zoneCount, uint16 basePort, uint16 gamePort)
+{
+	Stop();
+
+	m_localZone = localZone;
+	m_zoneCount = zoneCount;
+	m_basePort = basePort;
+	m_gamePort = gamePort;
+
+	const uint16 listenPort = static_cast<uint16>(basePort + localZone);
+
+	m_listenSocket = CrySock::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (m_listenSocket == CRY_INVALID_SOCKET)
+		return false;
+
+	CrySock::SetReuseAddress(m_listenSocket, true);
+
+	// 区域进程之间只在本机通信
+	CRYSOCKADDR_IN address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_port = htons(listenPort);
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	if (CrySock::bind(m_listenSocket, reinterpret_cast<const CRYSOCKADDR*>(&address), sizeof(address)) == CRY_SOCKET_ERROR
+		|| CrySock::listen(m_listenSocket, m_zoneCount) == CRY_SOCKET_ERROR
+		|| !CrySock::MakeSocketNonBlocking(m_listenSocket))
+	{
+		CryWarning(VALIDATOR_MODULE_GAME, VALIDATOR_WARNING, "[Zones] Zone %d failed to listen on 127.0.0.1:%u", m_localZone, listenPort);
+		Stop();
+		return false;
+	}
+
+	CryLogAlways("[Zones] Zone %d of %d listening for neighbouring zones on 127.0.0.1:%u", m_localZone, m_zoneCount, listenPort);
+	m_nextConnectTime = 0.f;
+	return true;
+}
+
+void CZoneLink::Stop()
+{
+	for (SConnection& connection : m_connections)
+	{
+		CrySock::closesocket(connection.socket);
+	}
+	m_connections.clear();
+
+	if (m_listenSocket != CRY_INVALID_SOCKET)
+	{
+		CrySock::closesocket(m_listenSocket);
+		m_listenSocket = CRY_INVALID_SOCKET;
+	}
+}
+
+void CZoneLink::Update(const SCallbacks& callbacks)
+{
+	if (!IsRunning())
+		return;
+
+	AcceptConnections();
+
+	const float now = gEnv->pTimer->GetAsyncCurTime();
+	if (now >= m_nextConnectTime)
+	{
+		m_nextConnectTime = now + ReconnectInterval;
+		ConnectToLowerZones();
+	}
+
+	for (size_t i = 0; i < m_connections.size();)
+	{
+		SConnection& connection = m_connections[i];
+		if (Receive(connection, callbacks) && Flush(connection))
+		{
+			++i;
+			continue;
+		}
+
+		if (connection.zone >= 0)
+		{
+			CryLogAlways("[Zones] Lost connection to zone %d", connection.zone);
+		}
+
+		CrySock::closesocket(connection.socket);
+		m_connections[i] = std::move(m_connections.back());
+		m_connections.pop_back();
+	}
+}
+
+bool CZoneLink::IsConnected(int zone) const
+{
+	return GetGamePort(zone) != 0;
+}
+
+uint16 CZoneLink::GetGamePort(int zone) const
+{
+	for (const SConnection& connection : m_connections)
+	{
+		if (connection.zone == zone)
+			return connection.gamePort;
+	}
+
+	return 0;
+}
+
+size_t CZoneLink::GetConnectedCount() const
+{
+	return std::count_if(m_connections.begin(), m_connections.end(), [](const SConnection& connection) { return connection.zone >= 0; });
+}
+
+void CZoneLink::ConnectToLowerZones()
+{
+	for (int zone = 0; zone < m_localZone; ++zone)
+	{
+		const bool bConnected = std::any_of(m_connections.begin(), m_connections.end(), [zone](const SConnection& connection) { return connection.zone == zone; });
+		if (bConnected)
+			continue;
+
+		const CRYSOCKET socket = CrySock::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+		if (socket == CRY_INVALID_SOCKET)
+			continue;
+
+		CRYSOCKADDR_IN address;
+		memset(&address, 0, sizeof(address));
+		address.sin_family = AF_INET;
+		address.sin_port = htons(static_cast<uint16>(m_basePort + zone));
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+		// 回环地址上的连接立即完成或被拒绝，对端尚未启动时下次再试
+		if (CrySock::connect(socket, reinterpret_cast<const CRYSOCKADDR*>(&address), sizeof(address)) == CRY_SOCKET_ERROR
+			|| !CrySock::MakeSocketNonBlocking(socket))
+		{
+			CrySock::closesocket(socket);
+			continue;
+		}
+
+		SConnection connection;
+		connection.socket = socket;
+		connection.zone = zone;
+
+		const SHello hello{ m_localZone, m_gamePort };
+		Append(connection, EMessage::Hello, &hello, sizeof(hello));
+		m_connections.push_back(std::move(connection));
+
+		CryLogAlways("[Zones] Connected to zone %d", zone);
+	}
+}
+
+void CZoneLink::AcceptConnections()
+{
+	for (;;)
+	{
+		const CRYSOCKET socket = CrySock::accept(m_listenSocket, nullptr, nullptr);
+		if (socket == CRY_INVALID_SOCKET)
+			break;
+
+		CrySock::MakeSocketNonBlocking(socket);
+
+		// 对端的区域编号在其Hello到达后才知道
+		SConnection connection;
+		connection.socket = socket;
+
+		const SHello hello{ m_localZone, m_gamePort };
+		Append(connection, EMessage::Hello, &hello, sizeof(hello));
+		m_connections.push_back(std::move(connection));
+	}
+}
+
+bool CZoneLink::Send(int zone, EMessage type, const void* pPayload, uint32 size)
+{
+	for (SConnection& connection : m_connections)
+	{
+		// 收到Hello之前不知道对端的游戏端口，移交的客户端无法重新连接
+		if (connection.zone == zone && connection.gamePort != 0)
+		{
+			Append(connection, type, pPayload, size);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void CZoneLink::Append(SConnection& connection, EMessage type, const void* pPayload, uint32 size)
+{
+	const uint32 messageSize = size + 1;
+	const uint8* pSizeBytes = reinterpret_cast<const uint8*>(&messageSize);
+	const uint8* pPayloadBytes = static_cast<const uint8*>(pPayload);
+
+	connection.sendBuffer.insert(connection.sendBuffer.end(), pSizeBytes, pSizeBytes + sizeof(messageSize));
+	connection.sendBuffer.push_back(static_cast<uint8>(type));
+	connection.sendBuffer.insert(connection.sendBuffer.end(), pPayloadBytes, pPayloadBytes + size);
+}
+
+bool CZoneLink::Receive(SConnection& connection, const SCallbacks& callbacks)
+{
+	uint8 chunk[16 * 1024];
+	for (;;)
+	{
+		const int result = CrySock::recv(connection.socket, reinterpret_cast<char*>(chunk), sizeof(chunk), 0);
+		if (result > 0)
+		{
+			connection.receiveBuffer.insert(connection.receiveBuffer.end(), chunk, chunk + result);
+			continue;
+		}
+
+		if (result == CRY_SOCKET_ERROR && CrySock::TranslateLastSocketError() == CrySock::eCSE_EWOULDBLOCK)
+			break;
+
+		// 对端关闭或出错
+		return false;
+	}
+
+	size_t offset = 0;
+	while (connection.receiveBuffer.size() - offset >= sizeof(uint32) + 1)
+	{
+		uint32 messageSize;
+		memcpy(&messageSize, connection.receiveBuffer.data() + offset, sizeof(messageSize));
+		if (messageSize == 0 || messageSize > MaxBacklog)
+			return false;
+
+		if (connection.receiveBuffer.size() - offset < sizeof(uint32) + messageSize)
+			break;
+
+		const uint8* pMessage = connection.receiveBuffer.data() + offset + sizeof(uint32);
+		if (!Dispatch(connection, static_cast<EMessage>(pMessage[0]), pMessage + 1, messageSize - 1, callbacks))
+			return false;
+
+		offset += sizeof(uint32) + messageSize;
+	}
+
+	connection.receiveBuffer.erase(connection.receiveBuffer.begin(), connection.receiveBuffer.begin() + offset);
+	return true;
+}
+
+bool CZoneLink::Flush(SConnection& connection)
+{
+	if (connection.sendBuffer.size() > MaxBacklog)
+		return false;
+
+	size_t sentBytes = 0;
+	while (sentBytes < connection.sendBuffer.size())
+	{
+		// 相邻区域进程退出后的发送由send返回错误，不能让本进程因SIGPIPE退出
+#if defined(MSG_NOSIGNAL)
+		const int flags = MSG_NOSIGNAL;
+#else
+		const int flags = 0;
+#endif
+		const int result = CrySock::send(connection.socket, reinterpret_cast<const char*>(connection.sendBuffer.data() + sentBytes), static_cast<int>(connection.sendBuffer.size() - sentBytes), flags);
+		if (result == CRY_SOCKET_ERROR)
+		{
+			if (CrySock::TranslateLastSocketError() == CrySock::eCSE_EWOULDBLOCK)
+				break;
+
+			return false;
+		}
+
+		sentBytes += static_cast<size_t>(result);
+	}
+
+	connection.sendBuffer.erase(connection.sendBuffer.begin(), connection.sendBuffer.begin() + sentBytes);
+	return true;
+}
+
+bool CZoneLink::Dispatch(SConnection& connection, EMessage type, const uint8* pPayload, uint32 size, const SCallbacks& callbacks)
+{
+	switch (type)
+	{
+		case EMessage::Hello:
+		{
+			if (size != sizeof(SHello))
+				return false;
+
+			SHello hello;
+			memcpy(&hello, pPayload, sizeof(hello));
+			if (hello.zone < 0 || hello.zone >= m_zoneCount || hello.zone == m_localZone)
+				return false;
+
+			if (connection.zone < 0)
+			{
+				CryLogAlways("[Zones] Zone %d connected", hello.zone);
+			}
+
+			connection.zone = hello.zone;
+			connection.gamePort = hello.gamePort;
+			return true;
+		}
+
+		case EMessage::Handoff:
+		{
+			if (size != sizeof(SPlayerHandoff) || connection.zone < 0)
+				return false;
+
+			SPlayerHandoff handoff;
+			memcpy(&handoff, pPayload, sizeof(handoff));
+			handoff.name[sizeof(handoff.name) - 1] = '\0';
+			callbacks.onHandoff(connection.zone, handoff);
+			return true;
+		}
+
+		case EMessage::Ghost:
+		{
+			if (size != sizeof(SGhostState) || connection.zone < 0)
+				return false;
+
+			SGhostState ghost;
+			memcpy(&ghost, pPayload, sizeof(ghost));
+			callbacks.onGhost(connection.zone, ghost);
+			return true;
+		}
+
+		case EMessage::GhostRemove:
+		{
+			if (size != sizeof(EntityId) || connection.zone < 0)
+				return false;
+
+			EntityId sourceEntityId;
+			memcpy(&sourceEntityId, pPayload, sizeof(sourceEntityId));
+			callbacks.onGhostRemove(connection.zone, sourceEntityId);
+			return true;
+		}
+
+		case EMessage::HandoffClaimed:
+		{
+			if (size != sizeof(uint64) || connection.zone < 0)
+				return false;
+
+			uint64 handoffToken;
+			memcpy(&handoffToken, pPayload, sizeof(handoffToken));
+			callbacks.onHandoffClaimed(connection.zone, handoffToken);
+			return true;
+		}
+	}
+
+	// 未知的消息类型，版本不一致的进程
+	return false;
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <CryNetwork/CrySocks.h>
+
+#include <functional>
+#include <vector>
+
+// 同一台机器上各区域服务器进程之间的回环TCP连接
+// 区域i监听basePort + i，并主动连接所有编号更小的区域，每对区域之间只有一条连接
+// 消息为 uint32 长度 + uint8 类型 + 载荷，载荷是同一程序在同一台机器上的内存布局，不做字节序转换
+class CZoneLink
+{
+public:
+	enum class EMessage : uint8
+	{
+		// 建立连接后首先发送：区域编号与该进程接受客户端连接的游戏端口
+		Hello = 0,
+		// 玩家越过边界，由目标区域接管
+		Handoff,
+		// 靠近边界的玩家的最新变换，目标区域以幽灵实体显示
+		Ghost,
+		// 玩家离开边界附近或已被移交，移除幽灵
+		GhostRemove,
+		// 目标区域：客户端已出示移交令牌取回玩家，源区域移除它保留的休眠副本
+		HandoffClaimed
+	};
+
+	// 移交的玩家状态
+	struct SPlayerHandoff
+	{
+		// 源区域中的实体id，目标区域以此移除对应的幽灵
+		EntityId sourceEntityId;
+		// 源区域为这次移交随机生成的令牌，只发给拥有者客户端，客户端在目标区域重新连接后出示它取回玩家，机器人为0
+		uint64 handoffToken;
+		// 已应用的输入序号，跨区域保持递增
+		uint32 inputSequence;
+		// 机器人输入的随机数状态，目标区域继续同一序列
+		uint32 botRandomState;
+		Vec3 position;
+		Quat rotation;
+		float verticalVelocity;
+		uint16 reviveCount;
+		uint8 inputFlags;
+		bool bGrounded;
+		bool bBot;
+		char name[32];
+	};
+
+	struct SGhostState
+	{
+		EntityId sourceEntityId;
+		Vec3 position;
+		Quat rotation;
+	};
+
+	struct SCallbacks
+	{
+		std::function<void(int sourceZone, const SPlayerHandoff& handoff)> onHandoff;
+		std::function<void(int sourceZone, const SGhostState& ghost)> onGhost;
+		std::function<void(int sourceZone, EntityId sourceEntityId)> onGhostRemove;
+		std::function<void(int targetZone, uint64 handoffToken)> onHandoffClaimed;
+	};
+
+	~CZoneLink() { Stop(); }
+
+	bool Start(int localZone, int zoneCount, uint16 basePort, uint16 gamePort);
+	void Stop();
+	bool IsRunning() const { return m_listenSocket != CRY_INVALID_SOCKET; }
+
+	// 接受与重试连接，分发收到的消息并发送积压的数据
+	void Update(const SCallbacks& callbacks);
+
+	bool IsConnected(int zone) const;
+	// 区域进程的游戏端口，未连接时返回0
+	uint16 GetGamePort(int zone) const;
+	size_t GetConnectedCount() const;
+
+	// 未连接时返回false，调用方应保留玩家直到连接恢复
+	bool SendHandoff(int zone, const SPlayerHandoff& handoff) { return Send(zone, EMessage::Handoff, &handoff, sizeof(handoff)); }
+	bool SendGhost(int zone, const SGhostState& ghost) { return Send(zone, EMessage::Ghost, &ghost, sizeof(ghost)); }
+	bool SendGhostRemove(int zone, EntityId sourceEntityId) { return Send(zone, EMessage::GhostRemove, &sourceEntityId, sizeof(sourceEntityId)); }
+	bool SendHandoffClaimed(int zone, uint64 handoffToken) { return Send(zone, EMessage::HandoffClaimed, &handoffToken, sizeof(handoffToken)); }
+
+protected:
+	struct SConnection
+	{
+		CRYSOCKET socket = CRY_INVALID_SOCKET;
+		// 对端的区域编号，收到Hello之前为-1
+		int zone = -1;
+		uint16 gamePort = 0;
+		std::vector<uint8> receiveBuffer;
+		std::vector<uint8> sendBuffer;
+	};
+
+	struct SHello
+	{
+		int32 zone;
+		uint16 gamePort;
+	};
+
+	void ConnectToLowerZones();
+	void AcceptConnections();
+	bool Send(int zone, EMessage type, const void* pPayload, uint32 size);
+	void Append(SConnection& connection, EMessage type, const void* pPayload, uint32 size);
+	// 连接断开时返回false
+	bool Receive(SConnection& connection, const SCallbacks& callbacks);
+	bool Flush(SConnection& connection);
+	bool Dispatch(SConnection& connection, EMessage type, const uint8* pPayload, uint32 size, const SCallbacks& callbacks);
+
+protected:
+	// 单个连接最多积压的字节数，超过时断开，由重连恢复
+	static constexpr size_t MaxBacklog = 16 * 1024 * 1024;
+	// 重试连接编号更小的区域的间隔(秒)
+	static constexpr float ReconnectInterval = 1.f;
+
+	int m_localZone = 0;
+	int m_zoneCount = 1;
+	uint16 m_basePort = 0;
+	uint16 m_gamePort = 0;
+
+	CRYSOCKET m_listenSocket = CRY_INVALID_SOCKET;
+	std::vector<SConnection> m_connections;
+	float m_nextConnectTime = 0.f;
+};
@@ -0,0 +1,61 @@
+#include "StdAfx.h"
+#include "ZoneMap.h"
+
+void CZoneMap::Configure(int zoneCount, int localZone, float worldSize)
+{
+	m_zoneCount = clamp_tpl(zoneCount, 1, MaxZones);
+	m_localZone = clamp_tpl(localZone, 0, m_zoneCount - 1);
+	m_worldSize = max(worldSize, 1.f);
+	m_zoneWidth = m_worldSize / static_cast<float>(m_zoneCount);
+}
+
+int CZoneMap::GetZoneAt(const Vec3& position) const
+{
+	if (!IsEnabled())
+		return 0;
+
+	// 地图以外的位置归属最近的区域
+	const int zone = static_cast<int>(floor_tpl(position.x / m_zoneWidth));
+	return clamp_tpl(zone, 0, m_zoneCount - 1);
+}
+
+int CZoneMap::GetHandoffZone(const Vec3& position, float margin) const
+{
+	const int zone = GetZoneAt(position);
+	if (zone == m_localZone)
+		return m_localZone;
+
+	// 只在越过边界足够远时移交，避免沿边界移动的玩家来回切换
+	const float minX = static_cast<float>(m_localZone) * m_zoneWidth;
+	const float maxX = minX + m_zoneWidth;
+	if (position.x > maxX + margin || position.x < minX - margin)
+		return zone;
+
+	return m_localZone;
+}
+
+uint32 CZoneMap::GetGhostZoneMask(const Vec3& position, float distance) const
+{
+	if (!IsEnabled())
+		return 0;
+
+	const float minX = static_cast<float>(m_localZone) * m_zoneWidth;
+	const float maxX = minX + m_zoneWidth;
+
+	uint32 zoneMask = 0;
+	if (m_localZone > 0 && position.x - minX < distance)
+	{
+		zoneMask |= 1u << (m_localZone - 1);
+	}
+	if (m_localZone + 1 < m_zoneCount && maxX - position.x < distance)
+	{
+		zoneMask |= 1u << (m_localZone + 1);
+	}
+
+	return zoneMask;
+}
+
+Vec2 CZoneMap::GetZoneCenter(int zone) const
+{
+	return Vec2((static_cast<float>(zone) + 0.5f) * m_zoneWidth, 0.5f * m_worldSize);
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+// 把地图沿X轴划分为等宽的条带区域，每个区域由同一台机器上的一个服务器进程拥有
+// 玩家越过边界一段距离(迟滞)后移交给目标区域，靠近边界的玩家以幽灵(ghost)复制到相邻区域
+class CZoneMap
+{
+public:
+	// 位掩码表示区域集合，区域数量不能超过此值
+	static constexpr int MaxZones = 32;
+
+	// zoneCount为1时不分区
+	void Configure(int zoneCount, int localZone, float worldSize);
+
+	bool IsEnabled() const { return m_zoneCount > 1; }
+	int GetZoneCount() const { return m_zoneCount; }
+	int GetLocalZone() const { return m_localZone; }
+
+	int GetZoneAt(const Vec3& position) const;
+	// 本区域拥有的玩家越过边界超过margin米后返回目标区域，否则返回本区域
+	int GetHandoffZone(const Vec3& position, float margin) const;
+	// 边界在distance米内的相邻区域，以位掩码返回
+	uint32 GetGhostZoneMask(const Vec3& position, float distance) const;
+	// 区域中心的世界坐标(XY)
+	Vec2 GetZoneCenter(int zone) const;
+
+protected:
+	int m_zoneCount = 1;
+	int m_localZone = 0;
+	float m_worldSize = 0.f;
+	float m_zoneWidth = 0.f;
+};